@@ -95,6 +95,10 @@ int main(int argc, char **argv)
 
     D_open_driver();
 
+    /* overviews change values, only use them to display all of them */
+    if (!vallist->answer)
+        Rast_want_overviews(1);
+
     fp = Rast_map_is_fp(name, "");
     if (vallist->answer) {
         if (fp)
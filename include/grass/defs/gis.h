@@ -192,9 +192,11 @@ int G_compressor_number(char *);
 char *G_compressor_name(int);
 int G_default_compressor(void);
 int G_check_compressor(int);
+int G_compress_flagged(unsigned char *, int, unsigned char *, int, int);
 int G_write_compressed(int, unsigned char *, int, int);
 int G_write_unompressed(int, unsigned char *, int);
 int G_read_compressed(int, int, unsigned char *, int, int);
+int G_expand_compressed(unsigned char *, int, unsigned char *, int, int);
 int G_compress_bound(int, int);
 int G_compress(unsigned char *, int, unsigned char *, int, int);
 int G_expand(unsigned char *, int, unsigned char *, int, int);
@@ -869,6 +871,10 @@ void G_xdr_get_float(float *, const void *);
 void G_xdr_put_float(void *, const float *);
 void G_xdr_get_double(double *, const void *);
 void G_xdr_put_double(void *, const double *);
+void G_xdr_get_floats(float *, const void *, int);
+void G_xdr_put_floats(void *, const float *, int);
+void G_xdr_get_doubles(double *, const void *, int);
+void G_xdr_put_doubles(void *, const double *, int);
 
 /* zero.c */
 void G_zero(void *, int);
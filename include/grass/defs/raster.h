@@ -38,6 +38,16 @@ int Rast__check_for_auto_masking(void);
 void Rast_suppress_masking(void);
 void Rast_unsuppress_masking(void);
 
+/* block_stats.c */
+struct Block_stats *Rast__alloc_block_stats(const struct Cell_head *, int,
+                                            int);
+void Rast__update_block_stats(int, const void *, int);
+void Rast__write_block_stats(int);
+void Rast_remove_block_stats(const char *);
+int Rast_read_block_stats(const char *, const char *, struct Block_stats *);
+void Rast_free_block_stats(struct Block_stats *);
+void Rast_set_block_stats_size(int);
+
 /* cats.c */
 int Rast_read_cats(const char *, const char *, struct Categories *);
 int Rast_read_vector_cats(const char *, const char *, struct Categories *);
@@ -268,8 +278,10 @@ void Rast_abs_log_colors(struct Colors *, struct Colors *, int);
 /* format.c */
 int Rast__check_format(int);
 int Rast__read_row_ptrs(int);
+int Rast__read_tile_ptrs(int);
 int Rast__read_null_row_ptrs(int, int);
 int Rast__write_row_ptrs(int);
+int Rast__write_tile_ptrs(int);
 int Rast__write_null_row_ptrs(int, int);
 
 /* fpreclass.c */
@@ -320,6 +332,14 @@ int Rast_close_gdal_write_link(struct GDAL_link *);
 /* get_cellhd.c */
 void Rast_get_cellhd(const char *, const char *, struct Cell_head *);
 
+/* get_block.c */
+void Rast_reader_get_block(struct Rast_reader *, void *, int, int, int, int,
+                           RASTER_MAP_TYPE);
+void Rast_get_block(int, void *, int, int, int, int, RASTER_MAP_TYPE);
+void Rast_get_c_block(int, CELL *, int, int, int, int);
+void Rast_get_f_block(int, FCELL *, int, int, int, int);
+void Rast_get_d_block(int, DCELL *, int, int, int, int);
+
 /* get_row.c */
 void Rast_get_row_nomask(int, void *, int, RASTER_MAP_TYPE);
 void Rast_get_c_row_nomask(int, CELL *, int);
@@ -331,6 +351,11 @@ void Rast_get_f_row(int, FCELL *, int);
 void Rast_get_d_row(int, DCELL *, int);
 void Rast_get_null_value_row(int, char *, int);
 int Rast__read_null_bits(int, int, unsigned char *);
+void Rast_reader_get_row(struct Rast_reader *, void *, int, RASTER_MAP_TYPE);
+void Rast_reader_get_row_nomask(struct Rast_reader *, void *, int,
+                                RASTER_MAP_TYPE);
+void Rast_reader_get_null_value_row(struct Rast_reader *, char *, int);
+int Rast__read_ahead(struct Rast_reader *, int);
 
 /* get_row_colr.c */
 void Rast_get_row_colors(int, int, struct Colors *, unsigned char *,
@@ -448,6 +473,8 @@ int Rast__open_old(const char *, const char *);
 int Rast_open_c_new(const char *);
 int Rast_open_c_new_uncompressed(const char *);
 void Rast_want_histogram(int);
+void Rast_want_mmap(int);
+void Rast_set_write_threads(int);
 void Rast_set_cell_format(int);
 int Rast_get_cell_format(CELL);
 int Rast_open_fp_new(const char *);
@@ -460,6 +487,8 @@ RASTER_MAP_TYPE Rast_get_map_type(int);
 int Rast_open_new(const char *, RASTER_MAP_TYPE);
 int Rast_open_new_uncompressed(const char *, RASTER_MAP_TYPE);
 void Rast_set_quant_rules(int, struct Quant *);
+int Rast__open_overview_new(const char *, int, RASTER_MAP_TYPE,
+                            const struct Cell_head *);
 int Rast__open_null_write(const char *);
 
 /* put_cellhd.c */
@@ -471,6 +500,9 @@ void Rast_put_c_row(int, const CELL *);
 void Rast_put_f_row(int, const FCELL *);
 void Rast_put_d_row(int, const DCELL *);
 void Rast__write_null_bits(int, const unsigned char *);
+struct R_writer *Rast__alloc_writer(int);
+void Rast__flush_writer(int);
+void Rast__free_writer(struct R_writer *);
 
 /* put_title.c */
 int Rast_put_cell_title(const char *, const char *);
@@ -558,6 +590,37 @@ bool Rast_legal_semantic_label(const char *);
 /* rast_to_img_string.c */
 int Rast_map_to_img_str(char *, int, unsigned char *);
 
+/* overview.c */
+char *Rast__overview_element(char *, int, const char *);
+void Rast__overview_cellhd(struct Cell_head *, const struct Cell_head *, int);
+int Rast__select_overview(const char *, const char *, struct Cell_head *);
+void Rast_want_overviews(int);
+void Rast_remove_overviews(const char *);
+void Rast_build_overviews(const char *, const int *, int, int);
+
+/* pool.c */
+int Rast__start_threads(int);
+void Rast__queue_job(struct R_job *, void (*)(void *), void *);
+void Rast__wait_job(struct R_job *);
+int Rast__job_done(struct R_job *);
+void Rast__wait_all_jobs(void);
+
+/* prefetch.c */
+struct R_prefetch *Rast__alloc_prefetch(int, int);
+void Rast__free_prefetch(struct R_prefetch *);
+void Rast__reset_prefetch(struct Rast_reader *);
+int Rast__prefetch_row(struct Rast_reader *, int);
+int Rast__get_prefetched_row(struct Rast_reader *, int);
+void Rast_set_prefetch(int, int);
+
+/* reader.c */
+struct Rast_reader *Rast__alloc_reader(int);
+void Rast__free_reader(struct Rast_reader *);
+void Rast__map_data_file(int);
+void Rast__unmap_data_file(int);
+struct Rast_reader *Rast_open_reader(int);
+void Rast_close_reader(struct Rast_reader *);
+
 /* reclass.c */
 int Rast_is_reclass(const char *, const char *, char[GNAME_MAX],
                     char[GMAPSET_MAX]);
@@ -566,6 +629,13 @@ int Rast_get_reclass(const char *, const char *, struct Reclass *);
 void Rast_free_reclass(struct Reclass *);
 int Rast_put_reclass(const char *, const struct Reclass *);
 
+/* row_cache.c */
+int Rast__row_cache_id(int);
+void Rast__release_row_cache_id(int);
+int Rast__get_cached_row(int, int, void *, size_t, int *);
+void Rast__cache_row(int, int, const void *, size_t, int);
+void Rast_set_row_cache_size(int);
+
 /* sample.c */
 DCELL Rast_get_sample_nearest(int, const struct Cell_head *,
                               struct Categories *, double, double, int);
@@ -583,6 +653,15 @@ void Rast_unset_window(void);
 void Rast_set_output_window(struct Cell_head *);
 void Rast_set_input_window(struct Cell_head *);
 
+/* tiles.c */
+struct R_tiles *Rast__alloc_tiles(const struct Cell_head *, int, int);
+void Rast__free_tiles(struct R_tiles *);
+struct R_tiles *Rast__read_tile_info(const char *, const char *,
+                                     const struct Cell_head *);
+void Rast__write_tile_info(int);
+void Rast_set_tile_size(int);
+int Rast_get_tile_size(int, int *, int *);
+
 /* vrt.c */
 struct R_vrt *Rast_get_vrt(const char *, const char *);
 void Rast_close_vrt(struct R_vrt *);
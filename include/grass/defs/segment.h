@@ -12,5 +12,7 @@ int Segment_init(SEGMENT *, int, int);
 int Segment_put(SEGMENT *, const void *, off_t, off_t);
 int Segment_put_row(const SEGMENT *, const void *, off_t);
 int Segment_release(SEGMENT *);
+int Segment_set_threads(SEGMENT *, int);
+int Segment_set_compression(SEGMENT *, int);
 
 #endif /* GRASS_SEGMENTDEFS_H */
@@ -21,6 +21,11 @@
 #define INTERP_BILINEAR 2 /* bilinear interpolation          */
 #define INTERP_BICUBIC  3 /* bicubic interpolation           */
 
+/* overview resampling methods */
+#define OVERVIEW_NEAREST 1 /* cell at the center of the block */
+#define OVERVIEW_AVERAGE 2 /* mean of the block              */
+#define OVERVIEW_MODE    3 /* most frequent value of the block */
+
 /*** typedefs ***/
 typedef int RASTER_MAP_TYPE;
 
@@ -232,8 +237,29 @@ struct FP_stats {
     unsigned long total;
 };
 
+struct Block_stat {
+    DCELL min, max; /* undefined if count is 0 */
+    DCELL sum;
+    DCELL sumsq;
+    DCELL sum_abs;
+    grass_int64 count; /* non-null cells */
+};
+
+struct Block_stats {
+    int rows;                  /* rows of cells per block    */
+    int cols;                  /* columns of cells per block */
+    int nrows;                 /* rows of blocks             */
+    int ncols;                 /* columns of blocks          */
+    struct Block_stat *blocks; /* nrows * ncols, row by row  */
+};
+
 struct GDAL_link;
 struct R_vrt;
+struct Rast_reader;
+struct R_prefetch;
+struct R_job;
+struct R_writer;
+struct R_tiles;
 
 /*** prototypes ***/
 #include <grass/defs/raster.h>
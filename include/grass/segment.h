@@ -59,6 +59,14 @@ typedef struct SEGMENT {
     int offset;          /* offset of data past header */
 
     char *cache; /* all in memory cache */
+
+    /* access by several threads, see Segment_set_threads() */
+    int nstripes;               /* number of stripes, 0 if not shared */
+    struct seg_stripe *stripes; /* loaded segments of each stripe */
+
+    /* compressed segments, see Segment_set_compression() */
+    struct seg_pages *pages; /* where segments are stored, NULL if raw */
+    unsigned char *zbuf;     /* compressed segment buffer */
 } SEGMENT;
 
 #include <grass/defs/segment.h>
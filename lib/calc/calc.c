@@ -3,6 +3,8 @@
 
 #include <grass/calc.h>
 
+#include "vector.h"
+
 /****************************************************************************/
 
 volatile int floating_point_exception;
@@ -55,6 +57,7 @@ void post_exec(void)
 void calc_init(int cols)
 {
     columns = cols;
+    calc_vector_init();
 }
 
 /****************************************************************************/
@@ -0,0 +1,108 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include <grass/gis.h>
+#include <grass/raster.h>
+#include <grass/calc.h>
+
+#include "vector.h"
+
+/****************************************************************************/
+
+/* Vector kernels for the most common element-wise functions, written with
+ * the vector extensions of GCC and Clang. They are compiled for the SIMD
+ * instructions every CPU of the target has (SSE2 on x86-64, NEON on
+ * AArch64) and, on x86, once more for AVX2, which is used when the CPU
+ * supports it. Without vector extensions, or on targets without SIMD
+ * instructions, the functions use their scalar loops.
+ */
+
+#if (defined(__GNUC__) && __GNUC__ >= 9) || defined(__clang__)
+#if defined(__SSE2__) || defined(__ARM_NEON) || defined(__ALTIVEC__)
+#define HAVE_VECTOR_KERNELS
+#endif
+#if defined(__x86_64__) || defined(__i386__)
+#define HAVE_AVX2_KERNELS
+#endif
+#endif
+
+#ifdef HAVE_VECTOR_KERNELS
+
+#define W         16
+#define TARGET
+#define NAME(name) name##_vec
+#include "vector_ops.h"
+#undef W
+#undef TARGET
+#undef NAME
+
+#ifdef HAVE_AVX2_KERNELS
+#define W         32
+#define TARGET    __attribute__((target("avx2")))
+#define NAME(name) name##_avx2
+#include "vector_ops.h"
+#undef W
+#undef TARGET
+#undef NAME
+#endif
+
+#endif /* HAVE_VECTOR_KERNELS */
+
+static void (*const (*kernels)[3])(int, void **);
+
+/****************************************************************************/
+
+/*!
+   \brief Select the vector kernels for the CPU
+
+   Called by calc_init(). The environment variable GRASS_CALC_VECTOR set
+   to 0 disables the kernels.
+ */
+void calc_vector_init(void)
+{
+    const char *env = getenv("GRASS_CALC_VECTOR");
+
+    kernels = NULL;
+
+    if (env && atoi(env) == 0)
+        return;
+
+#ifdef HAVE_VECTOR_KERNELS
+    kernels = kernels_vec;
+#ifdef HAVE_AVX2_KERNELS
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2"))
+        kernels = kernels_avx2;
+#endif
+#endif
+
+    G_debug(3, "calc_vector_init(): %s kernels",
+            !kernels ? "scalar"
+#ifdef HAVE_AVX2_KERNELS
+            : kernels == kernels_avx2 ? "AVX2"
+#endif
+                                      : "vector");
+}
+
+/*!
+   \brief Run the vector kernel of an operation
+
+   \param op operation, CALC_VEC_*
+   \param type type of the operands (of the second and third operand for
+   CALC_VEC_IF)
+   \param args result and operands, of columns cells each
+
+   \return 1 if done, 0 if the scalar code is to be used
+ */
+int calc_vector(int op, int type, void **args)
+{
+    if (!kernels || type < CELL_TYPE || type > DCELL_TYPE ||
+        !kernels[op][type])
+        return 0;
+
+    kernels[op][type](columns, args);
+
+    return 1;
+}
+
+/****************************************************************************/
@@ -0,0 +1,24 @@
+#ifndef CALC_VECTOR_H
+#define CALC_VECTOR_H
+
+/* operations with vector kernels, see vector.c */
+enum {
+    CALC_VEC_ADD,
+    CALC_VEC_SUB,
+    CALC_VEC_MUL,
+    CALC_VEC_DIV,
+    CALC_VEC_NEG,
+    CALC_VEC_GT,
+    CALC_VEC_GE,
+    CALC_VEC_LT,
+    CALC_VEC_LE,
+    CALC_VEC_EQ,
+    CALC_VEC_NE,
+    CALC_VEC_IF,
+    CALC_VEC_NUM
+};
+
+extern int calc_vector(int op, int type, void **args);
+extern void calc_vector_init(void);
+
+#endif
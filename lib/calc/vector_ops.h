@@ -0,0 +1,264 @@
+/****************************************************************************
+ *
+ * Element-wise kernels of lib/calc on vectors of W bytes, included by
+ * vector.c once per instruction set with W, TARGET and NAME() defined.
+ *
+ * Floating-point nulls are NaN and propagate through the arithmetic,
+ * operations giving null for other reasons or having CELL results merge
+ * a null mask into the result instead of testing each cell. The null
+ * values of FCELL and DCELL have all bits set, so or-ing a mask into a
+ * value sets the masked cells to null.
+ *
+ ****************************************************************************/
+
+/* W bytes per vector: LF cells of CELL or FCELL, LD cells of DCELL */
+#define LF (W / 4)
+#define LD (W / 8)
+
+typedef CELL NAME(vc) __attribute__((vector_size(W)));
+typedef unsigned int NAME(vu) __attribute__((vector_size(W)));
+typedef FCELL NAME(vf) __attribute__((vector_size(W)));
+typedef DCELL NAME(vd) __attribute__((vector_size(W)));
+typedef long long NAME(vl) __attribute__((vector_size(W)));
+/* CELL and FCELL cells of as many as in a DCELL vector */
+typedef CELL NAME(vch) __attribute__((vector_size(W / 2)));
+typedef FCELL NAME(vfh) __attribute__((vector_size(W / 2)));
+
+/* loop over the columns in vectors of n cells, then over the rest */
+#define VEC_LOOP(L, n, ...)               \
+    {                                     \
+        int i, m = L;                     \
+                                          \
+        for (i = 0; i + L <= (n); i += L) \
+            __VA_ARGS__                   \
+        if (i < (n)) {                    \
+            m = (n) - i;                  \
+            __VA_ARGS__                   \
+        }                                 \
+    }
+
+/* load and store m cells, the rest of the vector is zero */
+#define VEC_LOAD(v, p)                               \
+    do {                                             \
+        if (m * sizeof(*(p)) == sizeof(v))           \
+            memcpy(&(v), (p) + i, sizeof(v));        \
+        else {                                       \
+            memset(&(v), 0, sizeof(v));              \
+            memcpy(&(v), (p) + i, m * sizeof(*(p))); \
+        }                                            \
+    } while (0)
+
+#define VEC_STORE(p, v)                              \
+    do {                                             \
+        if (m * sizeof(*(p)) == sizeof(v))           \
+            memcpy((p) + i, &(v), sizeof(v));        \
+        else                                         \
+            memcpy((p) + i, &(v), m * sizeof(*(p))); \
+    } while (0)
+
+/* binary operation on L cells of type T giving type R */
+#define VEC_BINARY(name, L, VT, T, VR, R, expr)                   \
+    TARGET static void NAME(name)(int n, void **args)             \
+    {                                                             \
+        R *res = args[0];                                         \
+        const T *a = args[1], *b = args[2];                       \
+        const VR null_c = (VR){0} + (CELL)0x80000000;             \
+                                                                  \
+        (void)null_c;                                             \
+        VEC_LOOP(L, n, {                                          \
+            VT x, y;                                              \
+            VR r;                                                 \
+                                                                  \
+            VEC_LOAD(x, a);                                       \
+            VEC_LOAD(y, b);                                       \
+            r = (expr);                                           \
+            VEC_STORE(res, r);                                    \
+        })                                                        \
+    }
+
+/* CELL results: null where either operand is null */
+#define NULL_C2(v) \
+    (((v) & ~((x == null_c) | (y == null_c))) | \
+     (null_c & ((x == null_c) | (y == null_c))))
+#define NULL_F2(v) \
+    (((v) & ~((x != x) | (y != y))) | (null_c & ((x != x) | (y != y))))
+#define NULL_D2(v)                                                      \
+    (((v) & ~__builtin_convertvector((x != x) | (y != y), NAME(vch))) | \
+     (null_c & __builtin_convertvector((x != x) | (y != y), NAME(vch))))
+#define CMP_D(op) __builtin_convertvector(x op y, NAME(vch))
+
+/* x + y, x - y, x * y: integers wrap around as with the scalar code */
+VEC_BINARY(add_c, LF, NAME(vc), CELL, NAME(vc), CELL,
+           NULL_C2((NAME(vc))((NAME(vu))x + (NAME(vu))y)))
+VEC_BINARY(sub_c, LF, NAME(vc), CELL, NAME(vc), CELL,
+           NULL_C2((NAME(vc))((NAME(vu))x - (NAME(vu))y)))
+VEC_BINARY(mul_c, LF, NAME(vc), CELL, NAME(vc), CELL,
+           NULL_C2((NAME(vc))((NAME(vu))x * (NAME(vu))y)))
+VEC_BINARY(add_f, LF, NAME(vf), FCELL, NAME(vf), FCELL, (0.0f + x) + y)
+VEC_BINARY(sub_f, LF, NAME(vf), FCELL, NAME(vf), FCELL, x - y)
+VEC_BINARY(mul_f, LF, NAME(vf), FCELL, NAME(vf), FCELL, x * y)
+VEC_BINARY(add_d, LD, NAME(vd), DCELL, NAME(vd), DCELL, (0.0 + x) + y)
+VEC_BINARY(sub_d, LD, NAME(vd), DCELL, NAME(vd), DCELL, x - y)
+VEC_BINARY(mul_d, LD, NAME(vd), DCELL, NAME(vd), DCELL, x * y)
+
+/* x / y, null for y == 0 */
+VEC_BINARY(div_f, LF, NAME(vf), FCELL, NAME(vf), FCELL,
+           (NAME(vf))((NAME(vc))(x / y) | (y == 0.0f)))
+VEC_BINARY(div_d, LD, NAME(vd), DCELL, NAME(vd), DCELL,
+           (NAME(vd))((NAME(vl))(x / y) | (y == 0.0)))
+
+/* comparisons, 1 if true, 0 if false */
+VEC_BINARY(gt_c, LF, NAME(vc), CELL, NAME(vc), CELL, NULL_C2((x > y) & 1))
+VEC_BINARY(ge_c, LF, NAME(vc), CELL, NAME(vc), CELL, NULL_C2((x >= y) & 1))
+VEC_BINARY(lt_c, LF, NAME(vc), CELL, NAME(vc), CELL, NULL_C2((x < y) & 1))
+VEC_BINARY(le_c, LF, NAME(vc), CELL, NAME(vc), CELL, NULL_C2((x <= y) & 1))
+VEC_BINARY(eq_c, LF, NAME(vc), CELL, NAME(vc), CELL, NULL_C2((x == y) & 1))
+VEC_BINARY(ne_c, LF, NAME(vc), CELL, NAME(vc), CELL, NULL_C2((x != y) & 1))
+VEC_BINARY(gt_f, LF, NAME(vf), FCELL, NAME(vc), CELL, NULL_F2((x > y) & 1))
+VEC_BINARY(ge_f, LF, NAME(vf), FCELL, NAME(vc), CELL, NULL_F2((x >= y) & 1))
+VEC_BINARY(lt_f, LF, NAME(vf), FCELL, NAME(vc), CELL, NULL_F2((x < y) & 1))
+VEC_BINARY(le_f, LF, NAME(vf), FCELL, NAME(vc), CELL, NULL_F2((x <= y) & 1))
+VEC_BINARY(eq_f, LF, NAME(vf), FCELL, NAME(vc), CELL, NULL_F2((x == y) & 1))
+VEC_BINARY(ne_f, LF, NAME(vf), FCELL, NAME(vc), CELL, NULL_F2((x != y) & 1))
+VEC_BINARY(gt_d, LD, NAME(vd), DCELL, NAME(vch), CELL, NULL_D2(CMP_D(>) & 1))
+VEC_BINARY(ge_d, LD, NAME(vd), DCELL, NAME(vch), CELL, NULL_D2(CMP_D(>=) & 1))
+VEC_BINARY(lt_d, LD, NAME(vd), DCELL, NAME(vch), CELL, NULL_D2(CMP_D(<) & 1))
+VEC_BINARY(le_d, LD, NAME(vd), DCELL, NAME(vch), CELL, NULL_D2(CMP_D(<=) & 1))
+VEC_BINARY(eq_d, LD, NAME(vd), DCELL, NAME(vch), CELL, NULL_D2(CMP_D(==) & 1))
+VEC_BINARY(ne_d, LD, NAME(vd), DCELL, NAME(vch), CELL, NULL_D2(CMP_D(!=) & 1))
+
+/* -x */
+TARGET static void NAME(neg_c)(int n, void **args)
+{
+    CELL *res = args[0];
+    const CELL *a = args[1];
+
+    /* the negated null is null */
+    VEC_LOOP(LF, n, {
+        NAME(vc) x, r;
+
+        VEC_LOAD(x, a);
+        r = (NAME(vc))(0u - (NAME(vu))x);
+        VEC_STORE(res, r);
+    })
+}
+
+TARGET static void NAME(neg_f)(int n, void **args)
+{
+    FCELL *res = args[0];
+    const FCELL *a = args[1];
+
+    VEC_LOOP(LF, n, {
+        NAME(vf) x, r;
+
+        VEC_LOAD(x, a);
+        r = -x;
+        VEC_STORE(res, r);
+    })
+}
+
+TARGET static void NAME(neg_d)(int n, void **args)
+{
+    DCELL *res = args[0];
+    const DCELL *a = args[1];
+
+    VEC_LOOP(LD, n, {
+        NAME(vd) x, r;
+
+        VEC_LOAD(x, a);
+        r = -x;
+        VEC_STORE(res, r);
+    })
+}
+
+/* if(c, x, y): null if c is null, else x if c is not 0, else y */
+TARGET static void NAME(if_c)(int n, void **args)
+{
+    CELL *res = args[0];
+    const DCELL *c = args[1];
+    const CELL *a = args[2], *b = args[3];
+
+    VEC_LOOP(LD, n, {
+        NAME(vd) z;
+        NAME(vch) x, y, r, zero, null;
+
+        VEC_LOAD(z, c);
+        VEC_LOAD(x, a);
+        VEC_LOAD(y, b);
+        zero = __builtin_convertvector(z == 0.0, NAME(vch));
+        null = __builtin_convertvector(z != z, NAME(vch));
+        r = (x & ~zero) | (y & zero);
+        r = (r & ~null) | ((CELL)0x80000000 & null);
+        VEC_STORE(res, r);
+    })
+}
+
+TARGET static void NAME(if_f)(int n, void **args)
+{
+    FCELL *res = args[0];
+    const DCELL *c = args[1];
+    const FCELL *a = args[2], *b = args[3];
+
+    VEC_LOOP(LD, n, {
+        NAME(vd) z;
+        NAME(vfh) x, y, r;
+        NAME(vch) zero, null;
+
+        VEC_LOAD(z, c);
+        VEC_LOAD(x, a);
+        VEC_LOAD(y, b);
+        zero = __builtin_convertvector(z == 0.0, NAME(vch));
+        null = __builtin_convertvector(z != z, NAME(vch));
+        r = (NAME(vfh))((((NAME(vch))x & ~zero) | ((NAME(vch))y & zero)) |
+                        null);
+        VEC_STORE(res, r);
+    })
+}
+
+TARGET static void NAME(if_d)(int n, void **args)
+{
+    DCELL *res = args[0];
+    const DCELL *c = args[1];
+    const DCELL *a = args[2], *b = args[3];
+
+    VEC_LOOP(LD, n, {
+        NAME(vd) z, x, y, r;
+        NAME(vl) zero, null;
+
+        VEC_LOAD(z, c);
+        VEC_LOAD(x, a);
+        VEC_LOAD(y, b);
+        zero = z == 0.0;
+        null = z != z;
+        r = (NAME(vd))((((NAME(vl))x & ~zero) | ((NAME(vl))y & zero)) |
+                       null);
+        VEC_STORE(res, r);
+    })
+}
+
+/* kernels by operation and operand type */
+static void (*const NAME(kernels)[CALC_VEC_NUM][3])(int, void **) = {
+    [CALC_VEC_ADD] = {NAME(add_c), NAME(add_f), NAME(add_d)},
+    [CALC_VEC_SUB] = {NAME(sub_c), NAME(sub_f), NAME(sub_d)},
+    [CALC_VEC_MUL] = {NAME(mul_c), NAME(mul_f), NAME(mul_d)},
+    [CALC_VEC_DIV] = {NULL, NAME(div_f), NAME(div_d)},
+    [CALC_VEC_NEG] = {NAME(neg_c), NAME(neg_f), NAME(neg_d)},
+    [CALC_VEC_GT] = {NAME(gt_c), NAME(gt_f), NAME(gt_d)},
+    [CALC_VEC_GE] = {NAME(ge_c), NAME(ge_f), NAME(ge_d)},
+    [CALC_VEC_LT] = {NAME(lt_c), NAME(lt_f), NAME(lt_d)},
+    [CALC_VEC_LE] = {NAME(le_c), NAME(le_f), NAME(le_d)},
+    [CALC_VEC_EQ] = {NAME(eq_c), NAME(eq_f), NAME(eq_d)},
+    [CALC_VEC_NE] = {NAME(ne_c), NAME(ne_f), NAME(ne_d)},
+    [CALC_VEC_IF] = {NAME(if_c), NAME(if_f), NAME(if_d)},
+};
+
+#undef LF
+#undef LD
+#undef VEC_LOOP
+#undef VEC_LOAD
+#undef VEC_STORE
+#undef VEC_BINARY
+#undef NULL_C2
+#undef NULL_F2
+#undef NULL_D2
+#undef CMP_D
@@ -2,6 +2,8 @@
 #include <grass/raster.h>
 #include <grass/calc.h>
 
+#include "vector.h"
+
 /****************************************************************
 eq(a,b) = a == b
 ****************************************************************/
@@ -23,6 +25,9 @@ int f_eq(int argc, const int *argt, void **args)
         if (argt[i] != argt[1])
             return E_ARG_TYPE;
 
+    if (calc_vector(CALC_VEC_EQ, argt[1], args))
+        return 0;
+
     switch (argt[1]) {
     case CELL_TYPE: {
         CELL *arg1 = args[1];
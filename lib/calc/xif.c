@@ -2,6 +2,8 @@
 #include <grass/raster.h>
 #include <grass/calc.h>
 
+#include "vector.h"
+
 /********************************************************************
  if(a)        1,0,1  1 if a is non zero, 0 otherwise
  if(a,b)      b,0,b  b if a is non zero, 0 otherwise
@@ -255,6 +257,9 @@ int f_if(int argc, const int *argt, void **args)
     if (argc >= 4 && argt[4] != argt[0])
         return E_ARG_TYPE;
 
+    if (argc == 3 && calc_vector(CALC_VEC_IF, argt[0], args))
+        return 0;
+
     switch (argt[0]) {
     case CELL_TYPE:
         return f_if_i(argc, argt, args);
@@ -2,6 +2,8 @@
 #include <grass/raster.h>
 #include <grass/calc.h>
 
+#include "vector.h"
+
 /****************************************************************
 le(a,b) = a <= b
 ****************************************************************/
@@ -16,6 +18,9 @@ int f_le(int argc, const int *argt, void **args)
     if (argc > 2)
         return E_ARG_HI;
 
+    if (calc_vector(CALC_VEC_LE, argt[1], args))
+        return 0;
+
     switch (argt[1]) {
     case CELL_TYPE: {
         CELL *arg1 = args[1];
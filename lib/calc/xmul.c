@@ -2,6 +2,8 @@
 #include <grass/raster.h>
 #include <grass/calc.h>
 
+#include "vector.h"
+
 /****************************************************************
 mul(a,b) = a * b
 ****************************************************************/
@@ -17,6 +19,9 @@ int f_mul(int argc, const int *argt, void **args)
         if (argt[i] != argt[0])
             return E_ARG_TYPE;
 
+    if (argc == 2 && calc_vector(CALC_VEC_MUL, argt[0], args))
+        return 0;
+
     switch (argt[0]) {
     case CELL_TYPE: {
         CELL *res = args[0];
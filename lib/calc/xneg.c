@@ -2,6 +2,8 @@
 #include <grass/raster.h>
 #include <grass/calc.h>
 
+#include "vector.h"
+
 /**********************************************************************
 neg(x) = -x
 **********************************************************************/
@@ -18,6 +20,9 @@ int f_neg(int argc, const int *argt, void **args)
     if (argt[0] != argt[1])
         return E_RES_TYPE;
 
+    if (calc_vector(CALC_VEC_NEG, argt[1], args))
+        return 0;
+
     switch (argt[1]) {
     case CELL_TYPE: {
         CELL *res = args[0];
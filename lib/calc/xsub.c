@@ -2,6 +2,8 @@
 #include <grass/raster.h>
 #include <grass/calc.h>
 
+#include "vector.h"
+
 /****************************************************************
 sub(a,b) = a - b
 ****************************************************************/
@@ -18,6 +20,9 @@ int f_sub(int argc, const int *argt, void **args)
     if (argt[1] != argt[0] || argt[2] != argt[0])
         return E_ARG_TYPE;
 
+    if (calc_vector(CALC_VEC_SUB, argt[0], args))
+        return 0;
+
     switch (argt[0]) {
     case CELL_TYPE: {
         CELL *res = args[0];
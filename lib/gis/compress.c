@@ -49,6 +49,18 @@
  *                                                                  *
  * ================================================================ *
  * int                                                              *
+ * G_expand_compressed (src, src_sz, dst, dst_sz, compression_type) *
+ *     int src_sz, dst_sz;                                          *
+ *     unsigned char *src, *dst;                                    *
+ * ---------------------------------------------------------------- *
+ * Same as G_read_compressed() but for a chunk which has already    *
+ * been read into 'src', including the leading compression flag.    *
+ * Does not touch any file descriptor, so it can be used to expand  *
+ * rows read with pread() or from a memory mapping.                 *
+ * Returns: The number of bytes decompressed into dst, or -1.       *
+ *                                                                  *
+ * ================================================================ *
+ * int                                                              *
  * G_write_compressed (fd, src, nbytes, compression_type)           *
  *     int fd, nbytes;                                              *
  *     unsigned char *src;                                          *
@@ -65,6 +77,23 @@
  *                                                                  *
  * ================================================================ *
  * int                                                              *
+ * G_compress_flagged (src, src_sz, dst, dst_sz, compression_type)  *
+ *     int src_sz, dst_sz;                                          *
+ *     unsigned char *src, *dst;                                    *
+ * ---------------------------------------------------------------- *
+ * Same as G_write_compressed() but stores the chunk, including the *
+ * leading compression flag, in 'dst' instead of writing it, so     *
+ * that rows can be compressed by other threads than the one        *
+ * writing them. 'dst_sz' should be one more than the larger of     *
+ * 'src_sz' and G_compress_bound().                                 *
+ * Returns: The number of bytes stored in dst, or an error code:    *
+ *                                                                  *
+ * Errors include:                                                  *
+ *        -1 -- Invalid source buffer.                              *
+ *        -2 -- Not enough space in dst.                            *
+ *                                                                  *
+ * ================================================================ *
+ * int                                                              *
  * G_write_uncompressed (fd, src, nbytes)                           *
  *     int fd, nbytes;                                              *
  *     unsigned char *src;                                          *
@@ -290,35 +319,70 @@ int G_read_compressed(int fd, int rbytes, unsigned char *dst, int nbytes,
         return -1;
     }
 
+    err = G_expand_compressed(b, nread, dst, nbytes, number);
+
+    /* We're done with b */
+    G_free(b);
+
+    /* Return whatever G_expand_compressed() returned */
+    return err;
+
+} /* G_read_compressed() */
+
+int G_expand_compressed(unsigned char *src, int src_sz, unsigned char *dst,
+                        int dst_sz, int number)
+{
+    int i;
+
+    if (src_sz <= 0)
+        return -1;
+
     /* Test if row is compressed */
-    if (b[0] == G_COMPRESSED_NO) {
+    if (src[0] == G_COMPRESSED_NO) {
         /* Then just copy it to dst */
-        for (err = 0; err < nread - 1 && err < nbytes; err++)
-            dst[err] = b[err + 1];
+        for (i = 0; i < src_sz - 1 && i < dst_sz; i++)
+            dst[i] = src[i + 1];
 
-        G_free(b);
-        return (nread - 1);
+        return (src_sz - 1);
     }
-    else if (b[0] != G_COMPRESSED_YES) {
+    else if (src[0] != G_COMPRESSED_YES) {
         /* We're not at the start of a row */
-        G_free(b);
         G_warning("Read error: We're not at the start of a row");
         return -1;
     }
     /* Okay it's a compressed row */
 
-    /* Just call G_expand() with the buffer we read,
+    /* Just call G_expand() with the buffer,
      * Account for first byte being a flag
      */
-    err = G_expand(b + 1, bsize - 1, dst, nbytes, number);
+    return G_expand(src + 1, src_sz - 1, dst, dst_sz, number);
 
-    /* We're done with b */
-    G_free(b);
+} /* G_expand_compressed() */
 
-    /* Return whatever G_expand() returned */
-    return err;
+int G_compress_flagged(unsigned char *src, int src_sz, unsigned char *dst,
+                       int dst_sz, int number)
+{
+    int err;
 
-} /* G_read_compressed() */
+    if (src == NULL || src_sz <= 0 || dst_sz < 1)
+        return -1;
+
+    err = G_compress(src, src_sz, dst + 1, dst_sz - 1, number);
+
+    /* store the row uncompressed if compression did not help */
+    if (err > 0 && err < src_sz) {
+        dst[0] = G_COMPRESSED_YES;
+        return err + 1;
+    }
+
+    if (dst_sz < src_sz + 1)
+        return -2;
+
+    dst[0] = G_COMPRESSED_NO;
+    memcpy(dst + 1, src, src_sz);
+
+    return src_sz + 1;
+} /* G_compress_flagged() */
 
 int G_write_compressed(int fd, unsigned char *src, int nbytes, int number)
 {
@@ -13,6 +13,7 @@
 
 #include <stdlib.h>
 #include <string.h>
+#include <stdint.h>
 #include <grass/gis.h>
 
 #include "G.h"
@@ -95,3 +96,109 @@ void G_xdr_put_double(void *dst, const double *src)
 {
     swap_double(dst, src);
 }
+
+/* byte order of whole arrays, written as shifts on words which
+   compilers turn into byte swap instructions and vectorize */
+static void swap_words4(void *dstp, const void *srcp, int n)
+{
+    unsigned char *dst = (unsigned char *)dstp;
+    const unsigned char *src = (const unsigned char *)srcp;
+    int i;
+
+    for (i = 0; i < n; i++) {
+        uint32_t v;
+
+        memcpy(&v, src + 4 * i, 4);
+        v = (v >> 24) | ((v >> 8) & 0xff00U) | ((v << 8) & 0xff0000U) |
+            (v << 24);
+        memcpy(dst + 4 * i, &v, 4);
+    }
+}
+
+static void swap_words8(void *dstp, const void *srcp, int n)
+{
+    unsigned char *dst = (unsigned char *)dstp;
+    const unsigned char *src = (const unsigned char *)srcp;
+    int i;
+
+    for (i = 0; i < n; i++) {
+        uint64_t v;
+
+        memcpy(&v, src + 8 * i, 8);
+        v = ((v & 0x00000000ffffffffULL) << 32) |
+            ((v & 0xffffffff00000000ULL) >> 32);
+        v = ((v & 0x0000ffff0000ffffULL) << 16) |
+            ((v & 0xffff0000ffff0000ULL) >> 16);
+        v = ((v & 0x00ff00ff00ff00ffULL) << 8) |
+            ((v & 0xff00ff00ff00ff00ULL) >> 8);
+        memcpy(dst + 8 * i, &v, 8);
+    }
+}
+
+/*!
+   \brief Convert an array of floats from XDR format
+
+   Source and destination may be the same array.
+
+   \param[out] dst floats
+   \param src floats in XDR format
+   \param n number of floats
+ */
+void G_xdr_get_floats(float *dst, const void *src, int n)
+{
+    if (G__.little_endian)
+        swap_words4(dst, src, n);
+    else if ((const void *)dst != src)
+        memcpy(dst, src, (size_t)n * 4);
+}
+
+/*!
+   \brief Convert an array of floats to XDR format
+
+   Source and destination may be the same array.
+
+   \param[out] dst floats in XDR format
+   \param src floats
+   \param n number of floats
+ */
+void G_xdr_put_floats(void *dst, const float *src, int n)
+{
+    if (G__.little_endian)
+        swap_words4(dst, src, n);
+    else if (dst != (const void *)src)
+        memcpy(dst, src, (size_t)n * 4);
+}
+
+/*!
+   \brief Convert an array of doubles from XDR format
+
+   Source and destination may be the same array.
+
+   \param[out] dst doubles
+   \param src doubles in XDR format
+   \param n number of doubles
+ */
+void G_xdr_get_doubles(double *dst, const void *src, int n)
+{
+    if (G__.little_endian)
+        swap_words8(dst, src, n);
+    else if ((const void *)dst != src)
+        memcpy(dst, src, (size_t)n * 8);
+}
+
+/*!
+   \brief Convert an array of doubles to XDR format
+
+   Source and destination may be the same array.
+
+   \param[out] dst doubles in XDR format
+   \param src doubles
+   \param n number of doubles
+ */
+void G_xdr_put_doubles(void *dst, const double *src, int n)
+{
+    if (G__.little_endian)
+        swap_words8(dst, src, n);
+    else if (dst != (const void *)src)
+        memcpy(dst, src, (size_t)n * 8);
+}
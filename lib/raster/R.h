@@ -3,10 +3,21 @@
 
 #include <gdal.h>
 
+#define XDR_INT_NBYTES    4
 #define XDR_FLOAT_NBYTES  4
 #define XDR_DOUBLE_NBYTES 8
 #define NULL_ROWS_INMEM   8
 
+/* nanoseconds of the modification time of a struct stat, 0 where the
+   system has none */
+#if defined(__APPLE__)
+#define STAT_MTIME_NSEC(st) ((st)->st_mtimespec.tv_nsec)
+#elif defined(_WIN32)
+#define STAT_MTIME_NSEC(st) 0
+#else
+#define STAT_MTIME_NSEC(st) ((st)->st_mtim.tv_nsec)
+#endif
+
 /* if short is 16 bits, then
  *       short will allow 32767 cols
  *       unsigned short will allow 65536 cols
@@ -44,6 +55,114 @@ struct R_vrt {
     struct ilist *tlist;
 };
 
+struct R_job /* Job for the background threads */
+{
+    void (*func)(void *); /* Function to run              */
+    void *closure;        /* Argument of func             */
+    int state;            /* see defines below            */
+    struct R_job *next;   /* Next job in the queue        */
+};
+
+#define JOB_FREE   0
+#define JOB_QUEUED 1
+#define JOB_BUSY   2
+#define JOB_DONE   3
+
+struct R_prefetch_slot /* Row read ahead in the background */
+{
+    struct R_job job;       /* Reading of the row           */
+    int row;                /* Cell file row, -1 if unused  */
+    int has_nulls;          /* Null bits of the row read    */
+    struct Rast_reader *rd; /* Buffers of the slot          */
+};
+
+struct R_prefetch /* Read-ahead of a cursor */
+{
+    int depth;                     /* Number of rows read ahead    */
+    int last_row;                  /* Last window row read         */
+    struct R_prefetch_slot *slots; /* depth slots                  */
+};
+
+struct R_write_slot /* Row of a new map being encoded */
+{
+    struct R_job job;              /* Encoding of the row          */
+    int fd;                        /* Index of the map in fileinfo */
+    int row;                       /* Row, -1 if unused            */
+    int zeros_r_nulls;             /* Zero values are nulls        */
+    const void *src;               /* Row to write                 */
+    void *rast;                    /* Copy of the row              */
+    char *null_buf;                /* Null flags of the row        */
+    unsigned char *work;           /* Row in file format           */
+    unsigned char *cmp;            /* Compressed row               */
+    size_t cmp_size;               /* Allocated size of cmp        */
+    const unsigned char *out;      /* Data to write                */
+    size_t out_size;               /* Size of out                  */
+    int nbytes;                    /* Bytes per cell of int rows   */
+    unsigned char *null_bits;      /* Null bitmap of the row       */
+    unsigned char *null_cmp;       /* Compressed null bitmap       */
+    size_t null_cmp_size;          /* Allocated size of null_cmp   */
+    const unsigned char *null_out; /* Null data to write           */
+    size_t null_out_size;          /* Size of null_out             */
+};
+
+struct R_writer /* Rows of a new map waiting to be written */
+{
+    int nslots;                 /* 1 if rows are encoded at once */
+    int next_row;               /* Next row to write to the files */
+    struct R_write_slot *slots; /* Ring of rows in row order     */
+};
+
+struct R_tile_job /* Tile of a new map being compressed */
+{
+    struct R_job job;    /* Compression of the tile      */
+    int fd;              /* Index of the map in fileinfo */
+    int band;            /* Tile row                     */
+    int col;             /* Tile column                  */
+    unsigned char *tile; /* Tile in file format          */
+    unsigned char *cmp;  /* Compressed tile              */
+    int cmp_size;        /* Allocated size of cmp        */
+    int nwrite;          /* Size of cmp used, <= 0 on error */
+};
+
+/* keeps a tile of DCELLs within the int sizes used by the compressors */
+#define MAX_TILE_SIZE 4096
+
+struct R_tiles /* Tile layout of a tiled cell file */
+{
+    int rows;                /* Rows of cells per tile       */
+    int cols;                /* Columns of cells per tile    */
+    int nrows;               /* Rows of tiles                */
+    int ncols;               /* Columns of tiles             */
+    off_t *ptr;              /* File addresses of the tiles  */
+    unsigned char *band;     /* Rows of the tile row being written */
+    char *null_buf;          /* Null flags of the row written */
+    int njobs;               /* Tiles compressed at once     */
+    struct R_tile_job *jobs; /* njobs tiles being compressed */
+};
+
+struct Rast_reader /* Read cursor over an opened cell file */
+{
+    int fd;                      /* Index of the cell file in fileinfo */
+    int cur_row;                 /* Current data row in memory   */
+    int cur_nbytes;              /* nbytes per cell for current row */
+    unsigned char *data;         /* Decompressed data buffer     */
+    const unsigned char *row;    /* Current row, data or mapped file */
+    int null_cur_row;            /* Current null row in memory   */
+    unsigned char *null_bits;    /* Null bitmap buffer           */
+    unsigned char *cmp;          /* Compressed row read buffer   */
+    size_t cmp_size;             /* Allocated size of cmp        */
+    struct Rast_reader *mask;    /* Own cursor over the mask     */
+    struct R_prefetch *prefetch; /* Read-ahead, NULL if disabled */
+    int tile_band;               /* Tile row held in tile_buf    */
+    unsigned char *tile_buf;     /* Decompressed tile row        */
+    unsigned char *tile_tmp;     /* Decompressed tile            */
+    char *tile_loaded;           /* Tiles of the tile row in tile_buf */
+    int col_lo, col_hi;          /* Window cols whose tiles are needed,
+                                    all if col_hi is 0            */
+    int background;              /* Used by a background thread  */
+    int failed;                  /* Background read failed       */
+};
+
 struct fileinfo /* Information for opened cell files */
 {
     int open_mode;           /* see defines below            */
@@ -56,11 +175,12 @@ struct fileinfo /* Information for opened cell files */
     int reclass_flag;         /* Automatic reclass flag       */
     off_t *row_ptr;           /* File row addresses           */
     COLUMN_MAPPING *col_map;  /* Data to window col mapping   */
+    int col_offset;           /* Data col of window col 0 if the window
+                                 cols are consecutive data cols, else -1 */
     double C1, C2;            /* Data to window row constants */
     int cur_row;              /* Current data row in memory   */
     int null_cur_row;         /* Current null row in memory   */
-    int cur_nbytes;           /* nbytes per cell for current row */
-    unsigned char *data;      /* Decompressed data buffer     */
+    unsigned char *data;      /* Data buffer for writing      */
     int null_fd;              /* Null bitmap fd               */
     unsigned char *null_bits; /* Null bitmap buffer           */
     int nbytes;               /* bytes per cell               */
@@ -76,6 +196,15 @@ struct fileinfo /* Information for opened cell files */
     int data_fd;         /* Raster data fd               */
     off_t *null_row_ptr; /* Null file row addresses      */
     struct R_vrt *vrt;
+    struct Rast_reader *rd; /* Default read cursor of the fd */
+    unsigned char *map;     /* Read-only mapping of the data file */
+    size_t map_size;        /* Size of the mapping           */
+    struct R_writer *wr;    /* Rows not yet written          */
+    struct R_tiles *tiles;  /* Tile layout, NULL if row-based */
+    int overview;           /* Overview level, 0 for the map itself */
+    struct Block_stats *block_stats; /* Collected while writing */
+    int cache_id;      /* Data file in the row cache, 0 if not cached */
+    int null_cache_id; /* Null file in the row cache, 0 if not cached */
 };
 
 struct R__ /*  Structure of library globals */
@@ -87,6 +216,13 @@ struct R__ /*  Structure of library globals */
     int nbytes;
     int compression_type;
     int compress_nulls;
+    int use_mmap;      /* Map data files of old maps into memory */
+    int prefetch_rows; /* Rows to read ahead on old maps */
+    int write_threads; /* Threads encoding rows of new maps */
+    int tile_size;     /* Tile size of new maps, 0 for rows */
+    int use_overviews; /* Read overviews of old maps */
+    int block_stats_size; /* Block size of statistics of new maps */
+    size_t row_cache_size; /* Memory budget of the row cache in bytes */
     int window_set;             /* Flag: window set?                    */
     int split_window;           /* Separate windows for input and output */
     struct Cell_head rd_window; /* Window used for input        */
@@ -0,0 +1,376 @@
+/*!
+   \file lib/raster/block_stats.c
+
+   \brief Raster library - Statistics of blocks of cells
+
+   While a new native map is written, the number of non-null cells,
+   the sum, sum of squares, sum of absolute values, minimum and maximum
+   of its cells are collected per square block of cells (per tile for
+   tiled maps). They are stored at close in cell_misc/<name>/blockstats,
+   so that statistics of regions covering whole blocks can be computed
+   from the blocks instead of from the cells.
+
+   The file holds, in XDR format, the block size in rows and columns,
+   the number of block rows and columns, the size and modification time
+   of the data file and of the null file the statistics were collected
+   for, and six doubles per block: count, sum, sum of squares, sum of
+   absolute values, minimum and maximum. The statistics are ignored
+   when either file has changed, or the null file has been removed or
+   added.
+
+   (C) 2026 by the GRASS Development Team
+
+   This program is free software under the GNU General Public License
+   (>=v2).  Read the file COPYING that comes with GRASS for details.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#include <grass/config.h>
+#include <grass/raster.h>
+#include <grass/glocale.h>
+
+#include "R.h"
+
+#define BLOCK_STATS_FILE "blockstats"
+
+#define HEADER_INTS     4
+#define STAMP_INT64S    6
+#define HEADER_NBYTES   (HEADER_INTS * XDR_INT_NBYTES + STAMP_INT64S * 8)
+#define BLOCK_DOUBLES   6
+#define BLOCK_NBYTES    (BLOCK_DOUBLES * XDR_DOUBLE_NBYTES)
+
+/* size, modification time in seconds and nanoseconds of a file,
+   size -1 if there is none */
+static void stamp_file(grass_int64 *stamp, const struct stat *st)
+{
+    if (!st) {
+        stamp[0] = -1;
+        stamp[1] = stamp[2] = 0;
+        return;
+    }
+
+    stamp[0] = st->st_size;
+    stamp[1] = st->st_mtime;
+    stamp[2] = STAT_MTIME_NSEC(st);
+}
+
+/* stamps of the data file and of the null file of a map, big-endian */
+static void stamp_files(unsigned char *buf, const struct stat *data_st,
+                        const char *name, const char *mapset)
+{
+    char path[GPATH_MAX];
+    grass_int64 stamp[STAMP_INT64S];
+    struct stat st;
+    int i;
+
+    stamp_file(stamp, data_st);
+
+    G_file_name_misc(path, "cell_misc", "nullcmpr", name, mapset);
+    if (stat(path, &st) != 0) {
+        G_file_name_misc(path, "cell_misc", "null", name, mapset);
+        if (stat(path, &st) != 0)
+            stamp_file(stamp + 3, NULL);
+        else
+            stamp_file(stamp + 3, &st);
+    }
+    else
+        stamp_file(stamp + 3, &st);
+
+    for (i = 0; i < STAMP_INT64S * 8; i++)
+        buf[i] = (unsigned char)((unsigned long long)stamp[i / 8] >>
+                                 (8 * (7 - i % 8)));
+}
+
+/*!
+   \brief Set up statistics of the blocks of a new map (internal use only)
+
+   \param cellhd cell header of the map
+   \param rows rows of cells per block
+   \param cols columns of cells per block
+
+   \return pointer to block statistics
+ */
+struct Block_stats *Rast__alloc_block_stats(const struct Cell_head *cellhd,
+                                            int rows, int cols)
+{
+    struct Block_stats *bs = G_malloc(sizeof(struct Block_stats));
+
+    bs->rows = rows;
+    bs->cols = cols;
+    bs->nrows = (cellhd->rows + rows - 1) / rows;
+    bs->ncols = (cellhd->cols + cols - 1) / cols;
+    bs->blocks =
+        G_calloc((size_t)bs->nrows * bs->ncols, sizeof(struct Block_stat));
+
+    return bs;
+}
+
+/*!
+   \brief Add a row of a new map to its block statistics (internal use
+   only)
+
+   \param fd file descriptor of a map opened for writing
+   \param rast row in the type of the map
+   \param zeros_r_nulls zeros of integer maps are written as nulls
+ */
+void Rast__update_block_stats(int fd, const void *rast, int zeros_r_nulls)
+{
+    struct fileinfo *fcb = &R__.fileinfo[fd];
+    struct Block_stats *bs = fcb->block_stats;
+    struct Block_stat *b =
+        &bs->blocks[(size_t)(fcb->cur_row / bs->rows) * bs->ncols];
+    size_t size = Rast_cell_size(fcb->map_type);
+    int col, left = bs->cols;
+
+    for (col = 0; col < fcb->cellhd.cols; col++) {
+        DCELL val;
+
+        if (left-- == 0) {
+            b++;
+            left = bs->cols - 1;
+        }
+
+        if (Rast_is_null_value(rast, fcb->map_type)) {
+            rast = G_incr_void_ptr(rast, size);
+            continue;
+        }
+
+        switch (fcb->map_type) {
+        case CELL_TYPE:
+            val = *(const CELL *)rast;
+            break;
+        case FCELL_TYPE:
+            val = *(const FCELL *)rast;
+            break;
+        default:
+            val = *(const DCELL *)rast;
+            break;
+        }
+        rast = G_incr_void_ptr(rast, size);
+
+        if (zeros_r_nulls && fcb->map_type == CELL_TYPE && val == 0)
+            continue;
+
+        if (b->count == 0 || val < b->min)
+            b->min = val;
+        if (b->count == 0 || val > b->max)
+            b->max = val;
+        b->sum += val;
+        b->sumsq += val * val;
+        b->sum_abs += fabs(val);
+        b->count++;
+    }
+}
+
+/*!
+   \brief Store the block statistics of a new map (internal use only)
+
+   Removes those of an earlier map of the same name if none were
+   collected.
+
+   \param fd file descriptor of a map opened for writing, all rows
+   written, its null file in place
+ */
+void Rast__write_block_stats(int fd)
+{
+    struct fileinfo *fcb = &R__.fileinfo[fd];
+    struct Block_stats *bs = fcb->block_stats;
+    unsigned char hdr[HEADER_NBYTES], buf[BLOCK_NBYTES];
+    struct stat st;
+    size_t i, n;
+    int hd[HEADER_INTS];
+    FILE *fp;
+
+    if (!bs || fstat(fcb->data_fd, &st) != 0) {
+        Rast_remove_block_stats(fcb->name);
+        return;
+    }
+
+    fp = G_fopen_new_misc("cell_misc", BLOCK_STATS_FILE, fcb->name);
+    if (!fp) {
+        G_warning(_("Unable to write block statistics of <%s>"), fcb->name);
+        Rast_remove_block_stats(fcb->name);
+        return;
+    }
+
+    hd[0] = bs->rows;
+    hd[1] = bs->cols;
+    hd[2] = bs->nrows;
+    hd[3] = bs->ncols;
+    for (i = 0; i < HEADER_INTS; i++)
+        G_xdr_put_int(hdr + i * XDR_INT_NBYTES, &hd[i]);
+    stamp_files(hdr + HEADER_INTS * XDR_INT_NBYTES, &st, fcb->name,
+                G_mapset());
+    fwrite(hdr, 1, HEADER_NBYTES, fp);
+
+    n = (size_t)bs->nrows * bs->ncols;
+    for (i = 0; i < n; i++) {
+        const struct Block_stat *b = &bs->blocks[i];
+        DCELL v[BLOCK_DOUBLES];
+        int j;
+
+        v[0] = b->count;
+        v[1] = b->sum;
+        v[2] = b->sumsq;
+        v[3] = b->sum_abs;
+        v[4] = b->min;
+        v[5] = b->max;
+        for (j = 0; j < BLOCK_DOUBLES; j++)
+            G_xdr_put_double(buf + j * XDR_DOUBLE_NBYTES, &v[j]);
+        fwrite(buf, 1, BLOCK_NBYTES, fp);
+    }
+
+    if (fflush(fp) != 0 || ferror(fp)) {
+        G_warning(_("Unable to write block statistics of <%s>"), fcb->name);
+        fclose(fp);
+        Rast_remove_block_stats(fcb->name);
+        return;
+    }
+
+    fclose(fp);
+}
+
+/*!
+   \brief Remove the block statistics of a raster map
+
+   Needed when the cells or null values of a map are changed without
+   rewriting the map.
+
+   \param name map name in the current mapset
+ */
+void Rast_remove_block_stats(const char *name)
+{
+    G_remove_misc("cell_misc", BLOCK_STATS_FILE, name);
+}
+
+/*!
+   \brief Read the block statistics of a raster map
+
+   Blocks are numbered row by row from the top left corner of the map,
+   those in the last block row and column are cut to the size of the
+   map. Null cells are not counted. The minimum and maximum of blocks
+   without non-null cells are undefined.
+
+   \param name map name
+   \param mapset mapset name
+   \param[out] bs block statistics, to be released with
+   Rast_free_block_stats()
+
+   \return 1 on success
+   \return -1 if the map has no block statistics or they are out of date
+ */
+int Rast_read_block_stats(const char *name, const char *mapset,
+                          struct Block_stats *bs)
+{
+    char rname[GNAME_MAX], rmapset[GMAPSET_MAX];
+    char path[GPATH_MAX];
+    unsigned char hdr[HEADER_NBYTES], buf[BLOCK_NBYTES];
+    struct Cell_head cellhd;
+    struct stat st;
+    unsigned char stamp[STAMP_INT64S * 8];
+    size_t i, n;
+    int hd[HEADER_INTS];
+    FILE *fp;
+
+    Rast_init();
+
+    bs->blocks = NULL;
+
+    if (Rast_is_reclass(name, mapset, rname, rmapset) > 0)
+        return -1;
+
+    fp = G_fopen_old_misc("cell_misc", BLOCK_STATS_FILE, name, mapset);
+    if (!fp)
+        return -1;
+
+    if (fread(hdr, 1, HEADER_NBYTES, fp) != HEADER_NBYTES) {
+        fclose(fp);
+        return -1;
+    }
+    for (i = 0; i < HEADER_INTS; i++)
+        G_xdr_get_int(&hd[i], hdr + i * XDR_INT_NBYTES);
+
+    /* the data and null files must be those the statistics were
+       collected for */
+    Rast_get_cellhd(name, mapset, &cellhd);
+    G_file_name(path, Rast_map_is_fp(name, mapset) ? "fcell" : "cell", name,
+                mapset);
+    stamp_files(stamp, stat(path, &st) == 0 ? &st : NULL, name, mapset);
+    if (hd[0] <= 0 || hd[1] <= 0 ||
+        hd[2] != (cellhd.rows + hd[0] - 1) / hd[0] ||
+        hd[3] != (cellhd.cols + hd[1] - 1) / hd[1] ||
+        memcmp(stamp, hdr + HEADER_INTS * XDR_INT_NBYTES, sizeof(stamp)) !=
+            0) {
+        G_debug(1, "Block statistics of <%s@%s> out of date", name, mapset);
+        fclose(fp);
+        return -1;
+    }
+
+    bs->rows = hd[0];
+    bs->cols = hd[1];
+    bs->nrows = hd[2];
+    bs->ncols = hd[3];
+    n = (size_t)bs->nrows * bs->ncols;
+    bs->blocks = G_malloc(n * sizeof(struct Block_stat));
+
+    for (i = 0; i < n; i++) {
+        struct Block_stat *b = &bs->blocks[i];
+        DCELL v[BLOCK_DOUBLES];
+        int j;
+
+        if (fread(buf, 1, BLOCK_NBYTES, fp) != BLOCK_NBYTES) {
+            G_debug(1, "Block statistics of <%s@%s> truncated", name, mapset);
+            fclose(fp);
+            Rast_free_block_stats(bs);
+            return -1;
+        }
+        for (j = 0; j < BLOCK_DOUBLES; j++)
+            G_xdr_get_double(&v[j], buf + j * XDR_DOUBLE_NBYTES);
+        b->count = (grass_int64)v[0];
+        b->sum = v[1];
+        b->sumsq = v[2];
+        b->sum_abs = v[3];
+        b->min = v[4];
+        b->max = v[5];
+    }
+
+    fclose(fp);
+
+    return 1;
+}
+
+/*!
+   \brief Release block statistics read by Rast_read_block_stats()
+
+   \param bs block statistics
+ */
+void Rast_free_block_stats(struct Block_stats *bs)
+{
+    G_free(bs->blocks);
+    bs->blocks = NULL;
+}
+
+/*!
+   \brief Set the block size of the statistics of new raster maps
+
+   Block statistics are collected for native maps subsequently opened
+   with Rast_open_new() and friends, in square blocks of <i>size</i> by
+   <i>size</i> cells, or per tile for tiled maps. The default is taken
+   from the GRASS_RASTER_BLOCK_STATS environment variable, 0 (no block
+   statistics) if unset.
+
+   \param size block size in cells, 0 to collect no block statistics
+ */
+void Rast_set_block_stats_size(int size)
+{
+    Rast__init();
+
+    R__.block_stats_size = size > 0 ? size : 0;
+}
@@ -39,7 +39,7 @@
 static int close_old(int);
 static int close_new(int, int);
 
-static void sync_and_close(int fd, char *element, char *name)
+static void sync_and_close(int fd, const char *element, const char *name)
 {
     /* from man 2 write:
      * A successful return from write() does not make any guarantee
@@ -182,8 +182,14 @@ static int close_old(int fd)
     if (fcb->vrt)
         Rast_close_vrt(fcb->vrt);
 
-    if (fcb->null_bits)
-        G_free(fcb->null_bits);
+    Rast__free_reader(fcb->rd);
+    fcb->rd = NULL;
+    Rast__free_tiles(fcb->tiles);
+    fcb->tiles = NULL;
+    Rast__unmap_data_file(fd);
+    Rast__release_row_cache_id(fcb->cache_id);
+    Rast__release_row_cache_id(fcb->null_cache_id);
+    fcb->cache_id = fcb->null_cache_id = 0;
     if (fcb->null_row_ptr)
         G_free(fcb->null_row_ptr);
     if (fcb->null_fd >= 0)
@@ -194,7 +200,6 @@ static int close_old(int fd)
         G_free(fcb->row_ptr);
     G_free(fcb->col_map);
     G_free(fcb->mapset);
-    G_free(fcb->data);
     G_free(fcb->name);
     if (fcb->reclass_flag)
         Rast_free_reclass(&fcb->reclass);
@@ -339,6 +344,10 @@ static int close_new_gdal(int fd, int ok)
             remove(path);
         }
 
+        Rast__write_tile_info(fd);
+        Rast_remove_block_stats(fcb->name);
+        Rast_remove_overviews(fcb->name);
+
         if (Rast_close_gdal_write_link(fcb->gdal) < 0)
             stat = -1;
     }
@@ -371,10 +380,21 @@ static int close_new(int fd, int ok)
     char path[GPATH_MAX];
     int row;
     const char *CELL_DIR;
+    const char *null_file = NULL_FILE, *nullc_file = NULLC_FILE;
+    char element[GNAME_MAX], null_element[GNAME_MAX];
+    char nullc_element[GNAME_MAX];
 
     if (fcb->gdal)
         return close_new_gdal(fd, ok);
 
+    /* overview levels have null files of their own */
+    if (fcb->overview) {
+        null_file =
+            Rast__overview_element(null_element, fcb->overview, NULL_FILE);
+        nullc_file =
+            Rast__overview_element(nullc_element, fcb->overview, NULLC_FILE);
+    }
+
     if (ok) {
         switch (fcb->open_mode) {
         case OPEN_NEW_COMPRESSED:
@@ -393,6 +413,9 @@ static int close_new(int fd, int ok)
             fcb->data = NULL;
         }
 
+        /* rows may still be compressed in the background */
+        Rast__flush_writer(fd);
+
         if (fcb->null_row_ptr) { /* compressed nulls */
             fcb->null_row_ptr[fcb->cellhd.rows] =
                 lseek(fcb->null_fd, 0L, SEEK_CUR);
@@ -406,20 +429,20 @@ static int close_new(int fd, int ok)
 
         if (fcb->null_fd >= 0) {
             sync_and_close(fcb->null_fd,
-                           (fcb->null_row_ptr ? NULLC_FILE : NULL_FILE),
+                           (fcb->null_row_ptr ? nullc_file : null_file),
                            fcb->name);
         }
         fcb->null_fd = -1;
 
         /* create path : full null file name */
         G__make_mapset_element_misc("cell_misc", fcb->name);
-        G_file_name_misc(path, "cell_misc", NULL_FILE, fcb->name, G_mapset());
+        G_file_name_misc(path, "cell_misc", null_file, fcb->name, G_mapset());
         remove(path);
-        G_file_name_misc(path, "cell_misc", NULLC_FILE, fcb->name, G_mapset());
+        G_file_name_misc(path, "cell_misc", nullc_file, fcb->name, G_mapset());
         remove(path);
 
         G_file_name_misc(path, "cell_misc",
-                         fcb->null_row_ptr ? NULLC_FILE : NULL_FILE, fcb->name,
+                         fcb->null_row_ptr ? nullc_file : null_file, fcb->name,
                          G_mapset());
 
         if (fcb->null_cur_row > 0) {
@@ -440,7 +463,19 @@ static int close_new(int fd, int ok)
             remove(path); /* again ? */
         } /* null_cur_row > 0 */
 
-        if (fcb->open_mode == OPEN_NEW_COMPRESSED) { /* auto compression */
+        if (fcb->open_mode == OPEN_NEW_COMPRESSED && fcb->tiles) {
+            struct R_tiles *tl = fcb->tiles;
+            int ntiles = tl->nrows * tl->ncols;
+
+            tl->ptr[ntiles] = lseek(fcb->data_fd, 0L, SEEK_CUR);
+            if (tl->ptr[ntiles] == -1) {
+                int err = errno;
+                G_fatal_error(_("File read/write operation failed: %s (%d)"),
+                              strerror(err), err);
+            }
+            Rast__write_tile_ptrs(fd);
+        }
+        else if (fcb->open_mode == OPEN_NEW_COMPRESSED) { /* auto compression */
             fcb->row_ptr[fcb->cellhd.rows] = lseek(fcb->data_fd, 0L, SEEK_CUR);
             if (fcb->row_ptr[fcb->cellhd.rows] == -1) {
                 int err = errno;
@@ -450,7 +485,16 @@ static int close_new(int fd, int ok)
             Rast__write_row_ptrs(fd);
         }
 
-        if (fcb->map_type != CELL_TYPE) { /* floating point map */
+        if (!fcb->overview) {
+            Rast__write_tile_info(fd);
+            Rast__write_block_stats(fd);
+            /* overviews of an earlier map of the name are stale now */
+            Rast_remove_overviews(fcb->name);
+        }
+
+        if (fcb->overview)
+            CELL_DIR = NULL; /* stored in cell_misc, see below */
+        else if (fcb->map_type != CELL_TYPE) { /* floating point map */
             int cell_fd;
 
             write_fp_format(fd);
@@ -473,6 +517,17 @@ static int close_new(int fd, int ok)
             CELL_DIR = "cell";
         }
     } /* ok */
+
+    Rast__free_writer(fcb->wr);
+    fcb->wr = NULL;
+    Rast__free_tiles(fcb->tiles);
+    fcb->tiles = NULL;
+    if (fcb->block_stats) {
+        Rast_free_block_stats(fcb->block_stats);
+        G_free(fcb->block_stats);
+        fcb->block_stats = NULL;
+    }
+
     /* NOW CLOSE THE FILE DESCRIPTOR */
 
     sync_and_close(fcb->data_fd,
@@ -500,7 +555,13 @@ static int close_new(int fd, int ok)
      */
     stat = 1;
     if (ok && (fcb->temp_name != NULL)) {
-        G_file_name(path, CELL_DIR, fcb->name, fcb->mapset);
+        if (fcb->overview)
+            G_file_name_misc(path, "cell_misc",
+                             Rast__overview_element(element, fcb->overview,
+                                                    NULL),
+                             fcb->name, fcb->mapset);
+        else
+            G_file_name(path, CELL_DIR, fcb->name, fcb->mapset);
         remove(path);
         if (rename(fcb->temp_name, path)) {
             G_warning(_("Unable to rename cell file '%s' to '%s': %s"),
@@ -517,7 +578,7 @@ static int close_new(int fd, int ok)
         G_free(fcb->temp_name);
     }
 
-    if (ok)
+    if (ok && !fcb->overview)
         write_support_files(fd);
 
     G_free(fcb->name);
@@ -572,6 +633,10 @@ void Rast__close_null(int fd)
 
     G_free(fcb->null_temp_name);
 
+    /* overviews and block statistics hold the old null values */
+    Rast_remove_overviews(fcb->name);
+    Rast_remove_block_stats(fcb->name);
+
     G_free(fcb->name);
     G_free(fcb->mapset);
 
@@ -85,6 +85,10 @@ int Rast__check_format(int fd)
     if (!fcb->cellhd.compressed)
         return 1;
 
+    /* tiled file, the tile address array is allocated with the layout */
+    if (fcb->tiles)
+        return Rast__read_tile_ptrs(fd);
+
     /* allocate space to hold the row address array */
     fcb->row_ptr = G_calloc(fcb->cellhd.rows + 1, sizeof(off_t));
 
@@ -170,6 +174,25 @@ int Rast__read_row_ptrs(int fd)
     return 1;
 }
 
+/* tiled files start with a zero byte in the place of the size of the
+   row addresses, which versions without tiles reject, followed by the
+   tile addresses */
+int Rast__read_tile_ptrs(int fd)
+{
+    struct fileinfo *fcb = &R__.fileinfo[fd];
+    int ntiles = fcb->tiles->nrows * fcb->tiles->ncols;
+    unsigned char marker;
+
+    if (read(fcb->data_fd, &marker, 1) != 1 || marker != 0 ||
+        read_row_ptrs(ntiles, 0, fcb->tiles->ptr, fcb->data_fd) < 0) {
+        G_warning(_("Fail of initial read of tiled file [%s in %s]"),
+                  fcb->name, fcb->mapset);
+        return -1;
+    }
+
+    return 1;
+}
+
 int Rast__read_null_row_ptrs(int fd, int null_fd)
 {
     struct fileinfo *fcb = &R__.fileinfo[fd];
@@ -184,13 +207,13 @@ int Rast__read_null_row_ptrs(int fd, int null_fd)
     return 1;
 }
 
-static int write_row_ptrs(int nrows, off_t *row_ptr, int fd)
+static int write_row_ptrs(int nrows, off_t *row_ptr, int fd, off_t offset)
 {
     int nbytes = sizeof(off_t);
     unsigned char *buf, *b;
     int len, row, result;
 
-    if (lseek(fd, 0L, SEEK_SET) == -1) {
+    if (lseek(fd, offset, SEEK_SET) == -1) {
         int err = errno;
         G_fatal_error(_("File read/write operation failed: %s (%d)"),
                       strerror(err), err);
@@ -223,7 +246,20 @@ int Rast__write_row_ptrs(int fd)
     struct fileinfo *fcb = &R__.fileinfo[fd];
     int nrows = fcb->cellhd.rows;
 
-    return write_row_ptrs(nrows, fcb->row_ptr, fcb->data_fd);
+    return write_row_ptrs(nrows, fcb->row_ptr, fcb->data_fd, 0);
+}
+
+int Rast__write_tile_ptrs(int fd)
+{
+    struct fileinfo *fcb = &R__.fileinfo[fd];
+    int ntiles = fcb->tiles->nrows * fcb->tiles->ncols;
+    unsigned char marker = 0;
+
+    if (lseek(fcb->data_fd, 0L, SEEK_SET) == -1 ||
+        write(fcb->data_fd, &marker, 1) != 1)
+        return 0;
+
+    return write_row_ptrs(ntiles, fcb->tiles->ptr, fcb->data_fd, 1);
 }
 
 int Rast__write_null_row_ptrs(int fd, int null_fd)
@@ -231,5 +267,5 @@ int Rast__write_null_row_ptrs(int fd, int null_fd)
     struct fileinfo *fcb = &R__.fileinfo[fd];
     int nrows = fcb->cellhd.rows;
 
-    return write_row_ptrs(nrows, fcb->null_row_ptr, null_fd);
+    return write_row_ptrs(nrows, fcb->null_row_ptr, null_fd, 0);
 }
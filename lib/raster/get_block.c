@@ -0,0 +1,229 @@
+/*!
+   \file lib/raster/get_block.c
+
+   \brief Raster library - Get block of raster cells
+
+   Reads a rectangular block of the current region into a 2D buffer in
+   one call, instead of modules reading rows and copying the columns
+   they need into arrays of their own. Cells of the block outside the
+   region are set to null.
+
+   Of tiled maps only the tiles overlapping the block are decompressed.
+   Blocks of many rows are read by several threads, each with a reader
+   of its own, when OpenMP is enabled.
+
+   (C) 2026 by the GRASS Development Team
+
+   This program is free software under the GNU General Public License
+   (>=v2).  Read the file COPYING that comes with GRASS for details.
+ */
+
+#include <string.h>
+
+#if defined(_OPENMP)
+#include <omp.h>
+#endif
+
+#include <grass/config.h>
+#include <grass/raster.h>
+#include <grass/glocale.h>
+
+#include "R.h"
+
+/* rows per thread worth the allocation of a reader */
+#define ROWS_PER_THREAD 16
+
+/* read rows [first, last) of the block through reader rd */
+static void read_rows(struct Rast_reader *rd, void *buf, int row, int col,
+                      int first, int last, int ncols,
+                      RASTER_MAP_TYPE data_type)
+{
+    struct fileinfo *fcb = &R__.fileinfo[rd->fd];
+    size_t size = Rast_cell_size(data_type);
+    int wrows = R__.rd_window.rows, wcols = R__.rd_window.cols;
+    int c0 = col > 0 ? col : 0;
+    int c1 = col + ncols < wcols ? col + ncols : wcols;
+    void *row_buf = NULL;
+    int i;
+
+    if (c0 < c1) {
+        row_buf = Rast_allocate_input_buf(data_type);
+
+        /* decompress only the tiles overlapping the block */
+        rd->col_lo = c0;
+        rd->col_hi = c1;
+    }
+
+    for (i = first; i < last; i++) {
+        unsigned char *dst =
+            (unsigned char *)buf + (size_t)i * ncols * size;
+
+        if (row + i < 0 || row + i >= wrows || c0 >= c1) {
+            Rast_set_null_value(dst, ncols, data_type);
+            continue;
+        }
+
+        Rast_reader_get_row(rd, row_buf, row + i, data_type);
+
+        if (c0 > col)
+            Rast_set_null_value(dst, c0 - col, data_type);
+        memcpy(dst + (size_t)(c0 - col) * size,
+               (unsigned char *)row_buf + (size_t)c0 * size,
+               (size_t)(c1 - c0) * size);
+        if (col + ncols > c1)
+            Rast_set_null_value(dst + (size_t)(c1 - col) * size,
+                                col + ncols - c1, data_type);
+    }
+
+    if (row_buf) {
+        rd->col_lo = rd->col_hi = 0;
+        /* the last tile row read holds only the tiles of the block */
+        if (fcb->tiles)
+            rd->cur_row = -1;
+        G_free(row_buf);
+    }
+}
+
+/*!
+   \brief Read a block of raster cells through a reader
+
+   Same as Rast_get_block() but uses the buffers of the reader
+   <em>rd</em>, see Rast_reader_get_row(), and reads all rows with the
+   calling thread.
+
+   \param rd reader created by Rast_open_reader()
+   \param buf buffer for nrows * ncols cells, row by row
+   \param row window row of the top left cell of the block
+   \param col window column of the top left cell of the block
+   \param nrows number of rows of the block
+   \param ncols number of columns of the block
+   \param data_type data type of buf
+
+   \return void
+ */
+void Rast_reader_get_block(struct Rast_reader *rd, void *buf, int row,
+                           int col, int nrows, int ncols,
+                           RASTER_MAP_TYPE data_type)
+{
+    read_rows(rd, buf, row, col, 0, nrows, ncols, data_type);
+}
+
+/*!
+   \brief Read a block of raster cells
+
+   Fills <em>buf</em> with the cells of the <em>nrows</em> by
+   <em>ncols</em> block of the current region whose top left cell is
+   at window row <em>row</em> and window column <em>col</em>, row by
+   row and converted to <em>data_type</em>. The mask is applied as by
+   Rast_get_row(). Cells outside the region are set to null, so the
+   block may extend beyond the region, e.g. for the borders of a
+   moving window.
+
+   Blocks of many rows of native maps are read in parallel when the
+   library is built with OpenMP, with the number of threads set for
+   OpenMP (see G_set_omp_num_threads()). Rast_get_block() must not be
+   called from parallel code, use Rast_reader_get_block() there.
+
+   \param fd file descriptor for the opened raster map
+   \param buf buffer for nrows * ncols cells, row by row
+   \param row window row of the top left cell of the block
+   \param col window column of the top left cell of the block
+   \param nrows number of rows of the block
+   \param ncols number of columns of the block
+   \param data_type data type of buf
+
+   \return void
+ */
+void Rast_get_block(int fd, void *buf, int row, int col, int nrows, int ncols,
+                    RASTER_MAP_TYPE data_type)
+{
+    struct fileinfo *fcb = &R__.fileinfo[fd];
+
+    if (nrows <= 0 || ncols <= 0)
+        return;
+
+#if defined(_OPENMP)
+    {
+        int threads = omp_get_max_threads();
+
+        if (threads > nrows / ROWS_PER_THREAD)
+            threads = nrows / ROWS_PER_THREAD;
+
+        if (threads > 1 && !omp_in_parallel() && !fcb->gdal && !fcb->vrt) {
+#pragma omp parallel num_threads(threads)
+            {
+                struct Rast_reader *rd = Rast_open_reader(fd);
+                int t = omp_get_thread_num(), n = omp_get_num_threads();
+
+                read_rows(rd, buf, row, col, (int)((long)nrows * t / n),
+                          (int)((long)nrows * (t + 1) / n), ncols, data_type);
+
+                Rast_close_reader(rd);
+            }
+            return;
+        }
+    }
+#endif
+
+    read_rows(fcb->rd, buf, row, col, 0, nrows, ncols, data_type);
+}
+
+/*!
+   \brief Read a block of raster cells (CELL version)
+
+   See Rast_get_block() for details.
+
+   \param fd file descriptor for the opened raster map
+   \param buf buffer for nrows * ncols cells, row by row
+   \param row window row of the top left cell of the block
+   \param col window column of the top left cell of the block
+   \param nrows number of rows of the block
+   \param ncols number of columns of the block
+
+   \return void
+ */
+void Rast_get_c_block(int fd, CELL *buf, int row, int col, int nrows,
+                      int ncols)
+{
+    Rast_get_block(fd, buf, row, col, nrows, ncols, CELL_TYPE);
+}
+
+/*!
+   \brief Read a block of raster cells (FCELL version)
+
+   See Rast_get_block() for details.
+
+   \param fd file descriptor for the opened raster map
+   \param buf buffer for nrows * ncols cells, row by row
+   \param row window row of the top left cell of the block
+   \param col window column of the top left cell of the block
+   \param nrows number of rows of the block
+   \param ncols number of columns of the block
+
+   \return void
+ */
+void Rast_get_f_block(int fd, FCELL *buf, int row, int col, int nrows,
+                      int ncols)
+{
+    Rast_get_block(fd, buf, row, col, nrows, ncols, FCELL_TYPE);
+}
+
+/*!
+   \brief Read a block of raster cells (DCELL version)
+
+   See Rast_get_block() for details.
+
+   \param fd file descriptor for the opened raster map
+   \param buf buffer for nrows * ncols cells, row by row
+   \param row window row of the top left cell of the block
+   \param col window column of the top left cell of the block
+   \param nrows number of rows of the block
+   \param ncols number of columns of the block
+
+   \return void
+ */
+void Rast_get_d_block(int fd, DCELL *buf, int row, int col, int nrows,
+                      int ncols)
+{
+    Rast_get_block(fd, buf, row, col, nrows, ncols, DCELL_TYPE);
+}
@@ -11,6 +11,7 @@
    \author Original author CERL
  */
 
+#include <stdarg.h>
 #include <stdint.h>
 #include <string.h>
 #include <unistd.h>
@@ -23,7 +24,72 @@
 
 #include "R.h"
 
-static void embed_nulls(int, void *, int, RASTER_MAP_TYPE, int, int);
+static void embed_nulls(struct Rast_reader *, void *, int, RASTER_MAP_TYPE,
+                        int, int);
+static int read_null_bits_row(struct Rast_reader *, int, unsigned char *);
+
+/* read exactly size bytes at offset without moving the file position,
+   so that several read cursors can share one file descriptor */
+static ssize_t read_at(int fd, void *buf, size_t size, off_t offset)
+{
+#ifndef _WIN32
+    size_t total = 0;
+
+    while (total < size) {
+        ssize_t n = pread(fd, (char *)buf + total, size - total,
+                          offset + (off_t)total);
+
+        if (n <= 0)
+            return -1;
+        total += n;
+    }
+
+    return total;
+#else
+    ssize_t n;
+
+#pragma omp critical(Rast_read_at)
+    {
+        if (lseek(fd, offset, SEEK_SET) == -1)
+            n = -1;
+        else
+            n = read(fd, buf, size);
+    }
+
+    return n;
+#endif
+}
+
+/* error reading a row: fatal, except for cursors of the background
+   threads which only record it, the row is then read again by the
+   thread wanting it and the error reported there */
+static void read_error(struct Rast_reader *rd, const char *msg, ...)
+{
+    va_list ap;
+    char *buf;
+
+    if (rd->background) {
+        rd->failed = 1;
+        return;
+    }
+
+    va_start(ap, msg);
+    G_vasprintf(&buf, msg, ap);
+    va_end(ap);
+
+    G_fatal_error("%s", buf);
+}
+
+/* make sure the compressed row buffer of the cursor holds size bytes */
+static unsigned char *get_cmp_buf(struct Rast_reader *rd, size_t size)
+{
+    if (size > rd->cmp_size) {
+        rd->cmp = G_realloc(rd->cmp, size);
+        rd->cmp_size = size;
+    }
+
+    return rd->cmp;
+}
 
 static int compute_window_row(int fd, int row, int *cellRow)
 {
@@ -83,29 +149,63 @@ static void do_reclass_int(int fd, void *cell, int null_is_zero)
     }
 }
 
-static void read_data_fp_compressed(int fd, int row, unsigned char *data_buf,
-                                    int *nbytes)
+/* get size bytes of the data file at offset, as pointer into the mapped
+   file if available, otherwise read into the compressed row buffer */
+static unsigned char *get_raw_data(struct Rast_reader *rd, int row,
+                                   off_t offset, size_t size)
 {
-    struct fileinfo *fcb = &R__.fileinfo[fd];
+    struct fileinfo *fcb = &R__.fileinfo[rd->fd];
+    unsigned char *buf;
+
+    if (fcb->map) {
+        if (offset < 0 || (size_t)offset + size > fcb->map_size) {
+            read_error(rd,
+                       _("Raster data for row %d of <%s> is beyond the end "
+                         "of the file"),
+                       row, fcb->name);
+            return NULL;
+        }
+        return fcb->map + offset;
+    }
+
+    buf = get_cmp_buf(rd, size);
+
+    if (read_at(fcb->data_fd, buf, size, offset) != (ssize_t)size) {
+        read_error(rd, _("Error reading raster data for row %d of <%s>: %s"),
+                   row, fcb->name, strerror(errno));
+        return NULL;
+    }
+
+    return buf;
+}
+
+static const unsigned char *read_data_fp_compressed(struct Rast_reader *rd,
+                                                    int row,
+                                                    unsigned char *data_buf,
+                                                    int *nbytes)
+{
+    struct fileinfo *fcb = &R__.fileinfo[rd->fd];
     off_t t1 = fcb->row_ptr[row];
     off_t t2 = fcb->row_ptr[row + 1];
     size_t readamount = t2 - t1;
     size_t bufsize = fcb->cellhd.cols * fcb->nbytes;
+    unsigned char *cmp = get_raw_data(rd, row, t1, readamount);
     int ret;
 
-    if (lseek(fcb->data_fd, t1, SEEK_SET) == -1)
-        G_fatal_error(
-            _("Error seeking fp raster data file for row %d of <%s>: %s"), row,
-            fcb->name, strerror(errno));
-
     *nbytes = fcb->nbytes;
 
-    ret = G_read_compressed(fcb->data_fd, readamount, data_buf, bufsize,
-                            fcb->cellhd.compressed);
+    if (!cmp)
+        return data_buf;
+
+    ret = G_expand_compressed(cmp, readamount, data_buf, bufsize,
+                              fcb->cellhd.compressed);
     if (ret <= 0)
-        G_fatal_error(_("Error uncompressing fp raster data for row %d of "
-                        "<%s>: error code %d"),
-                      row, fcb->name, ret);
+        read_error(rd,
+                   _("Error uncompressing fp raster data for row %d of "
+                     "<%s>: error code %d"),
+                   row, fcb->name, ret);
+
+    return data_buf;
 }
 
 static void rle_decompress(unsigned char *dst, const unsigned char *src,
@@ -127,33 +227,24 @@ static void rle_decompress(unsigned char *dst, const unsigned char *src,
     }
 }
 
-static void read_data_compressed(int fd, int row, unsigned char *data_buf,
-                                 int *nbytes)
+static const unsigned char *read_data_compressed(struct Rast_reader *rd,
+                                                 int row,
+                                                 unsigned char *data_buf,
+                                                 int *nbytes)
 {
-    struct fileinfo *fcb = &R__.fileinfo[fd];
+    struct fileinfo *fcb = &R__.fileinfo[rd->fd];
     off_t t1 = fcb->row_ptr[row];
     off_t t2 = fcb->row_ptr[row + 1];
     ssize_t readamount = t2 - t1;
     size_t bufsize;
-    unsigned char *cmp, *cmp2;
+    unsigned char *cmp = get_raw_data(rd, row, t1, readamount);
     int n;
 
-    if (lseek(fcb->data_fd, t1, SEEK_SET) == -1)
-        G_fatal_error(
-            _("Error seeking raster data file for row %d of <%s>: %s"), row,
-            fcb->name, strerror(errno));
-
-    cmp = G_malloc(readamount);
-
-    if (read(fcb->data_fd, cmp, readamount) != readamount) {
-        G_free(cmp);
-        G_fatal_error(_("Error reading raster data for row %d of <%s>: %s"),
-                      row, fcb->name, strerror(errno));
+    if (!cmp) {
+        *nbytes = fcb->nbytes;
+        return data_buf;
     }
 
-    /* save cmp for free below */
-    cmp2 = cmp;
-
     /* Now decompress the row */
     if (fcb->cellhd.compressed > 0) {
         /* one byte is nbyte count */
@@ -172,39 +263,51 @@ static void read_data_compressed(int fd, int row, unsigned char *data_buf,
             if ((n = G_expand(cmp, readamount, data_buf, bufsize,
                               fcb->cellhd.compressed)) < 0 ||
                 (unsigned int)n != bufsize) {
-                G_fatal_error(
-                    _("Error uncompressing raster data for row %d of <%s>"),
+                read_error(
+                    rd, _("Error uncompressing raster data for row %d of <%s>"),
                     row, fcb->name);
             }
         }
     }
+    else if (fcb->map)
+        /* row stored as is, use it in place */
+        return cmp;
     else
         memcpy(data_buf, cmp, readamount);
 
-    G_free(cmp2);
+    return data_buf;
 }
 
-static void read_data_uncompressed(int fd, int row, unsigned char *data_buf,
-                                   int *nbytes)
+static const unsigned char *read_data_uncompressed(struct Rast_reader *rd,
+                                                   int row,
+                                                   unsigned char *data_buf,
+                                                   int *nbytes)
 {
-    struct fileinfo *fcb = &R__.fileinfo[fd];
+    struct fileinfo *fcb = &R__.fileinfo[rd->fd];
     ssize_t bufsize = fcb->cellhd.cols * fcb->nbytes;
 
     *nbytes = fcb->nbytes;
 
-    if (lseek(fcb->data_fd, (off_t)row * bufsize, SEEK_SET) == -1)
-        G_fatal_error(_("Error reading raster data for row %d of <%s>"), row,
-                      fcb->name);
+    if (fcb->map) {
+        const unsigned char *raw =
+            get_raw_data(rd, row, (off_t)row * bufsize, bufsize);
+
+        return raw ? raw : data_buf;
+    }
 
-    if (read(fcb->data_fd, data_buf, bufsize) != bufsize)
-        G_fatal_error(_("Error reading raster data for row %d of <%s>"), row,
-                      fcb->name);
+    if (read_at(fcb->data_fd, data_buf, bufsize, (off_t)row * bufsize) !=
+        bufsize)
+        read_error(rd, _("Error reading raster data for row %d of <%s>"), row,
+                   fcb->name);
+
+    return data_buf;
 }
 
-static void read_data_gdal(int fd, int row, unsigned char *data_buf,
-                           int *nbytes)
+static const unsigned char *read_data_gdal(struct Rast_reader *rd, int row,
+                                           unsigned char *data_buf,
+                                           int *nbytes)
 {
-    struct fileinfo *fcb = &R__.fileinfo[fd];
+    struct fileinfo *fcb = &R__.fileinfo[rd->fd];
     unsigned char *buf;
     CPLErr err;
 
@@ -213,9 +316,11 @@ static void read_data_gdal(int fd, int row, unsigned char *data_buf,
     if (fcb->gdal->vflip)
         row = fcb->cellhd.rows - 1 - row;
 
-    buf = fcb->gdal->hflip ? G_malloc(fcb->cellhd.cols * fcb->cur_nbytes)
+    buf = fcb->gdal->hflip ? G_malloc(fcb->cellhd.cols * rd->cur_nbytes)
                            : data_buf;
 
+    /* GDAL datasets must not be accessed by several threads at once */
+#pragma omp critical(Rast_gdal_read)
     err =
         Rast_gdal_raster_IO(fcb->gdal->band, GF_Read, 0, row, fcb->cellhd.cols,
                             1, buf, fcb->cellhd.cols, 1, fcb->gdal->type, 0, 0);
@@ -224,45 +329,182 @@ static void read_data_gdal(int fd, int row, unsigned char *data_buf,
         int i;
 
         for (i = 0; i < fcb->cellhd.cols; i++)
-            memcpy(data_buf + i * fcb->cur_nbytes,
-                   buf + (fcb->cellhd.cols - 1 - i) * fcb->cur_nbytes,
-                   fcb->cur_nbytes);
+            memcpy(data_buf + i * rd->cur_nbytes,
+                   buf + (fcb->cellhd.cols - 1 - i) * rd->cur_nbytes,
+                   rd->cur_nbytes);
         G_free(buf);
     }
 
     if (err != CE_None)
-        G_fatal_error(
-            _("Error reading raster data via GDAL for row %d of <%s>"), row,
-            fcb->name);
+        read_error(rd,
+                   _("Error reading raster data via GDAL for row %d of <%s>"),
+                   row, fcb->name);
+
+    return data_buf;
 }
 
-static void read_data(int fd, int row, unsigned char *data_buf, int *nbytes)
+/* decompress a tile of the tile row held by the cursor into its row
+   buffer */
+static void load_tile(struct Rast_reader *rd, int col)
 {
-    struct fileinfo *fcb = &R__.fileinfo[fd];
+    struct fileinfo *fcb = &R__.fileinfo[rd->fd];
+    struct R_tiles *tl = fcb->tiles;
+    int tile = rd->tile_band * tl->ncols + col;
+    int row = rd->tile_band * tl->rows;
+    int ncols = fcb->cellhd.cols - col * tl->cols < tl->cols
+                    ? fcb->cellhd.cols - col * tl->cols
+                    : tl->cols;
+    int nrows = fcb->cellhd.rows - row < tl->rows ? fcb->cellhd.rows - row
+                                                   : tl->rows;
+    size_t row_size = (size_t)ncols * fcb->nbytes;
+    off_t t1 = tl->ptr[tile];
+    off_t t2 = tl->ptr[tile + 1];
+    size_t readamount = t2 - t1;
+    unsigned char *cmp = get_raw_data(rd, row, t1, readamount);
+    int i;
 
-    if (fcb->gdal) {
-        read_data_gdal(fd, row, data_buf, nbytes);
+    /* the tile is left unloaded after an error of a background cursor */
+    if (!cmp)
         return;
+
+    if (G_expand_compressed(cmp, readamount, rd->tile_tmp, row_size * nrows,
+                            fcb->cellhd.compressed) !=
+        (int)(row_size * nrows)) {
+        read_error(rd, _("Error uncompressing raster data for tile %d of <%s>"),
+                   tile, fcb->name);
+        return;
+    }
+
+    for (i = 0; i < nrows; i++)
+        memcpy(rd->tile_buf +
+                   ((size_t)i * fcb->cellhd.cols + (size_t)col * tl->cols) *
+                       fcb->nbytes,
+               rd->tile_tmp + i * row_size, row_size);
+
+    rd->tile_loaded[col] = 1;
+}
+
+/* read a row of a tiled cell file, decompressing the tiles in the
+   region unless the cursor holds them already */
+static const unsigned char *read_data_tiled(struct Rast_reader *rd, int row,
+                                            unsigned char *data_buf UNUSED,
+                                            int *nbytes)
+{
+    struct fileinfo *fcb = &R__.fileinfo[rd->fd];
+    struct R_tiles *tl = fcb->tiles;
+    int band = row / tl->rows;
+    int first = fcb->cellhd.cols, last = -1;
+    int lo = 0, hi = R__.rd_window.cols;
+    int i;
+
+    *nbytes = fcb->nbytes;
+
+    if (!rd->tile_buf) {
+        rd->tile_buf =
+            G_malloc((size_t)tl->rows * fcb->cellhd.cols * fcb->nbytes);
+        rd->tile_tmp = G_malloc((size_t)tl->rows * tl->cols * fcb->nbytes);
+        rd->tile_loaded = G_malloc(tl->ncols);
+        rd->tile_band = -1;
+    }
+
+    if (band != rd->tile_band) {
+        rd->tile_band = band;
+        memset(rd->tile_loaded, 0, tl->ncols);
+    }
+
+    /* cell file columns in the region, or in the block being read */
+    if (rd->col_hi > 0) {
+        lo = rd->col_lo;
+        hi = rd->col_hi;
+    }
+    for (i = lo; i < hi; i++) {
+        int c = fcb->col_map[i] - 1;
+
+        if (c < 0)
+            continue;
+        if (c < first)
+            first = c;
+        if (c > last)
+            last = c;
     }
 
+    for (i = first / tl->cols; i <= last / tl->cols && last >= 0; i++)
+        if (!rd->tile_loaded[i])
+            load_tile(rd, i);
+
+    return rd->tile_buf + (size_t)(row % tl->rows) * fcb->cellhd.cols *
+                              fcb->nbytes;
+}
+
+/* read and decompress a cell file row, returns data_buf or, for rows
+   which are stored uncompressed in a mapped file, a pointer into the
+   mapping, or for tiled files a pointer into the tile row of the cursor */
+static const unsigned char *read_data(struct Rast_reader *rd, int row,
+                                      unsigned char *data_buf, int *nbytes)
+{
+    struct fileinfo *fcb = &R__.fileinfo[rd->fd];
+
+    if (fcb->gdal)
+        return read_data_gdal(rd, row, data_buf, nbytes);
+
+    if (fcb->tiles)
+        return read_data_tiled(rd, row, data_buf, nbytes);
+
     if (!fcb->cellhd.compressed)
-        read_data_uncompressed(fd, row, data_buf, nbytes);
+        return read_data_uncompressed(rd, row, data_buf, nbytes);
     else if (fcb->map_type == CELL_TYPE)
-        read_data_compressed(fd, row, data_buf, nbytes);
+        return read_data_compressed(rd, row, data_buf, nbytes);
     else
-        read_data_fp_compressed(fd, row, data_buf, nbytes);
+        return read_data_fp_compressed(rd, row, data_buf, nbytes);
+}
+
+/* decode consecutive cells of a cell file row, one loop per cell width */
+static void cell_values_int_run(const unsigned char *d, int nbytes, CELL *c,
+                                int n)
+{
+    int i;
+
+    switch (nbytes) {
+    case 1:
+        for (i = 0; i < n; i++)
+            c[i] = d[i];
+        return;
+    case 2:
+        for (i = 0; i < n; i++)
+            c[i] = (d[2 * i] << 8) | d[2 * i + 1];
+        return;
+    case 3:
+        for (i = 0; i < n; i++)
+            c[i] = (d[3 * i] << 16) | (d[3 * i + 1] << 8) | d[3 * i + 2];
+        return;
+    case 4:
+        for (i = 0; i < n; i++) {
+            CELL v = ((d[4 * i] & 0x7f) << 24) | (d[4 * i + 1] << 16) |
+                     (d[4 * i + 2] << 8) | d[4 * i + 3];
+
+            c[i] = (d[4 * i] & 0x80) ? -v : v;
+        }
+        return;
+    }
 }
 
 /* copy cell file data to user buffer translated by window column mapping */
-static void cell_values_int(int fd UNUSED, const unsigned char *data UNUSED,
-                            const COLUMN_MAPPING *cmap, int nbytes UNUSED,
-                            void *cell, int n)
+static void cell_values_int(int fd, const unsigned char *data,
+                            const COLUMN_MAPPING *cmap, int nbytes, void *cell,
+                            int n)
 {
+    struct fileinfo *fcb = &R__.fileinfo[fd];
     CELL *c = cell;
     COLUMN_MAPPING cmapold = 0;
     int big = (size_t)nbytes >= sizeof(CELL);
     int i;
 
+    if (fcb->col_offset >= 0 && nbytes >= 1 && nbytes <= 4) {
+        cell_values_int_run(data + (size_t)fcb->col_offset * nbytes, nbytes, c,
+                            n);
+        return;
+    }
+
     for (i = 0; i < n; i++) {
         const unsigned char *d;
         int neg;
@@ -299,15 +541,20 @@ static void cell_values_int(int fd UNUSED, const unsigned char *data UNUSED,
     }
 }
 
-static void cell_values_float(int fd, const unsigned char *data UNUSED,
+static void cell_values_float(int fd, const unsigned char *data,
                               const COLUMN_MAPPING *cmap, int nbytes UNUSED,
                               void *cell, int n)
 {
     struct fileinfo *fcb = &R__.fileinfo[fd];
-    const float *work_buf = (const float *)fcb->data;
+    const float *work_buf = (const float *)data;
     FCELL *c = cell;
     int i;
 
+    if (fcb->col_offset >= 0) {
+        G_xdr_get_floats(c, work_buf + fcb->col_offset, n);
+        return;
+    }
+
     for (i = 0; i < n; i++) {
         if (!cmap[i]) {
             c[i] = 0;
@@ -318,15 +565,20 @@ static void cell_values_float(int fd, const unsigned char *data UNUSED,
     }
 }
 
-static void cell_values_double(int fd, const unsigned char *data UNUSED,
+static void cell_values_double(int fd, const unsigned char *data,
                                const COLUMN_MAPPING *cmap, int nbytes UNUSED,
                                void *cell, int n)
 {
     struct fileinfo *fcb = &R__.fileinfo[fd];
-    const double *work_buf = (const double *)fcb->data;
+    const double *work_buf = (const double *)data;
     DCELL *c = cell;
     int i;
 
+    if (fcb->col_offset >= 0) {
+        G_xdr_get_doubles(c, work_buf + fcb->col_offset, n);
+        return;
+    }
+
     for (i = 0; i < n; i++) {
         if (!cmap[i]) {
             c[i] = 0;
@@ -450,7 +702,7 @@ static void gdal_values_double(int fd UNUSED, const unsigned char *data,
    work_buf might be omitted. check the appropriate function for XY to
    determine the procedure of conversion.
  */
-static void transfer_to_cell_XX(int fd, void *cell)
+static void transfer_to_cell_XX(struct Rast_reader *rd, void *cell)
 {
     static void (*cell_values_type[3])(
         int, const unsigned char *, const COLUMN_MAPPING *, int, void *,
@@ -458,25 +710,25 @@ static void transfer_to_cell_XX(int fd, void *cell)
     static void (*gdal_values_type[3])(
         int, const unsigned char *, const COLUMN_MAPPING *, int, void *,
         int) = {gdal_values_int, gdal_values_float, gdal_values_double};
-    struct fileinfo *fcb = &R__.fileinfo[fd];
+    struct fileinfo *fcb = &R__.fileinfo[rd->fd];
 
     if (fcb->gdal)
-        (gdal_values_type[fcb->map_type])(fd, fcb->data, fcb->col_map,
-                                          fcb->cur_nbytes, cell,
+        (gdal_values_type[fcb->map_type])(rd->fd, rd->row, fcb->col_map,
+                                          rd->cur_nbytes, cell,
                                           R__.rd_window.cols);
     else
-        (cell_values_type[fcb->map_type])(fd, fcb->data, fcb->col_map,
-                                          fcb->cur_nbytes, cell,
+        (cell_values_type[fcb->map_type])(rd->fd, rd->row, fcb->col_map,
+                                          rd->cur_nbytes, cell,
                                           R__.rd_window.cols);
 }
 
-static void transfer_to_cell_fi(int fd, void *cell)
+static void transfer_to_cell_fi(struct Rast_reader *rd, void *cell)
 {
-    struct fileinfo *fcb = &R__.fileinfo[fd];
+    struct fileinfo *fcb = &R__.fileinfo[rd->fd];
     FCELL *work_buf = G_malloc(R__.rd_window.cols * sizeof(FCELL));
     int i;
 
-    transfer_to_cell_XX(fd, work_buf);
+    transfer_to_cell_XX(rd, work_buf);
 
     for (i = 0; i < R__.rd_window.cols; i++)
         ((CELL *)cell)[i] =
@@ -487,13 +739,13 @@ static void transfer_to_cell_fi(int fd, void *cell)
     G_free(work_buf);
 }
 
-static void transfer_to_cell_di(int fd, void *cell)
+static void transfer_to_cell_di(struct Rast_reader *rd, void *cell)
 {
-    struct fileinfo *fcb = &R__.fileinfo[fd];
+    struct fileinfo *fcb = &R__.fileinfo[rd->fd];
     DCELL *work_buf = G_malloc(R__.rd_window.cols * sizeof(DCELL));
     int i;
 
-    transfer_to_cell_XX(fd, work_buf);
+    transfer_to_cell_XX(rd, work_buf);
 
     for (i = 0; i < R__.rd_window.cols; i++)
         ((CELL *)cell)[i] =
@@ -504,12 +756,12 @@ static void transfer_to_cell_di(int fd, void *cell)
     G_free(work_buf);
 }
 
-static void transfer_to_cell_if(int fd, void *cell)
+static void transfer_to_cell_if(struct Rast_reader *rd, void *cell)
 {
     CELL *work_buf = G_malloc(R__.rd_window.cols * sizeof(CELL));
     int i;
 
-    transfer_to_cell_XX(fd, work_buf);
+    transfer_to_cell_XX(rd, work_buf);
 
     for (i = 0; i < R__.rd_window.cols; i++)
         ((FCELL *)cell)[i] = work_buf[i];
@@ -517,12 +769,12 @@ static void transfer_to_cell_if(int fd, void *cell)
     G_free(work_buf);
 }
 
-static void transfer_to_cell_df(int fd, void *cell)
+static void transfer_to_cell_df(struct Rast_reader *rd, void *cell)
 {
     DCELL *work_buf = G_malloc(R__.rd_window.cols * sizeof(DCELL));
     int i;
 
-    transfer_to_cell_XX(fd, work_buf);
+    transfer_to_cell_XX(rd, work_buf);
 
     for (i = 0; i < R__.rd_window.cols; i++)
         ((FCELL *)cell)[i] = work_buf[i];
@@ -530,12 +782,12 @@ static void transfer_to_cell_df(int fd, void *cell)
     G_free(work_buf);
 }
 
-static void transfer_to_cell_id(int fd, void *cell)
+static void transfer_to_cell_id(struct Rast_reader *rd, void *cell)
 {
     CELL *work_buf = G_malloc(R__.rd_window.cols * sizeof(CELL));
     int i;
 
-    transfer_to_cell_XX(fd, work_buf);
+    transfer_to_cell_XX(rd, work_buf);
 
     for (i = 0; i < R__.rd_window.cols; i++)
         ((DCELL *)cell)[i] = work_buf[i];
@@ -543,12 +795,12 @@ static void transfer_to_cell_id(int fd, void *cell)
     G_free(work_buf);
 }
 
-static void transfer_to_cell_fd(int fd, void *cell)
+static void transfer_to_cell_fd(struct Rast_reader *rd, void *cell)
 {
     FCELL *work_buf = G_malloc(R__.rd_window.cols * sizeof(FCELL));
     int i;
 
-    transfer_to_cell_XX(fd, work_buf);
+    transfer_to_cell_XX(rd, work_buf);
 
     for (i = 0; i < R__.rd_window.cols; i++)
         ((DCELL *)cell)[i] = work_buf[i];
@@ -556,57 +808,122 @@ static void transfer_to_cell_fd(int fd, void *cell)
     G_free(work_buf);
 }
 
+/* queue the cell file rows of the next window rows for reading ahead */
+static void read_ahead(struct Rast_reader *rd, int row)
+{
+    struct R_prefetch *pf = rd->prefetch;
+    int prev = rd->cur_row;
+    int i, n, r;
+
+    /* only sequential reading benefits, start over after a jump back */
+    if (row <= pf->last_row)
+        Rast__reset_prefetch(rd);
+    pf->last_row = row;
+
+    for (i = 1, n = 0; n < pf->depth && row + i < R__.rd_window.rows; i++) {
+        if (!compute_window_row(rd->fd, row + i, &r) || r == prev)
+            continue;
+        if (!Rast__prefetch_row(rd, r))
+            break;
+        prev = r;
+        n++;
+    }
+}
+
+/*!
+   \brief Read a cell file row into the buffers of a cursor (internal use only)
+
+   Used to read rows ahead in the background, see prefetch.c.
+
+   Errors do not end the process but set rd->failed.
+
+   \param rd cursor owning the buffers
+   \param r cell file row
+
+   \return 1 if the null bits of the row were read too
+   \return 0 if the map has no null file
+ */
+int Rast__read_ahead(struct Rast_reader *rd, int r)
+{
+    rd->failed = 0;
+    rd->cur_row = r;
+    rd->row = read_data(rd, r, rd->data, &rd->cur_nbytes);
+
+    return read_null_bits_row(rd, r, rd->null_bits);
+}
+
 /*
  *   works for all map types and doesn't consider
  *   null row corresponding to the requested row
  */
-static int get_map_row_nomask(int fd, void *rast, int row,
+static int get_map_row_nomask(struct Rast_reader *rd, void *rast, int row,
                               RASTER_MAP_TYPE data_type)
 {
-    static void (*transfer_to_cell_FtypeOtype[3][3])(int, void *) = {
+    static void (*transfer_to_cell_FtypeOtype[3][3])(struct Rast_reader *,
+                                                     void *) = {
         {transfer_to_cell_XX, transfer_to_cell_if, transfer_to_cell_id},
         {transfer_to_cell_fi, transfer_to_cell_XX, transfer_to_cell_fd},
         {transfer_to_cell_di, transfer_to_cell_df, transfer_to_cell_XX}};
-    struct fileinfo *fcb = &R__.fileinfo[fd];
+    struct fileinfo *fcb = &R__.fileinfo[rd->fd];
     int r;
     int row_status;
 
     /* is this the best place to read a vrt row, or
      * call Rast_get_vrt_row() earlier ? */
-    if (fcb->vrt)
-        return Rast_get_vrt_row(fd, rast, row, data_type);
+    if (fcb->vrt) {
+        /* the tiles are read through their own fds, one thread at a time */
+#pragma omp critical(Rast_vrt_read)
+        row_status = Rast_get_vrt_row(rd->fd, rast, row, data_type);
+
+        return row_status;
+    }
 
-    row_status = compute_window_row(fd, row, &r);
+    row_status = compute_window_row(rd->fd, row, &r);
 
     if (!row_status) {
-        fcb->cur_row = -1;
+        rd->cur_row = -1;
         Rast_zero_input_buf(rast, data_type);
         return 0;
     }
 
     /* read cell file row if not in memory */
-    if (r != fcb->cur_row) {
-        fcb->cur_row = r;
-        read_data(fd, fcb->cur_row, fcb->data, &fcb->cur_nbytes);
+    if (r != rd->cur_row) {
+        rd->cur_row = r;
+        if (Rast__get_cached_row(fcb->cache_id, r, rd->data,
+                                 (size_t)fcb->cellhd.cols * fcb->nbytes,
+                                 &rd->cur_nbytes))
+            rd->row = rd->data;
+        else {
+            if (!rd->prefetch || !Rast__get_prefetched_row(rd, row))
+                rd->row = read_data(rd, r, rd->data, &rd->cur_nbytes);
+            /* rows used in place from a mapped file are not worth caching */
+            if (rd->row == rd->data)
+                Rast__cache_row(fcb->cache_id, r, rd->data,
+                                (size_t)fcb->cellhd.cols * rd->cur_nbytes,
+                                rd->cur_nbytes);
+        }
+        if (rd->prefetch)
+            read_ahead(rd, row);
     }
 
-    (transfer_to_cell_FtypeOtype[fcb->map_type][data_type])(fd, rast);
+    (transfer_to_cell_FtypeOtype[fcb->map_type][data_type])(rd, rast);
 
     return 1;
 }
 
-static void get_map_row_no_reclass(int fd, void *rast, int row,
+static void get_map_row_no_reclass(struct Rast_reader *rd, void *rast, int row,
                                    RASTER_MAP_TYPE data_type, int null_is_zero,
                                    int with_mask)
 {
-    get_map_row_nomask(fd, rast, row, data_type);
-    embed_nulls(fd, rast, row, data_type, null_is_zero, with_mask);
+    get_map_row_nomask(rd, rast, row, data_type);
+    embed_nulls(rd, rast, row, data_type, null_is_zero, with_mask);
 }
 
-static void get_map_row(int fd, void *rast, int row, RASTER_MAP_TYPE data_type,
-                        int null_is_zero, int with_mask)
+static void get_map_row(struct Rast_reader *rd, void *rast, int row,
+                        RASTER_MAP_TYPE data_type, int null_is_zero,
+                        int with_mask)
 {
-    struct fileinfo *fcb = &R__.fileinfo[fd];
+    struct fileinfo *fcb = &R__.fileinfo[rd->fd];
     int size = Rast_cell_size(data_type);
     CELL *temp_buf = NULL;
     void *buf;
@@ -623,7 +940,7 @@ static void get_map_row(int fd, void *rast, int row, RASTER_MAP_TYPE data_type,
         type = data_type;
     }
 
-    get_map_row_no_reclass(fd, buf, row, type, null_is_zero, with_mask);
+    get_map_row_no_reclass(rd, buf, row, type, null_is_zero, with_mask);
 
     if (!fcb->reclass_flag)
         return;
@@ -631,7 +948,7 @@ static void get_map_row(int fd, void *rast, int row, RASTER_MAP_TYPE data_type,
     /* if the map is reclass table, get and
        reclass CELL row and copy results to needed type  */
 
-    do_reclass_int(fd, buf, null_is_zero);
+    do_reclass_int(rd->fd, buf, null_is_zero);
 
     if (data_type == CELL_TYPE)
         return;
@@ -675,7 +992,7 @@ static void get_map_row(int fd, void *rast, int row, RASTER_MAP_TYPE data_type,
  */
 void Rast_get_row_nomask(int fd, void *buf, int row, RASTER_MAP_TYPE data_type)
 {
-    get_map_row(fd, buf, row, data_type, 0, 0);
+    get_map_row(R__.fileinfo[fd].rd, buf, row, data_type, 0, 0);
 }
 
 /*!
@@ -767,7 +1084,7 @@ void Rast_get_d_row_nomask(int fd, DCELL *buf, int row)
  */
 void Rast_get_row(int fd, void *buf, int row, RASTER_MAP_TYPE data_type)
 {
-    get_map_row(fd, buf, row, data_type, 0, 1);
+    get_map_row(R__.fileinfo[fd].rd, buf, row, data_type, 0, 1);
 }
 
 /*!
@@ -831,65 +1148,53 @@ void Rast_get_d_row(int fd, DCELL *buf, int row)
     Rast_get_row(fd, buf, row, DCELL_TYPE);
 }
 
-static int read_null_bits_compressed(int null_fd, unsigned char *flags, int row,
-                                     size_t size, int fd)
+static int read_null_bits_compressed(struct Rast_reader *rd,
+                                     unsigned char *flags, int row,
+                                     size_t size)
 {
-    struct fileinfo *fcb = &R__.fileinfo[fd];
+    struct fileinfo *fcb = &R__.fileinfo[rd->fd];
     off_t t1 = fcb->null_row_ptr[row];
     off_t t2 = fcb->null_row_ptr[row + 1];
     size_t readamount = t2 - t1;
     unsigned char *compressed_buf;
-    int res;
-
-    if (lseek(null_fd, t1, SEEK_SET) == -1)
-        G_fatal_error(
-            _("Error seeking compressed null data for row %d of <%s>"), row,
-            fcb->name);
 
     if (readamount == size) {
-        if ((res = read(null_fd, flags, size)) < 0 ||
-            (unsigned int)res != size) {
-            G_fatal_error(
-                _("Error reading compressed null data for row %d of <%s>"), row,
-                fcb->name);
+        if (read_at(fcb->null_fd, flags, size, t1) != (ssize_t)size) {
+            read_error(
+                rd, _("Error reading compressed null data for row %d of <%s>"),
+                row, fcb->name);
         }
         return 1;
     }
 
-    compressed_buf = G_malloc(readamount);
+    compressed_buf = get_cmp_buf(rd, readamount);
 
-    if ((res = read(null_fd, compressed_buf, readamount)) < 0 ||
-        (unsigned int)res != readamount) {
-        G_free(compressed_buf);
-        G_fatal_error(
-            _("Error reading compressed null data for row %d of <%s>"), row,
-            fcb->name);
+    if (read_at(fcb->null_fd, compressed_buf, readamount, t1) !=
+        (ssize_t)readamount) {
+        read_error(rd,
+                   _("Error reading compressed null data for row %d of <%s>"),
+                   row, fcb->name);
+        return 1;
     }
 
     /* null bits file compressed with LZ4, see lib/gis/compress.h */
     if (G_lz4_expand(compressed_buf, readamount, flags, size) < 1) {
-        G_fatal_error(_("Error uncompressing null data for row %d of <%s>"),
-                      row, fcb->name);
+        read_error(rd, _("Error uncompressing null data for row %d of <%s>"),
+                   row, fcb->name);
     }
 
-    G_free(compressed_buf);
-
     return 1;
 }
 
-int Rast__read_null_bits(int fd, int row, unsigned char *flags)
+/* read null bits of cell file row R, 0 if the map has no null file */
+static int read_null_bits_row(struct Rast_reader *rd, int R,
+                              unsigned char *flags)
 {
-    struct fileinfo *fcb = &R__.fileinfo[fd];
+    struct fileinfo *fcb = &R__.fileinfo[rd->fd];
     int null_fd = fcb->null_fd;
     int cols = fcb->cellhd.cols;
     off_t offset;
     ssize_t size;
-    int R;
-
-    if (compute_window_row(fd, row, &R) <= 0) {
-        Rast__init_null_bits(flags, cols);
-        return 1;
-    }
 
     if (null_fd < 0)
         return 0;
@@ -897,25 +1202,77 @@ int Rast__read_null_bits(int fd, int row, unsigned char *flags)
     size = Rast__null_bitstream_size(cols);
 
     if (fcb->null_row_ptr)
-        return read_null_bits_compressed(null_fd, flags, R, size, fd);
+        return read_null_bits_compressed(rd, flags, R, size);
 
     offset = (off_t)size * R;
 
-    if (lseek(null_fd, offset, SEEK_SET) == -1)
-        G_fatal_error(_("Error seeking null row %d for <%s>"), R, fcb->name);
+    if (read_at(null_fd, flags, size, offset) != size)
+        read_error(rd, _("Error reading null row %d for <%s>"), R, fcb->name);
+
+    return 1;
+}
+
+static int read_null_bits(struct Rast_reader *rd, int row,
+                          unsigned char *flags)
+{
+    struct fileinfo *fcb = &R__.fileinfo[rd->fd];
+    size_t size = Rast__null_bitstream_size(fcb->cellhd.cols);
+    int R;
 
-    if (read(null_fd, flags, size) != size)
-        G_fatal_error(_("Error reading null row %d for <%s>"), R, fcb->name);
+    if (compute_window_row(rd->fd, row, &R) <= 0) {
+        Rast__init_null_bits(flags, fcb->cellhd.cols);
+        return 1;
+    }
+
+    if (Rast__get_cached_row(fcb->null_cache_id, R, flags, size, NULL))
+        return 1;
+
+    if (!read_null_bits_row(rd, R, flags))
+        return 0;
+
+    Rast__cache_row(fcb->null_cache_id, R, flags, size, 1);
 
     return 1;
 }
 
+int Rast__read_null_bits(int fd, int row, unsigned char *flags)
+{
+    return read_null_bits(R__.fileinfo[fd].rd, row, flags);
+}
+
 #define check_null_bit(flags, bit_num) \
     ((flags)[(bit_num) >> 3] & ((unsigned char)0x80 >> ((bit_num) & 7)) ? 1 : 0)
 
-static void get_null_value_row_nomask(int fd, char *flags, int row)
+/* unpack n consecutive null bits starting at bit first, a byte at a time */
+static void unpack_null_bits(char *flags, const unsigned char *bits, int first,
+                             int n)
 {
-    struct fileinfo *fcb = &R__.fileinfo[fd];
+    int i = 0;
+
+    for (; i < n && ((first + i) & 7); i++)
+        flags[i] = check_null_bit(bits, first + i);
+
+    for (; i + 8 <= n; i += 8) {
+        unsigned char b = bits[(first + i) >> 3];
+
+        flags[i] = b >> 7;
+        flags[i + 1] = (b >> 6) & 1;
+        flags[i + 2] = (b >> 5) & 1;
+        flags[i + 3] = (b >> 4) & 1;
+        flags[i + 4] = (b >> 3) & 1;
+        flags[i + 5] = (b >> 2) & 1;
+        flags[i + 6] = (b >> 1) & 1;
+        flags[i + 7] = b & 1;
+    }
+
+    for (; i < n; i++)
+        flags[i] = check_null_bit(bits, first + i);
+}
+
+static void get_null_value_row_nomask(struct Rast_reader *rd, char *flags,
+                                      int row)
+{
+    struct fileinfo *fcb = &R__.fileinfo[rd->fd];
     int j;
 
     if (row > R__.rd_window.rows || row < 0) {
@@ -933,14 +1290,14 @@ static void get_null_value_row_nomask(int fd, char *flags, int row)
         return;
     }
 
-    if (row != fcb->null_cur_row) {
-        if (!Rast__read_null_bits(fd, row, fcb->null_bits)) {
-            fcb->null_cur_row = -1;
+    if (row != rd->null_cur_row) {
+        if (!read_null_bits(rd, row, rd->null_bits)) {
+            rd->null_cur_row = -1;
             if (fcb->map_type == CELL_TYPE) {
                 /* If can't read null row, assume  that all map 0's are nulls */
                 CELL *mask_buf = G_malloc(R__.rd_window.cols * sizeof(CELL));
 
-                get_map_row_nomask(fd, mask_buf, row, CELL_TYPE);
+                get_map_row_nomask(rd, mask_buf, row, CELL_TYPE);
                 for (j = 0; j < R__.rd_window.cols; j++)
                     flags[j] = (mask_buf[j] == 0);
 
@@ -955,7 +1312,13 @@ static void get_null_value_row_nomask(int fd, char *flags, int row)
             return;
         } /*if no null file */
         else
-            fcb->null_cur_row = row;
+            rd->null_cur_row = row;
+    }
+
+    if (fcb->col_offset >= 0) {
+        unpack_null_bits(flags, rd->null_bits, fcb->col_offset,
+                         R__.rd_window.cols);
+        return;
     }
 
     /* copy null row to flags row translated by window column mapping */
@@ -963,19 +1326,20 @@ static void get_null_value_row_nomask(int fd, char *flags, int row)
         if (!fcb->col_map[j])
             flags[j] = 1;
         else
-            flags[j] = check_null_bit(fcb->null_bits, fcb->col_map[j] - 1);
+            flags[j] = check_null_bit(rd->null_bits, fcb->col_map[j] - 1);
     }
 }
 
 /*--------------------------------------------------------------------------*/
 
-static void get_null_value_row_gdal(int fd, char *flags, int row)
+static void get_null_value_row_gdal(struct Rast_reader *rd, char *flags,
+                                    int row)
 {
-    struct fileinfo *fcb = &R__.fileinfo[fd];
+    struct fileinfo *fcb = &R__.fileinfo[rd->fd];
     DCELL *tmp_buf = Rast_allocate_d_input_buf();
     int i;
 
-    if (get_map_row_nomask(fd, tmp_buf, row, DCELL_TYPE) <= 0) {
+    if (get_map_row_nomask(rd, tmp_buf, row, DCELL_TYPE) <= 0) {
         memset(flags, 1, R__.rd_window.cols);
         G_free(tmp_buf);
         return;
@@ -993,9 +1357,10 @@ static void get_null_value_row_gdal(int fd, char *flags, int row)
 
 /*--------------------------------------------------------------------------*/
 
-static void embed_mask(char *flags, int row)
+static void embed_mask(struct Rast_reader *rd, char *flags, int row)
 {
     CELL *mask_buf = G_malloc(R__.rd_window.cols * sizeof(CELL));
+    struct Rast_reader *mask_rd;
     int i;
 
     if (R__.auto_mask <= 0) {
@@ -1003,13 +1368,16 @@ static void embed_mask(char *flags, int row)
         return;
     }
 
-    if (get_map_row_nomask(R__.mask_fd, mask_buf, row, CELL_TYPE) < 0) {
+    /* readers carry their own cursor over the mask */
+    mask_rd = rd->mask ? rd->mask : R__.fileinfo[R__.mask_fd].rd;
+
+    if (get_map_row_nomask(mask_rd, mask_buf, row, CELL_TYPE) < 0) {
         G_free(mask_buf);
         return;
     }
 
     if (R__.fileinfo[R__.mask_fd].reclass_flag) {
-        embed_nulls(R__.mask_fd, mask_buf, row, CELL_TYPE, 0, 0);
+        embed_nulls(mask_rd, mask_buf, row, CELL_TYPE, 0, 0);
         do_reclass_int(R__.mask_fd, mask_buf, 1);
     }
 
@@ -1020,25 +1388,27 @@ static void embed_mask(char *flags, int row)
     G_free(mask_buf);
 }
 
-static void get_null_value_row(int fd, char *flags, int row, int with_mask)
+static void get_null_value_row(struct Rast_reader *rd, char *flags, int row,
+                               int with_mask)
 {
-    struct fileinfo *fcb = &R__.fileinfo[fd];
+    struct fileinfo *fcb = &R__.fileinfo[rd->fd];
 
     if (fcb->gdal)
-        get_null_value_row_gdal(fd, flags, row);
+        get_null_value_row_gdal(rd, flags, row);
     else
-        get_null_value_row_nomask(fd, flags, row);
+        get_null_value_row_nomask(rd, flags, row);
 
     if (with_mask)
-        embed_mask(flags, row);
+        embed_mask(rd, flags, row);
 }
 
-static void embed_nulls(int fd, void *buf, int row, RASTER_MAP_TYPE map_type,
-                        int null_is_zero, int with_mask)
+static void embed_nulls(struct Rast_reader *rd, void *buf, int row,
+                        RASTER_MAP_TYPE map_type, int null_is_zero,
+                        int with_mask)
 {
-    struct fileinfo *fcb = &R__.fileinfo[fd];
-    size_t size = Rast_cell_size(map_type);
+    struct fileinfo *fcb = &R__.fileinfo[rd->fd];
     char *null_buf;
+    int n = R__.rd_window.cols;
     int i;
 
     /* this is because without null file the nulls can be only due to 0's
@@ -1049,17 +1419,41 @@ static void embed_nulls(int fd, void *buf, int row, RASTER_MAP_TYPE map_type,
 
     null_buf = G_malloc(R__.rd_window.cols);
 
-    get_null_value_row(fd, null_buf, row, with_mask);
+    get_null_value_row(rd, null_buf, row, with_mask);
 
-    for (i = 0; i < R__.rd_window.cols; i++) {
-        /* also check for nulls which might be already embedded by quant
-           rules in case of fp map. */
-        if (null_buf[i] || Rast_is_null_value(buf, map_type)) {
-            /* G__set_[f/d]_null_value() sets it to 0 is the embedded mode
-               is not set and calls G_set_[f/d]_null_value() otherwise */
-            Rast__set_null_value(buf, 1, null_is_zero, map_type);
-        }
-        buf = G_incr_void_ptr(buf, size);
+    /* also check for nulls which might be already embedded by quant
+       rules in case of fp map. Nulls are set to 0 if null_is_zero. */
+    switch (map_type) {
+    case CELL_TYPE: {
+        CELL *c = buf, nv = 0;
+
+        if (!null_is_zero)
+            Rast_set_c_null_value(&nv, 1);
+        for (i = 0; i < n; i++)
+            if (null_buf[i] || Rast_is_c_null_value(&c[i]))
+                c[i] = nv;
+        break;
+    }
+    case FCELL_TYPE: {
+        FCELL *f = buf, nv = 0;
+
+        if (!null_is_zero)
+            Rast_set_f_null_value(&nv, 1);
+        for (i = 0; i < n; i++)
+            if (null_buf[i] || Rast_is_f_null_value(&f[i]))
+                memcpy(&f[i], &nv, sizeof(FCELL));
+        break;
+    }
+    case DCELL_TYPE: {
+        DCELL *d = buf, nv = 0;
+
+        if (!null_is_zero)
+            Rast_set_d_null_value(&nv, 1);
+        for (i = 0; i < n; i++)
+            if (null_buf[i] || Rast_is_d_null_value(&d[i]))
+                memcpy(&d[i], &nv, sizeof(DCELL));
+        break;
+    }
     }
 
     G_free(null_buf);
@@ -1087,7 +1481,7 @@ void Rast_get_null_value_row(int fd, char *flags, int row)
     struct fileinfo *fcb = &R__.fileinfo[fd];
 
     if (!fcb->reclass_flag)
-        get_null_value_row(fd, flags, row, 1);
+        get_null_value_row(fcb->rd, flags, row, 1);
     else {
         CELL *buf = G_malloc(R__.rd_window.cols * sizeof(CELL));
         int i;
@@ -1099,3 +1493,74 @@ void Rast_get_null_value_row(int fd, char *flags, int row)
         G_free(buf);
     }
 }
+
+/*!
+   \brief Read raster row through a reader
+
+   Same as Rast_get_row() but uses the decompression buffers and row
+   cache of the reader <em>rd</em> instead of the ones shared by all
+   users of the file descriptor. Different readers of the same map can
+   be used concurrently from different threads.
+
+   \param rd reader created by Rast_open_reader()
+   \param buf buffer for the row to be placed into
+   \param row data row desired
+   \param data_type data type
+
+   \return void
+ */
+void Rast_reader_get_row(struct Rast_reader *rd, void *buf, int row,
+                         RASTER_MAP_TYPE data_type)
+{
+    get_map_row(rd, buf, row, data_type, 0, 1);
+}
+
+/*!
+   \brief Read raster row through a reader without masking
+
+   Same as Rast_get_row_nomask() but uses the buffers of the reader
+   <em>rd</em>, see Rast_reader_get_row().
+
+   \param rd reader created by Rast_open_reader()
+   \param buf buffer for the row to be placed into
+   \param row data row desired
+   \param data_type data type
+
+   \return void
+ */
+void Rast_reader_get_row_nomask(struct Rast_reader *rd, void *buf, int row,
+                                RASTER_MAP_TYPE data_type)
+{
+    get_map_row(rd, buf, row, data_type, 0, 0);
+}
+
+/*!
+   \brief Read or simulate null value row through a reader
+
+   Same as Rast_get_null_value_row() but uses the buffers of the reader
+   <em>rd</em>, see Rast_reader_get_row().
+
+   \param rd reader created by Rast_open_reader()
+   \param flags buffer for the null flags
+   \param row data row desired
+
+   \return void
+ */
+void Rast_reader_get_null_value_row(struct Rast_reader *rd, char *flags,
+                                    int row)
+{
+    struct fileinfo *fcb = &R__.fileinfo[rd->fd];
+
+    if (!fcb->reclass_flag)
+        get_null_value_row(rd, flags, row, 1);
+    else {
+        CELL *buf = G_malloc(R__.rd_window.cols * sizeof(CELL));
+        int i;
+
+        get_map_row(rd, buf, row, CELL_TYPE, 0, 1);
+        for (i = 0; i < R__.rd_window.cols; i++)
+            flags[i] = Rast_is_c_null_value(&buf[i]) ? 1 : 0;
+
+        G_free(buf);
+    }
+}
@@ -73,7 +73,9 @@ void Rast__error_handler(void *p UNUSED)
 
 static int init(void)
 {
-    char *nulls, *cname;
+    char *nulls, *cname, *mmap_env, *prefetch, *write_threads;
+    char *tile_size, *overviews, *block_stats, *row_cache;
+    int size;
 
     Rast__init_window();
 
@@ -131,6 +133,32 @@ static int init(void)
     nulls = getenv("GRASS_COMPRESS_NULLS");
     R__.compress_nulls = (nulls && atoi(nulls) == 0) ? 0 : 1;
 
+    mmap_env = getenv("GRASS_RASTER_MMAP");
+    R__.use_mmap = (mmap_env && atoi(mmap_env) != 0) ? 1 : 0;
+
+    prefetch = getenv("GRASS_RASTER_PREFETCH");
+    R__.prefetch_rows = (prefetch && atoi(prefetch) > 0) ? atoi(prefetch) : 0;
+
+    write_threads = getenv("GRASS_RASTER_WRITE_THREADS");
+    R__.write_threads =
+        (write_threads && atoi(write_threads) > 0) ? atoi(write_threads) : 0;
+
+    tile_size = getenv("GRASS_RASTER_TILE_SIZE");
+    R__.tile_size = (tile_size && atoi(tile_size) > 0) ? atoi(tile_size) : 0;
+    if (R__.tile_size > MAX_TILE_SIZE)
+        R__.tile_size = MAX_TILE_SIZE;
+
+    overviews = getenv("GRASS_RASTER_OVERVIEWS");
+    R__.use_overviews = (overviews && atoi(overviews) != 0) ? 1 : 0;
+
+    block_stats = getenv("GRASS_RASTER_BLOCK_STATS");
+    R__.block_stats_size =
+        (block_stats && atoi(block_stats) > 0) ? atoi(block_stats) : 0;
+
+    row_cache = getenv("GRASS_RASTER_ROW_CACHE");
+    size = row_cache ? atoi(row_cache) : 64;
+    R__.row_cache_size = size > 0 ? (size_t)size << 20 : 0;
+
     G_add_error_handler(Rast__error_handler, NULL);
 
     initialized = 1;
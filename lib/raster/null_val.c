@@ -36,34 +36,40 @@ static void EmbedGivenNulls(void *, char *, RASTER_MAP_TYPE, int);
 void EmbedGivenNulls(void *cell, char *nulls, RASTER_MAP_TYPE map_type,
                      int ncols)
 {
-    CELL *c;
-    FCELL *f;
-    DCELL *d;
+    CELL *c, cnull;
+    FCELL *f, fnull;
+    DCELL *d, dnull;
     int i;
 
     c = (CELL *)cell;
     f = (FCELL *)cell;
     d = (DCELL *)cell;
 
-    for (i = 0; i < ncols; i++) {
-        if (nulls[i]) {
-            switch (map_type) {
-            case CELL_TYPE:
-                Rast_set_c_null_value((CELL *)(c + i), 1);
-                break;
+    /* one loop per type, the null pattern set up once */
+    switch (map_type) {
+    case CELL_TYPE:
+        Rast_set_c_null_value(&cnull, 1);
+        for (i = 0; i < ncols; i++)
+            if (nulls[i])
+                c[i] = cnull;
+        break;
 
-            case FCELL_TYPE:
-                Rast_set_f_null_value((FCELL *)(f + i), 1);
-                break;
+    case FCELL_TYPE:
+        Rast_set_f_null_value(&fnull, 1);
+        for (i = 0; i < ncols; i++)
+            if (nulls[i])
+                memcpy(&f[i], &fnull, sizeof(FCELL));
+        break;
 
-            case DCELL_TYPE:
-                Rast_set_d_null_value((DCELL *)(d + i), 1);
-                break;
+    case DCELL_TYPE:
+        Rast_set_d_null_value(&dnull, 1);
+        for (i = 0; i < ncols; i++)
+            if (nulls[i])
+                memcpy(&d[i], &dnull, sizeof(DCELL));
+        break;
 
-            default:
-                G_warning(_("EmbedGivenNulls: wrong data type"));
-            }
-        }
+    default:
+        G_warning(_("EmbedGivenNulls: wrong data type"));
     }
 }
 
@@ -137,11 +143,9 @@ void Rast_set_c_null_value(CELL *cellVals, int numVals)
  */
 void Rast_set_f_null_value(FCELL *fcellVals, int numVals)
 {
-    static const unsigned char null_bits[4] = {0xFF, 0xFF, 0xFF, 0xFF};
-    int i;
-
-    for (i = 0; i < numVals; i++)
-        memcpy(&fcellVals[i], null_bits, sizeof(null_bits));
+    /* the null pattern has all bits set */
+    if (numVals > 0)
+        memset(fcellVals, 0xFF, (size_t)numVals * sizeof(FCELL));
 }
 
 /*!
@@ -152,12 +156,9 @@ void Rast_set_f_null_value(FCELL *fcellVals, int numVals)
  */
 void Rast_set_d_null_value(DCELL *dcellVals, int numVals)
 {
-    static const unsigned char null_bits[8] = {0xFF, 0xFF, 0xFF, 0xFF,
-                                               0xFF, 0xFF, 0xFF, 0xFF};
-    int i;
-
-    for (i = 0; i < numVals; i++)
-        memcpy(&dcellVals[i], null_bits, sizeof(null_bits));
+    /* the null pattern has all bits set */
+    if (numVals > 0)
+        memset(dcellVals, 0xFF, (size_t)numVals * sizeof(DCELL));
 }
 
 /*!
@@ -419,29 +420,24 @@ int G__set_flags_from_01_random(const char *zero_ones, unsigned char *flags,
  */
 void Rast__convert_01_flags(const char *zero_ones, unsigned char *flags, int n)
 {
-    unsigned char *v;
-    int count;
-    int size;
     int i, k;
 
-    /* pad the flags with 0's to make size multiple of 8 */
-    v = flags;
-    size = Rast__null_bitstream_size(n);
-    count = 0;
-
-    for (i = 0; i < size; i++) {
-        *v = 0;
-        k = 8;
-
-        while (k-- > 0) {
-            if (count < n) {
-                *v = *v | ((unsigned char)zero_ones[count] << k);
-            }
-
-            count++;
-        }
+    /* whole bytes */
+    for (i = 0; i + 8 <= n; i += 8)
+        *flags++ = ((unsigned char)zero_ones[i] << 7) |
+                   ((unsigned char)zero_ones[i + 1] << 6) |
+                   ((unsigned char)zero_ones[i + 2] << 5) |
+                   ((unsigned char)zero_ones[i + 3] << 4) |
+                   ((unsigned char)zero_ones[i + 4] << 3) |
+                   ((unsigned char)zero_ones[i + 5] << 2) |
+                   ((unsigned char)zero_ones[i + 6] << 1) |
+                   (unsigned char)zero_ones[i + 7];
 
-        v++;
+    /* pad the flags with 0's to make size multiple of 8 */
+    if (i < n) {
+        *flags = 0;
+        for (k = 7; i < n; i++, k--)
+            *flags |= (unsigned char)zero_ones[i] << k;
     }
 }
 
@@ -456,27 +452,24 @@ void Rast__convert_01_flags(const char *zero_ones, unsigned char *flags, int n)
  */
 void Rast__convert_flags_01(char *zero_ones, const unsigned char *flags, int n)
 {
-    const unsigned char *v;
-    int count;
-    int size;
     int i, k;
 
-    count = 0;
-    v = flags;
-    size = Rast__null_bitstream_size(n);
-
-    for (i = 0; i < size; i++) {
-        k = 8;
-
-        while (k-- > 0) {
-            if (count < n) {
-                zero_ones[count] = ((*v & ((unsigned char)1 << k)) != 0);
-                count++;
-            }
-        }
-
-        v++;
+    /* whole bytes */
+    for (i = 0; i + 8 <= n; i += 8) {
+        unsigned char v = *flags++;
+
+        zero_ones[i] = v >> 7;
+        zero_ones[i + 1] = (v >> 6) & 1;
+        zero_ones[i + 2] = (v >> 5) & 1;
+        zero_ones[i + 3] = (v >> 4) & 1;
+        zero_ones[i + 4] = (v >> 3) & 1;
+        zero_ones[i + 5] = (v >> 2) & 1;
+        zero_ones[i + 6] = (v >> 1) & 1;
+        zero_ones[i + 7] = v & 1;
     }
+
+    for (k = 7; i < n; i++, k--)
+        zero_ones[i] = (*flags >> k) & 1;
 }
 
 /*!
@@ -48,6 +48,9 @@ static int new_fileinfo(void)
     else
         newsize *= 2;
 
+    /* background threads address maps through R__.fileinfo */
+    Rast__wait_all_jobs();
+
     R__.fileinfo = G_realloc(R__.fileinfo, newsize * sizeof(struct fileinfo));
 
     /* Mark all cell files as closed */
@@ -77,11 +80,13 @@ static int new_fileinfo(void)
  * \param name map name
  * \param open_mode mode
  * \param map_type map type (CELL, FCELL, DCELL)
+ * \param cellhd header of an overview level to write, NULL for a map
  *
  * \return open file descriptor ( >= 0) if successful
  */
 static int open_raster_new(const char *name, int open_mode,
-                           RASTER_MAP_TYPE map_type);
+                           RASTER_MAP_TYPE map_type,
+                           const struct Cell_head *cellhd);
 
 /*!
    \brief Open an existing integer raster map (cell)
@@ -164,6 +169,8 @@ int Rast__open_old(const char *name, const char *mapset)
     char xname[GNAME_MAX], xmapset[GMAPSET_MAX];
     struct GDAL_link *gdal;
     struct R_vrt *vrt;
+    char element[GNAME_MAX], nullc_element[GNAME_MAX];
+    int overview;
 
     Rast__init();
 
@@ -201,6 +208,9 @@ int Rast__open_old(const char *name, const char *mapset)
     /* read the cell header */
     Rast_get_cellhd(r_name, r_mapset, &cellhd);
 
+    /* with a coarse region, read an overview level instead */
+    overview = Rast__select_overview(r_name, r_mapset, &cellhd);
+
     /* now check the type */
     MAP_TYPE = Rast_map_type(r_name, r_mapset);
     if (MAP_TYPE < 0)
@@ -279,6 +289,15 @@ int Rast__open_old(const char *name, const char *mapset)
     else if (vrt) {
         cell_fd = -1;
     }
+    else if (overview) {
+        cell_fd = G_open_old_misc(
+            "cell_misc", Rast__overview_element(element, overview, NULL),
+            r_name, r_mapset);
+        if (cell_fd < 0)
+            G_fatal_error(_("Unable to open overview level %d of raster map "
+                            "<%s@%s>"),
+                          overview, r_name, r_mapset);
+    }
     else {
         /* now actually open file for reading */
         cell_fd = G_open_old(cell_dir, r_name, r_mapset);
@@ -296,10 +315,7 @@ int Rast__open_old(const char *name, const char *mapset)
     /* Save cell header */
     fcb->cellhd = cellhd;
 
-    /* allocate null bitstream buffers for reading null rows */
     fcb->null_fd = -1;
-    fcb->null_cur_row = -1;
-    fcb->null_bits = Rast__allocate_null_bits(cellhd.cols);
 
     /* mark closed */
     fcb->open_mode = -1;
@@ -308,16 +324,17 @@ int Rast__open_old(const char *name, const char *mapset)
     fcb->name = G_store(name);
     fcb->mapset = G_store(mapset);
 
-    /* mark no data row in memory  */
-    fcb->cur_row = -1;
-
     /* if reclass, copy reclass structure */
     if ((fcb->reclass_flag = reclass_flag))
         fcb->reclass = reclass;
 
     fcb->gdal = gdal;
     fcb->vrt = vrt;
+    fcb->overview = overview;
     if (!gdal && !vrt) {
+        if (!overview)
+            fcb->tiles = Rast__read_tile_info(r_name, r_mapset, &cellhd);
+
         /* check for compressed data format, making initial reads if necessary
          */
         if (Rast__check_format(fd) < 0) {
@@ -332,15 +349,6 @@ int Rast__open_old(const char *name, const char *mapset)
         Rast__create_window_mapping(fd);
     }
 
-    /*
-     * allocate the data buffer
-     * number of bytes per cell is cellhd.format+1
-     */
-
-    /* for reading fcb->data is allocated to be fcb->cellhd.cols * fcb->nbytes
-       (= XDR_FLOAT/DOUBLE_NBYTES) */
-    fcb->data = (unsigned char *)G_calloc(fcb->cellhd.cols, MAP_NBYTES);
-
     /* initialize/read in quant rules for float point maps */
     if (fcb->map_type != CELL_TYPE) {
         if (fcb->reclass_flag)
@@ -357,13 +365,35 @@ int Rast__open_old(const char *name, const char *mapset)
     fcb->nbytes = MAP_NBYTES;
     fcb->null_row_ptr = NULL;
 
+    /*
+     * allocate the data and null bitstream buffers of the default cursor
+     * number of bytes per cell is cellhd.format+1
+     * (= XDR_FLOAT/DOUBLE_NBYTES for fp maps)
+     */
+    fcb->rd = Rast__alloc_reader(fd);
+
+    fcb->map = NULL;
+    fcb->map_size = 0;
+    if (!gdal && !vrt && R__.use_mmap)
+        Rast__map_data_file(fd);
+    if (!gdal && !vrt && !fcb->tiles && R__.prefetch_rows > 0)
+        fcb->rd->prefetch = Rast__alloc_prefetch(fd, R__.prefetch_rows);
+
     if (!gdal && !vrt) {
+        const char *null_file = NULL_FILE, *nullc_file = NULLC_FILE;
+
+        if (overview) {
+            null_file = Rast__overview_element(element, overview, NULL_FILE);
+            nullc_file =
+                Rast__overview_element(nullc_element, overview, NULLC_FILE);
+        }
+
         /* First, check for compressed null file */
         fcb->null_fd =
-            G_open_old_misc("cell_misc", NULL_FILE, r_name, r_mapset);
+            G_open_old_misc("cell_misc", null_file, r_name, r_mapset);
         if (fcb->null_fd < 0) {
             fcb->null_fd =
-                G_open_old_misc("cell_misc", NULLC_FILE, r_name, r_mapset);
+                G_open_old_misc("cell_misc", nullc_file, r_name, r_mapset);
             if (fcb->null_fd >= 0) {
                 fcb->null_row_ptr =
                     G_calloc(fcb->cellhd.rows + 1, sizeof(off_t));
@@ -378,6 +408,12 @@ int Rast__open_old(const char *name, const char *mapset)
         fcb->null_file_exists = fcb->null_fd >= 0;
     }
 
+    /* decompressed rows of compressed files are cached across fds */
+    if (!gdal && !vrt && !fcb->tiles && fcb->cellhd.compressed)
+        fcb->cache_id = Rast__row_cache_id(fcb->data_fd);
+    if (fcb->null_row_ptr)
+        fcb->null_cache_id = Rast__row_cache_id(fcb->null_fd);
+
     return fd;
 }
 
@@ -410,7 +446,7 @@ int Rast__open_old(const char *name, const char *mapset)
  */
 int Rast_open_c_new(const char *name)
 {
-    return open_raster_new(name, OPEN_NEW_COMPRESSED, CELL_TYPE);
+    return open_raster_new(name, OPEN_NEW_COMPRESSED, CELL_TYPE, NULL);
 }
 
 /*!
@@ -425,7 +461,7 @@ int Rast_open_c_new(const char *name)
  */
 int Rast_open_c_new_uncompressed(const char *name)
 {
-    return open_raster_new(name, OPEN_NEW_UNCOMPRESSED, CELL_TYPE);
+    return open_raster_new(name, OPEN_NEW_UNCOMPRESSED, CELL_TYPE, NULL);
 }
 
 /*!
@@ -441,6 +477,47 @@ void Rast_want_histogram(int flag)
     R__.want_histogram = flag;
 }
 
+/*!
+   \brief Map data files of subsequently opened raster maps into memory
+
+   If <i>flag</i> is non-zero, the cell/fcell file of raster maps
+   opened afterwards with Rast_open_old() is mapped read-only into
+   memory and rows are decompressed directly from the mapping. Rows of
+   uncompressed maps are then not copied at all. This saves the
+   system call and buffer management per row, which pays off for
+   modules reading rows in random order.
+
+   The default is taken from the environment variable
+   GRASS_RASTER_MMAP. Ignored where memory mapping is not available.
+
+   \param flag non-zero to enable memory mapping
+ */
+void Rast_want_mmap(int flag)
+{
+    Rast__init();
+    R__.use_mmap = flag;
+}
+
+/*!
+   \brief Compress rows of new raster maps in background threads
+
+   Applies to maps opened with Rast_open_new() and friends afterwards.
+   Rows passed to Rast_put_row() are converted and compressed by
+   <i>nthreads</i> background threads while the module goes on, and
+   written to the files in row order. The default is taken from the
+   GRASS_RASTER_WRITE_THREADS environment variable.
+
+   Has no effect on maps written through GDAL, and when the library was
+   built without POSIX threads.
+
+   \param nthreads number of threads, 0 to compress rows at once
+ */
+void Rast_set_write_threads(int nthreads)
+{
+    Rast__init();
+    R__.write_threads = nthreads > 0 ? nthreads : 0;
+}
+
 /*!
    \brief Sets the format for subsequent opens on new integer cell files
    (uncompressed and random only).
@@ -499,7 +576,7 @@ int Rast_get_cell_format(CELL v)
  */
 int Rast_open_fp_new(const char *name)
 {
-    return open_raster_new(name, OPEN_NEW_COMPRESSED, R__.fp_type);
+    return open_raster_new(name, OPEN_NEW_COMPRESSED, R__.fp_type, NULL);
 }
 
 /*!
@@ -513,7 +590,7 @@ int Rast_open_fp_new(const char *name)
  */
 int Rast_open_fp_new_uncompressed(const char *name)
 {
-    return open_raster_new(name, OPEN_NEW_UNCOMPRESSED, R__.fp_type);
+    return open_raster_new(name, OPEN_NEW_UNCOMPRESSED, R__.fp_type, NULL);
 }
 
 static int open_raster_new_gdal(char *map, char *mapset,
@@ -576,7 +653,8 @@ static int open_raster_new_gdal(char *map, char *mapset,
 }
 
 static int open_raster_new(const char *name, int open_mode,
-                           RASTER_MAP_TYPE map_type)
+                           RASTER_MAP_TYPE map_type,
+                           const struct Cell_head *cellhd)
 {
     char xname[GNAME_MAX], xmapset[GMAPSET_MAX];
     struct fileinfo *fcb;
@@ -617,7 +695,7 @@ static int open_raster_new(const char *name, int open_mode,
     if (G_legal_filename(map) < 0)
         G_fatal_error(_("<%s> is an illegal file name"), map);
 
-    if (G_find_file2("", "GDAL", G_mapset()))
+    if (!cellhd && G_find_file2("", "GDAL", G_mapset()))
         return open_raster_new_gdal(map, mapset, map_type);
 
     /* open a tempfile name */
@@ -650,8 +728,9 @@ static int open_raster_new(const char *name, int open_mode,
 
     /* for writing fcb->data is allocated to be R__.wr_window.cols *
        sizeof(CELL or DCELL or FCELL)  */
-    fcb->data = (unsigned char *)G_calloc(R__.wr_window.cols,
-                                          Rast_cell_size(fcb->map_type));
+    fcb->data = (unsigned char *)G_calloc(
+        cellhd ? cellhd->cols : R__.wr_window.cols,
+        Rast_cell_size(fcb->map_type));
 
     /*
      * copy current window into cell header
@@ -659,12 +738,24 @@ static int open_raster_new(const char *name, int open_mode,
      * for compressed writing
      *   allocate space to hold the row address array
      */
-    fcb->cellhd = R__.wr_window;
+    fcb->cellhd = cellhd ? *cellhd : R__.wr_window;
 
     /* change open_mode to OPEN_NEW_UNCOMPRESSED if R__.compression_type == 0 ?
      */
 
-    if (open_mode == OPEN_NEW_COMPRESSED && fcb->map_type == CELL_TYPE) {
+    if (open_mode == OPEN_NEW_COMPRESSED && R__.tile_size > 0 && !cellhd) {
+        /* tiled, the tile address array takes the place of the row one */
+        fcb->tiles =
+            Rast__alloc_tiles(&fcb->cellhd, R__.tile_size, R__.tile_size);
+        Rast__write_tile_ptrs(fd);
+        fcb->cellhd.compressed = R__.compression_type;
+
+        /* integer tiles are stored with all bytes of the cells */
+        fcb->nbytes = fcb->map_type == CELL_TYPE ? (int)sizeof(CELL) : nbytes;
+        if (fcb->map_type != CELL_TYPE)
+            Rast_quant_init(&(fcb->quant));
+    }
+    else if (open_mode == OPEN_NEW_COMPRESSED && fcb->map_type == CELL_TYPE) {
         fcb->row_ptr = G_calloc(fcb->cellhd.rows + 1, sizeof(off_t));
         G_zero(fcb->row_ptr, (fcb->cellhd.rows + 1) * sizeof(off_t));
         Rast__write_row_ptrs(fd);
@@ -746,6 +837,43 @@ static int open_raster_new(const char *name, int open_mode,
     fcb->open_mode = open_mode;
     fcb->io_error = 0;
 
+    /* rows of tiled maps are collected into tiles instead */
+    if (!fcb->tiles)
+        fcb->wr = Rast__alloc_writer(fd);
+
+    /* overview levels are not the map itself */
+    if (fcb->tiles && !cellhd)
+        fcb->block_stats = Rast__alloc_block_stats(
+            &fcb->cellhd, fcb->tiles->rows, fcb->tiles->cols);
+    else if (R__.block_stats_size > 0 && !cellhd)
+        fcb->block_stats = Rast__alloc_block_stats(
+            &fcb->cellhd, R__.block_stats_size, R__.block_stats_size);
+
+    return fd;
+}
+
+/*!
+   \brief Open an overview level of a raster map for writing (internal use
+   only)
+
+   The level is written like a compressed map with Rast_put_row(), in
+   its own region, and stored by Rast_close() in cell_misc/<name>.
+
+   \param name name of a raster map in the current mapset
+   \param level decimation factor of the level
+   \param map_type map type of the map
+   \param cellhd header of the level
+
+   \return file descriptor
+ */
+int Rast__open_overview_new(const char *name, int level,
+                            RASTER_MAP_TYPE map_type,
+                            const struct Cell_head *cellhd)
+{
+    int fd = open_raster_new(name, OPEN_NEW_COMPRESSED, map_type, cellhd);
+
+    R__.fileinfo[fd].overview = level;
+
     return fd;
 }
 
@@ -1001,7 +1129,7 @@ RASTER_MAP_TYPE Rast__check_fp_type(const char *name, const char *mapset)
  */
 int Rast_open_new(const char *name, RASTER_MAP_TYPE wr_type)
 {
-    return open_raster_new(name, OPEN_NEW_COMPRESSED, wr_type);
+    return open_raster_new(name, OPEN_NEW_COMPRESSED, wr_type, NULL);
 }
 
 /*!
@@ -1016,7 +1144,7 @@ int Rast_open_new(const char *name, RASTER_MAP_TYPE wr_type)
  */
 int Rast_open_new_uncompressed(const char *name, RASTER_MAP_TYPE wr_type)
 {
-    return open_raster_new(name, OPEN_NEW_UNCOMPRESSED, wr_type);
+    return open_raster_new(name, OPEN_NEW_UNCOMPRESSED, wr_type, NULL);
 }
 
 /*!
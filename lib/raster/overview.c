@@ -0,0 +1,479 @@
+/*!
+   \file lib/raster/overview.c
+
+   \brief Raster library - Overviews of native raster maps
+
+   Overviews are reduced resolution copies of a raster map, each level
+   decimating the map by an integer factor in both directions. They
+   are stored next to the map in cell_misc/<name>: the data of level f
+   in ovr<f>, its null values in ovr<f>_null or ovr<f>_nullcmpr, in
+   the formats of a compressed cell/fcell file and of the null files.
+   The levels, the resampling method and the compressor are listed in
+   cell_misc/<name>/overviews.
+
+   With Rast_want_overviews(), Rast_open_old() reads the coarsest level
+   whose resolution is still at least as fine as the current region,
+   instead of sampling the full resolution map. Overviews are removed
+   whenever the map or its null file is rewritten.
+
+   (C) 2026 by the GRASS Development Team
+
+   This program is free software under the GNU General Public License
+   (>=v2).  Read the file COPYING that comes with GRASS for details.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include <grass/config.h>
+#include <grass/raster.h>
+#include <grass/glocale.h>
+
+#include "R.h"
+
+#define OVERVIEW_FILE "overviews"
+
+#define MAX_LEVELS 32
+
+static const char *method_names[] = {NULL, "nearest", "average", "mode"};
+
+struct level /* Overview level being built */
+{
+    int factor;           /* Decimation factor            */
+    int fd;               /* File descriptor of the level */
+    struct Cell_head hd;  /* Header of the level          */
+    DCELL *sum;           /* Sums of the current row      */
+    int *count;           /* Non-null cells of the sums   */
+    DCELL *rows;          /* Full resolution rows, mode   */
+    DCELL *out;           /* Row to write                 */
+};
+
+/* reads the list of levels, returns their number */
+static int read_levels(const char *name, const char *mapset, int *levels,
+                       int *compressed)
+{
+    struct Key_Value *key_val;
+    const char *p;
+    FILE *fp;
+    int n = 0;
+
+    fp = G_fopen_old_misc("cell_misc", OVERVIEW_FILE, name, mapset);
+    if (!fp)
+        return 0;
+    key_val = G_fread_key_value(fp);
+    fclose(fp);
+
+    if (!key_val)
+        return 0;
+
+    if ((p = G_find_key_value("levels", key_val))) {
+        char *end;
+
+        while (n < MAX_LEVELS) {
+            long f = strtol(p, &end, 10);
+
+            if (end == p)
+                break;
+            if (f > 1)
+                levels[n++] = (int)f;
+            p = end;
+        }
+    }
+
+    p = G_find_key_value("compressed", key_val);
+    *compressed = p ? atoi(p) : 0;
+    if (*compressed <= 0)
+        n = 0;
+
+    G_free_key_value(key_val);
+
+    return n;
+}
+
+/*!
+   \brief Get the name of a file of an overview level (internal use only)
+
+   \param[out] element name of the file in cell_misc/<name>
+   \param level decimation factor of the level
+   \param file NULL for the data file, otherwise name of the null file
+
+   \return element
+ */
+char *Rast__overview_element(char *element, int level, const char *file)
+{
+    if (file)
+        sprintf(element, "ovr%d_%s", level, file);
+    else
+        sprintf(element, "ovr%d", level);
+
+    return element;
+}
+
+/*!
+   \brief Get the header of an overview level (internal use only)
+
+   \param[out] hd header of the level
+   \param cellhd header of the map
+   \param level decimation factor
+ */
+void Rast__overview_cellhd(struct Cell_head *hd, const struct Cell_head *cellhd,
+                           int level)
+{
+    *hd = *cellhd;
+    hd->rows = (cellhd->rows + level - 1) / level;
+    hd->cols = (cellhd->cols + level - 1) / level;
+    hd->ns_res = cellhd->ns_res * level;
+    hd->ew_res = cellhd->ew_res * level;
+    hd->south = hd->north - hd->rows * hd->ns_res;
+    hd->east = hd->west + hd->cols * hd->ew_res;
+    hd->rows3 = hd->rows;
+    hd->cols3 = hd->cols;
+    hd->ns_res3 = hd->ns_res;
+    hd->ew_res3 = hd->ew_res;
+}
+
+/*!
+   \brief Choose the overview level to read for the current region
+   (internal use only)
+
+   \param name map name
+   \param mapset mapset of the map
+   \param[in,out] cellhd header of the map, replaced by the header of
+   the level chosen
+
+   \return decimation factor of the level
+   \return 0 if the map itself is to be read
+ */
+int Rast__select_overview(const char *name, const char *mapset,
+                          struct Cell_head *cellhd)
+{
+    int levels[MAX_LEVELS];
+    int n, i, compressed, best = 0;
+    double ratio_ns, ratio_ew;
+
+    if (!R__.use_overviews)
+        return 0;
+
+    n = read_levels(name, mapset, levels, &compressed);
+    if (n == 0)
+        return 0;
+
+    ratio_ns = R__.rd_window.ns_res / cellhd->ns_res;
+    ratio_ew = R__.rd_window.ew_res / cellhd->ew_res;
+
+    /* never coarser than the region */
+    for (i = 0; i < n; i++)
+        if (levels[i] > best && levels[i] <= ratio_ns * (1 + GRASS_EPSILON) &&
+            levels[i] <= ratio_ew * (1 + GRASS_EPSILON))
+            best = levels[i];
+
+    if (!best)
+        return 0;
+
+    G_debug(1, "Reading overview level %d of <%s@%s>", best, name, mapset);
+
+    Rast__overview_cellhd(cellhd, cellhd, best);
+    cellhd->compressed = compressed;
+    /* integer rows carry their own number of bytes */
+    if (cellhd->format >= 0)
+        cellhd->format = sizeof(CELL) - 1;
+
+    return best;
+}
+
+/*!
+   \brief Read overviews of raster maps
+
+   If <i>flag</i> is non-zero, raster maps subsequently opened with
+   Rast_open_old() are read from the coarsest overview level whose
+   resolution is at least as fine as the current region, if overviews
+   were built with Rast_build_overviews(). Values then differ from
+   those sampled from the full resolution map, which is fine for
+   display and quick looks but not for analysis.
+
+   The default is taken from the GRASS_RASTER_OVERVIEWS environment
+   variable.
+
+   \param flag non-zero to read overviews
+ */
+void Rast_want_overviews(int flag)
+{
+    Rast__init();
+    R__.use_overviews = flag;
+}
+
+/*!
+   \brief Remove the overviews of a raster map
+
+   \param name name of a raster map in the current mapset
+ */
+void Rast_remove_overviews(const char *name)
+{
+    char element[GNAME_MAX];
+    int levels[MAX_LEVELS];
+    int n, i, compressed;
+
+    n = read_levels(name, G_mapset(), levels, &compressed);
+
+    for (i = 0; i < n; i++) {
+        G_remove_misc("cell_misc",
+                      Rast__overview_element(element, levels[i], NULL), name);
+        G_remove_misc("cell_misc",
+                      Rast__overview_element(element, levels[i], "null"),
+                      name);
+        G_remove_misc("cell_misc",
+                      Rast__overview_element(element, levels[i], "nullcmpr"),
+                      name);
+    }
+
+    G_remove_misc("cell_misc", OVERVIEW_FILE, name);
+}
+
+static int cmp_dcell(const void *a, const void *b)
+{
+    DCELL x = *(const DCELL *)a;
+    DCELL y = *(const DCELL *)b;
+
+    return x < y ? -1 : x > y;
+}
+
+/* computes the cells of an overview row from the full resolution rows
+   of its block, nrows of them */
+static void resample_row(struct level *lv, int method, int cols, int nrows,
+                         DCELL *vals)
+{
+    int f = lv->factor;
+    int c;
+
+    for (c = 0; c < lv->hd.cols; c++) {
+        DCELL *out = &lv->out[c];
+
+        if (method == OVERVIEW_AVERAGE) {
+            if (lv->count[c])
+                *out = lv->sum[c] / lv->count[c];
+            else
+                Rast_set_d_null_value(out, 1);
+            lv->sum[c] = 0;
+            lv->count[c] = 0;
+        }
+        else {
+            int c0 = c * f;
+            int c1 = c0 + f < cols ? c0 + f : cols;
+            int n = 0, best = 0, run = 0;
+            int i, j;
+
+            /* non-null values of the block, sorted */
+            for (i = 0; i < nrows; i++)
+                for (j = c0; j < c1; j++) {
+                    DCELL v = lv->rows[(size_t)i * cols + j];
+
+                    if (!Rast_is_d_null_value(&v))
+                        vals[n++] = v;
+                }
+
+            if (n == 0) {
+                Rast_set_d_null_value(out, 1);
+                continue;
+            }
+
+            qsort(vals, n, sizeof(DCELL), cmp_dcell);
+
+            /* most frequent value, the smallest one on ties */
+            for (i = 0; i < n; i++) {
+                run = (i > 0 && vals[i] == vals[i - 1]) ? run + 1 : 1;
+                if (run > best) {
+                    best = run;
+                    *out = vals[i];
+                }
+            }
+        }
+    }
+}
+
+/*!
+   \brief Build overviews of a raster map
+
+   Any overviews of the map are replaced. Each level is computed from
+   the full resolution map, the mask is not applied.
+
+   Resampling methods:
+   - OVERVIEW_NEAREST: the cell at the center of each block
+   - OVERVIEW_AVERAGE: the mean of the non-null cells of each block
+   - OVERVIEW_MODE: the most frequent non-null value of each block
+
+   \param name name of a native raster map in the current mapset
+   \param levels decimation factors, greater than 1
+   \param nlevels number of levels
+   \param method resampling method
+ */
+void Rast_build_overviews(const char *name, const int *levels, int nlevels,
+                          int method)
+{
+    struct level lv[MAX_LEVELS];
+    struct Key_Value *key_val;
+    struct Cell_head cellhd, rd_window;
+    struct fileinfo *fcb;
+    RASTER_MAP_TYPE map_type;
+    const char *mapset = G_mapset();
+    char path[GPATH_MAX];
+    char buf[16 * MAX_LEVELS];
+    char rname[GNAME_MAX], rmapset[GMAPSET_MAX];
+    DCELL *row_buf, *vals = NULL;
+    int use_overviews, split_window;
+    int fd, n, i, row, col, compressed;
+
+    Rast__init();
+
+    if (method < OVERVIEW_NEAREST || method > OVERVIEW_MODE)
+        G_fatal_error(_("Invalid overview resampling method %d"), method);
+
+    if (!G_find_raster2(name, mapset))
+        G_fatal_error(_("Raster map <%s> not found in current mapset"), name);
+    if (Rast_is_reclass(name, mapset, rname, rmapset) > 0)
+        G_fatal_error(_("Raster map <%s> is a reclass of another map"), name);
+
+    /* levels in increasing order, without duplicates */
+    n = 0;
+    for (i = 0; i < nlevels; i++) {
+        int f = levels[i], j, k;
+
+        if (f <= 1)
+            G_fatal_error(_("Invalid overview level %d"), f);
+        for (j = 0; j < n && lv[j].factor < f; j++)
+            ;
+        if (j < n && lv[j].factor == f)
+            continue;
+        if (n == MAX_LEVELS)
+            G_fatal_error(_("Too many overview levels"));
+        for (k = n; k > j; k--)
+            lv[k].factor = lv[k - 1].factor;
+        lv[j].factor = f;
+        n++;
+    }
+
+    Rast_remove_overviews(name);
+
+    /* read the map at full resolution */
+    Rast_get_cellhd(name, mapset, &cellhd);
+    rd_window = R__.rd_window;
+    split_window = R__.split_window;
+    use_overviews = R__.use_overviews;
+    Rast_set_input_window(&cellhd);
+    R__.use_overviews = 0;
+
+    fd = Rast__open_old(name, mapset);
+    fcb = &R__.fileinfo[fd];
+    if (fcb->gdal || fcb->vrt)
+        G_fatal_error(_("Overviews are supported for native raster maps "
+                        "only, <%s> is not"),
+                      name);
+    map_type = fcb->map_type;
+    row_buf = Rast_allocate_d_input_buf();
+
+    for (i = 0; i < n; i++) {
+        Rast__overview_cellhd(&lv[i].hd, &cellhd, lv[i].factor);
+        lv[i].fd =
+            Rast__open_overview_new(name, lv[i].factor, map_type, &lv[i].hd);
+        lv[i].out = G_malloc(lv[i].hd.cols * sizeof(DCELL));
+        lv[i].sum = NULL;
+        lv[i].count = NULL;
+        lv[i].rows = NULL;
+        if (method == OVERVIEW_AVERAGE) {
+            lv[i].sum = G_calloc(lv[i].hd.cols, sizeof(DCELL));
+            lv[i].count = G_calloc(lv[i].hd.cols, sizeof(int));
+        }
+        else if (method == OVERVIEW_MODE)
+            lv[i].rows = G_malloc((size_t)lv[i].factor * cellhd.cols *
+                                  sizeof(DCELL));
+    }
+    if (method == OVERVIEW_MODE)
+        vals = G_malloc((size_t)lv[n - 1].factor * lv[n - 1].factor *
+                        sizeof(DCELL));
+
+    G_message(_("Building overviews of <%s>..."), name);
+
+    for (row = 0; row < cellhd.rows; row++) {
+        G_percent(row, cellhd.rows, 2);
+        Rast_get_d_row_nomask(fd, row_buf, row);
+
+        for (i = 0; i < n; i++) {
+            struct level *l = &lv[i];
+            int f = l->factor;
+            int r = row % f;
+            int last = r == f - 1 || row == cellhd.rows - 1;
+
+            switch (method) {
+            case OVERVIEW_NEAREST:
+                /* center row of the block, or the last row of a cut one */
+                if (r != f / 2 && !(last && r < f / 2))
+                    continue;
+                for (col = 0; col < l->hd.cols; col++) {
+                    int c = col * f + f / 2;
+
+                    l->out[col] = row_buf[c < cellhd.cols ? c : cellhd.cols - 1];
+                }
+                Rast_put_d_row(l->fd, l->out);
+                continue;
+            case OVERVIEW_AVERAGE:
+                for (col = 0; col < cellhd.cols; col++)
+                    if (!Rast_is_d_null_value(&row_buf[col])) {
+                        l->sum[col / f] += row_buf[col];
+                        l->count[col / f]++;
+                    }
+                break;
+            case OVERVIEW_MODE:
+                memcpy(l->rows + (size_t)r * cellhd.cols, row_buf,
+                       cellhd.cols * sizeof(DCELL));
+                break;
+            }
+
+            if (!last)
+                continue;
+
+            resample_row(l, method, cellhd.cols, r + 1, vals);
+
+            /* averages of integer maps are rounded */
+            if (method == OVERVIEW_AVERAGE && map_type == CELL_TYPE)
+                for (col = 0; col < l->hd.cols; col++)
+                    if (!Rast_is_d_null_value(&l->out[col]))
+                        l->out[col] = floor(l->out[col] + 0.5);
+
+            Rast_put_d_row(l->fd, l->out);
+        }
+    }
+    G_percent(row, cellhd.rows, 2);
+
+    /* the levels use the compressor of new maps */
+    compressed = R__.fileinfo[lv[0].fd].cellhd.compressed;
+
+    for (i = 0; i < n; i++) {
+        Rast_close(lv[i].fd);
+        G_free(lv[i].out);
+        G_free(lv[i].sum);
+        G_free(lv[i].count);
+        G_free(lv[i].rows);
+    }
+    G_free(vals);
+    G_free(row_buf);
+
+    Rast_close(fd);
+    Rast_set_input_window(&rd_window);
+    R__.split_window = split_window;
+    R__.use_overviews = use_overviews;
+
+    key_val = G_create_key_value();
+    buf[0] = '\0';
+    for (i = 0; i < n; i++)
+        sprintf(buf + strlen(buf), i ? " %d" : "%d", lv[i].factor);
+    G_set_key_value("levels", buf, key_val);
+    G_set_key_value("method", method_names[method], key_val);
+    sprintf(buf, "%d", compressed);
+    G_set_key_value("compressed", buf, key_val);
+
+    G__make_mapset_element_misc("cell_misc", name);
+    G_file_name_misc(path, "cell_misc", OVERVIEW_FILE, name, mapset);
+    G_write_key_value_file(path, key_val);
+    G_free_key_value(key_val);
+}
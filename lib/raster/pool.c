@@ -0,0 +1,200 @@
+/*!
+   \file lib/raster/pool.c
+
+   \brief Raster library - Background threads
+
+   A small pool of threads shared by all maps, used to read rows ahead
+   (see prefetch.c) and to compress rows of new maps (see put_row.c).
+   Jobs are run in the order they are queued. Without POSIX threads
+   jobs are run at once by the thread queueing them.
+
+   Jobs may access R__.fileinfo, which is therefore only reallocated
+   when no job is pending.
+
+   Jobs must not call G_fatal_error(): exit() from a background thread
+   would run the exit handlers while the module is still at work. They
+   record errors instead, which are reported by the thread waiting for
+   the job (a row read ahead is read again, a row which could not be
+   compressed is reported when it is written). Only running out of
+   memory in G_malloc() still ends the process from a background thread.
+
+   (C) 2026 by the GRASS Development Team
+
+   This program is free software under the GNU General Public License
+   (>=v2).  Read the file COPYING that comes with GRASS for details.
+ */
+
+#include <grass/config.h>
+#include <grass/raster.h>
+#include <grass/glocale.h>
+
+#include "R.h"
+
+#ifdef HAVE_PTHREAD_H
+
+#include <pthread.h>
+
+#define MAX_THREADS 64
+
+static int num_threads;
+static int num_pending;
+static pthread_mutex_t pool_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t work_cond = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t done_cond = PTHREAD_COND_INITIALIZER;
+static struct R_job *queue_head, *queue_tail;
+
+static void *pool_thread(void *arg UNUSED)
+{
+    pthread_mutex_lock(&pool_mutex);
+
+    for (;;) {
+        struct R_job *job;
+
+        while (!queue_head)
+            pthread_cond_wait(&work_cond, &pool_mutex);
+
+        job = queue_head;
+        queue_head = job->next;
+        if (!queue_head)
+            queue_tail = NULL;
+        job->next = NULL;
+        job->state = JOB_BUSY;
+        pthread_mutex_unlock(&pool_mutex);
+
+        (*job->func)(job->closure);
+
+        pthread_mutex_lock(&pool_mutex);
+        job->state = JOB_DONE;
+        num_pending--;
+        pthread_cond_broadcast(&done_cond);
+    }
+
+    return NULL;
+}
+
+/*!
+   \brief Start background threads (internal use only)
+
+   \param n number of threads wanted
+
+   \return number of threads running, at most n
+ */
+int Rast__start_threads(int n)
+{
+    if (n > MAX_THREADS)
+        n = MAX_THREADS;
+
+    pthread_mutex_lock(&pool_mutex);
+    while (num_threads < n) {
+        pthread_t thread;
+
+        if (pthread_create(&thread, NULL, pool_thread, NULL) != 0) {
+            G_debug(1, "Unable to start raster library thread");
+            break;
+        }
+        pthread_detach(thread);
+        num_threads++;
+    }
+    if (n > num_threads)
+        n = num_threads;
+    pthread_mutex_unlock(&pool_mutex);
+
+    return n;
+}
+
+/*!
+   \brief Queue a job for the background threads (internal use only)
+
+   The job must not be queued or running.
+
+   \param job job
+   \param func function to run
+   \param closure argument of func
+ */
+void Rast__queue_job(struct R_job *job, void (*func)(void *), void *closure)
+{
+    pthread_mutex_lock(&pool_mutex);
+    job->func = func;
+    job->closure = closure;
+    job->state = JOB_QUEUED;
+    job->next = NULL;
+    if (queue_tail)
+        queue_tail->next = job;
+    else
+        queue_head = job;
+    queue_tail = job;
+    num_pending++;
+    pthread_cond_signal(&work_cond);
+    pthread_mutex_unlock(&pool_mutex);
+}
+
+/*!
+   \brief Wait until a job is finished (internal use only)
+
+   \param job job, may be one never queued
+ */
+void Rast__wait_job(struct R_job *job)
+{
+    pthread_mutex_lock(&pool_mutex);
+    while (job->state == JOB_QUEUED || job->state == JOB_BUSY)
+        pthread_cond_wait(&done_cond, &pool_mutex);
+    pthread_mutex_unlock(&pool_mutex);
+}
+
+/*!
+   \brief Check whether a job is finished (internal use only)
+
+   \param job job, may be one never queued
+
+   \return 1 if the job is not queued or running
+ */
+int Rast__job_done(struct R_job *job)
+{
+    int done;
+
+    pthread_mutex_lock(&pool_mutex);
+    done = job->state != JOB_QUEUED && job->state != JOB_BUSY;
+    pthread_mutex_unlock(&pool_mutex);
+
+    return done;
+}
+
+/*!
+   \brief Wait until all queued jobs are finished (internal use only)
+ */
+void Rast__wait_all_jobs(void)
+{
+    pthread_mutex_lock(&pool_mutex);
+    while (num_pending > 0)
+        pthread_cond_wait(&done_cond, &pool_mutex);
+    pthread_mutex_unlock(&pool_mutex);
+}
+
+#else
+
+int Rast__start_threads(int n UNUSED)
+{
+    return 0;
+}
+
+void Rast__queue_job(struct R_job *job, void (*func)(void *), void *closure)
+{
+    job->state = JOB_BUSY;
+    (*func)(closure);
+    job->state = JOB_DONE;
+}
+
+void Rast__wait_job(struct R_job *job UNUSED)
+{
+}
+
+int Rast__job_done(struct R_job *job UNUSED)
+{
+    return 1;
+}
+
+void Rast__wait_all_jobs(void)
+{
+}
+
+#endif
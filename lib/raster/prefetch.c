@@ -0,0 +1,246 @@
+/*!
+   \file lib/raster/prefetch.c
+
+   \brief Raster library - Reading rows ahead in the background
+
+   When read-ahead is enabled for a map, each time Rast_get_row() moves
+   to a new row the following rows are queued for the background
+   threads (see pool.c). These read and decompress the rows, including
+   their null bits, into buffers of their own, so that for sequential
+   reading the next row is usually ready when it is requested.
+
+   Only native raster maps are read ahead. Without POSIX threads
+   read-ahead is not available and rows are read on request as usual.
+
+   The background threads must not call G_fatal_error(), which would
+   exit from a thread the module knows nothing about. A row which cannot
+   be read ahead is dropped and read again when it is requested, so
+   that the error is reported by the thread reading the map.
+
+   (C) 2026 by the GRASS Development Team
+
+   This program is free software under the GNU General Public License
+   (>=v2).  Read the file COPYING that comes with GRASS for details.
+ */
+
+#include <grass/config.h>
+#include <grass/raster.h>
+#include <grass/glocale.h>
+
+#include "R.h"
+
+/* rows of one map hardly keep more threads busy */
+#define MAX_PREFETCH_THREADS 4
+
+static void read_row(void *closure)
+{
+    struct R_prefetch_slot *slot = closure;
+
+    slot->has_nulls = Rast__read_ahead(slot->rd, slot->row);
+}
+
+/*!
+   \brief Set up read-ahead for a cursor (internal use only)
+
+   \param fd file descriptor of a native map opened for reading
+   \param depth number of rows to read ahead
+
+   \return pointer to read-ahead state
+   \return NULL if no background thread could be started
+ */
+struct R_prefetch *Rast__alloc_prefetch(int fd, int depth)
+{
+    struct R_prefetch *pf;
+    int i;
+
+    if (depth <= 0 ||
+        Rast__start_threads(depth < MAX_PREFETCH_THREADS
+                                ? depth
+                                : MAX_PREFETCH_THREADS) == 0)
+        return NULL;
+
+    pf = G_malloc(sizeof(struct R_prefetch));
+    pf->depth = depth;
+    pf->last_row = -1;
+    pf->slots = G_calloc(depth, sizeof(struct R_prefetch_slot));
+
+    for (i = 0; i < depth; i++) {
+        struct R_prefetch_slot *slot = &pf->slots[i];
+
+        slot->row = -1;
+        slot->job.state = JOB_FREE;
+        slot->rd = Rast__alloc_reader(fd);
+        slot->rd->background = 1;
+    }
+
+    return pf;
+}
+
+/*!
+   \brief Release read-ahead state (internal use only)
+
+   Waits for rows still being read.
+
+   \param pf read-ahead state or NULL
+ */
+void Rast__free_prefetch(struct R_prefetch *pf)
+{
+    int i;
+
+    if (!pf)
+        return;
+
+    for (i = 0; i < pf->depth; i++) {
+        Rast__wait_job(&pf->slots[i].job);
+        Rast__free_reader(pf->slots[i].rd);
+    }
+
+    G_free(pf->slots);
+    G_free(pf);
+}
+
+/*!
+   \brief Drop all rows read ahead by a cursor (internal use only)
+
+   \param rd cursor with read-ahead enabled
+ */
+void Rast__reset_prefetch(struct Rast_reader *rd)
+{
+    struct R_prefetch *pf = rd->prefetch;
+    int i;
+
+    for (i = 0; i < pf->depth; i++) {
+        struct R_prefetch_slot *slot = &pf->slots[i];
+
+        Rast__wait_job(&slot->job);
+        slot->row = -1;
+    }
+}
+
+/*!
+   \brief Queue a cell file row for reading ahead (internal use only)
+
+   Slots holding rows behind the current row of the cursor are reused.
+
+   \param rd cursor with read-ahead enabled
+   \param r cell file row
+
+   \return 1 if the row is queued or already read
+   \return 0 if no slot is free
+ */
+int Rast__prefetch_row(struct Rast_reader *rd, int r)
+{
+    struct R_prefetch *pf = rd->prefetch;
+    struct R_prefetch_slot *slot = NULL;
+    int i;
+
+    for (i = 0; i < pf->depth; i++) {
+        struct R_prefetch_slot *s = &pf->slots[i];
+
+        if (s->row == r)
+            return 1;
+        if (!slot && s->row < rd->cur_row)
+            slot = s;
+    }
+
+    if (!slot)
+        return 0;
+
+    Rast__wait_job(&slot->job);
+    slot->row = r;
+    slot->has_nulls = 0;
+    Rast__queue_job(&slot->job, read_row, slot);
+
+    return 1;
+}
+
+/*!
+   \brief Take the current row of a cursor from its read-ahead slots
+   (internal use only)
+
+   The buffers of the slot are swapped with those of the cursor, the
+   null bits too if they were read.
+
+   \param rd cursor with read-ahead enabled, cur_row set to the cell
+   file row wanted
+   \param row window row being read
+
+   \return 1 if the row was read ahead
+   \return 0 if it has to be read now
+ */
+int Rast__get_prefetched_row(struct Rast_reader *rd, int row)
+{
+    struct R_prefetch *pf = rd->prefetch;
+    struct R_prefetch_slot *slot = NULL;
+    struct Rast_reader *srd;
+    unsigned char *buf;
+    int i;
+
+    for (i = 0; i < pf->depth; i++) {
+        if (pf->slots[i].row == rd->cur_row) {
+            slot = &pf->slots[i];
+            break;
+        }
+    }
+
+    if (!slot)
+        return 0;
+
+    Rast__wait_job(&slot->job);
+    srd = slot->rd;
+
+    if (srd->failed) {
+        slot->row = -1;
+        return 0;
+    }
+
+    buf = rd->data;
+    rd->data = srd->data;
+    rd->row = srd->row == srd->data ? rd->data : srd->row;
+    rd->cur_nbytes = srd->cur_nbytes;
+    srd->data = buf;
+
+    if (slot->has_nulls) {
+        buf = rd->null_bits;
+        rd->null_bits = srd->null_bits;
+        srd->null_bits = buf;
+        rd->null_cur_row = row;
+    }
+
+    slot->row = -1;
+
+    return 1;
+}
+
+/*!
+   \brief Read rows of a raster map ahead in the background
+
+   For modules reading a map row by row from top to bottom, the next
+   <i>nrows</i> rows are read and decompressed by background threads
+   while the current row is processed. Applies to Rast_get_row() and
+   friends on the file descriptor. The default is taken from the
+   GRASS_RASTER_PREFETCH environment variable.
+
+   Ignored for maps linked with r.external, for virtual rasters and
+   tiled maps, and when the library was built without POSIX threads.
+
+   \param fd file descriptor returned by Rast_open_old()
+   \param nrows number of rows to read ahead, 0 to disable
+ */
+void Rast_set_prefetch(int fd, int nrows)
+{
+    struct fileinfo *fcb;
+
+    if (fd < 0 || fd >= R__.fileinfo_count ||
+        R__.fileinfo[fd].open_mode != OPEN_OLD)
+        G_fatal_error(_("Rast_set_prefetch: file descriptor %d is not open "
+                        "for reading"),
+                      fd);
+
+    fcb = &R__.fileinfo[fd];
+    if (fcb->gdal || fcb->vrt || fcb->tiles)
+        return;
+
+    Rast__free_prefetch(fcb->rd->prefetch);
+    fcb->rd->prefetch = Rast__alloc_prefetch(fd, nrows);
+}
@@ -112,29 +112,6 @@ void Rast_put_d_row(int fd, const DCELL *buf)
     Rast_put_row(fd, buf, DCELL_TYPE);
 }
 
-static void write_data(int fd, int row, unsigned char *buf, int n)
-{
-    struct fileinfo *fcb = &R__.fileinfo[fd];
-    ssize_t nwrite = fcb->nbytes * n;
-
-    if (write(fcb->data_fd, buf, nwrite) != nwrite)
-        G_fatal_error(
-            _("Error writing uncompressed FP data for row %d of <%s>: %s"), row,
-            fcb->name, strerror(errno));
-}
-
-static void write_data_compressed(int fd, int row, unsigned char *buf, int n,
-                                  int compressor)
-{
-    struct fileinfo *fcb = &R__.fileinfo[fd];
-    int nwrite = fcb->nbytes * n;
-
-    if (G_write_compressed(fcb->data_fd, buf, nwrite, compressor) < 0)
-        G_fatal_error(
-            _("Error writing compressed FP data for row %d of <%s>: %s"), row,
-            fcb->name, strerror(errno));
-}
-
 static void set_file_pointer(int fd, int row)
 {
     struct fileinfo *fcb = &R__.fileinfo[fd];
@@ -152,19 +129,15 @@ static void convert_float(float *work_buf, char *null_buf, const FCELL *rast,
 {
     int i;
 
+    /* substitute embedded null vals by 0's */
     for (i = 0; i < n; i++) {
-        FCELL f;
-
-        /* substitute embedded null vals by 0's */
-        if (Rast_is_f_null_value(&rast[i])) {
-            f = 0.;
-            null_buf[i] = 1;
-        }
-        else
-            f = rast[i];
+        int is_null = Rast_is_f_null_value(&rast[i]);
 
-        G_xdr_put_float(&work_buf[i], &f);
+        work_buf[i] = is_null ? 0.f : rast[i];
+        null_buf[i] |= is_null;
     }
+
+    G_xdr_put_floats(work_buf, work_buf, n);
 }
 
 static void convert_double(double *work_buf, char *null_buf, const DCELL *rast,
@@ -172,52 +145,39 @@ static void convert_double(double *work_buf, char *null_buf, const DCELL *rast,
 {
     int i;
 
+    /* substitute embedded null vals by 0's */
     for (i = 0; i < n; i++) {
-        DCELL d;
+        int is_null = Rast_is_d_null_value(&rast[i]);
 
-        /* substitute embedded null vals by 0's */
-        if (Rast_is_d_null_value(&rast[i])) {
-            d = 0.;
-            null_buf[i] = 1;
-        }
-        else
-            d = rast[i];
-
-        G_xdr_put_double(&work_buf[i], &d);
+        work_buf[i] = is_null ? 0. : rast[i];
+        null_buf[i] |= is_null;
     }
+
+    G_xdr_put_doubles(work_buf, work_buf, n);
 }
 
-/* writes data to fcell file for either full or partial rows */
-static void put_fp_data(int fd, char *null_buf, const void *rast, int row,
-                        int n, RASTER_MAP_TYPE data_type)
+/* converts a row of a fp map into file format and compresses it */
+static void encode_fp_row(struct fileinfo *fcb, struct R_write_slot *slot)
 {
-    struct fileinfo *fcb = &R__.fileinfo[fd];
-    int compressed = (fcb->open_mode == OPEN_NEW_COMPRESSED);
-    int size = fcb->nbytes * fcb->cellhd.cols;
-    void *work_buf;
-
-    if (row < 0 || row >= fcb->cellhd.rows)
-        return;
+    int n = fcb->cellhd.cols;
+    int size = fcb->nbytes * n;
+    int nwrite;
 
-    if (n <= 0)
-        return;
-
-    work_buf = G_malloc(size + 1);
-
-    if (compressed)
-        set_file_pointer(fd, row);
-
-    if (data_type == FCELL_TYPE)
-        convert_float(work_buf, null_buf, rast, n);
+    if (fcb->map_type == FCELL_TYPE)
+        convert_float((float *)slot->work, slot->null_buf, slot->src, n);
     else
-        convert_double(work_buf, null_buf, rast, n);
+        convert_double((double *)slot->work, slot->null_buf, slot->src, n);
 
-    if (compressed)
-        write_data_compressed(fd, row, work_buf, n, fcb->cellhd.compressed);
-    else
-        write_data(fd, row, work_buf, n);
+    if (fcb->open_mode != OPEN_NEW_COMPRESSED) {
+        slot->out = slot->work;
+        slot->out_size = size;
+        return;
+    }
 
-    G_free(work_buf);
+    nwrite = G_compress_flagged(slot->work, size, slot->cmp, slot->cmp_size,
+                                fcb->cellhd.compressed);
+    slot->out = nwrite > 0 ? slot->cmp : NULL;
+    slot->out_size = nwrite > 0 ? nwrite : 0;
 }
 
 static void convert_int(unsigned char *wk, char *null_buf, const CELL *rast,
@@ -333,93 +293,59 @@ static int rle_compress(unsigned char *dst, unsigned char *src, int n,
     return (nwrite >= total) ? 0 : nwrite;
 }
 
-static void put_data(int fd, char *null_buf, const CELL *cell, int row, int n,
-                     int zeros_r_nulls)
+/* converts a row of an int map into file format and compresses it */
+static void encode_int_row(struct fileinfo *fcb, struct R_write_slot *slot)
 {
-    struct fileinfo *fcb = &R__.fileinfo[fd];
     int compressed = (fcb->open_mode == OPEN_NEW_COMPRESSED);
+    int n = fcb->cellhd.cols;
     int len = compressed ? (int)sizeof(CELL) : fcb->nbytes;
-    unsigned char *work_buf, *wk;
+    unsigned char *work_buf = slot->work;
+    unsigned char *compressed_buf = slot->cmp;
+    unsigned char *wk = work_buf;
+    int nbytes, total;
     ssize_t nwrite;
 
-    if (row < 0 || row >= fcb->cellhd.rows)
-        return;
-
-    if (n <= 0)
-        return;
-
-    work_buf = G_malloc(fcb->cellhd.cols * sizeof(CELL) + 1);
-    wk = work_buf;
-
-    if (compressed)
-        set_file_pointer(fd, row);
-
     if (compressed)
         wk++;
 
-    convert_int(wk, null_buf, cell, n, len, zeros_r_nulls);
-
-    if (compressed) {
-        int nbytes = count_bytes(wk, n, len);
-        unsigned char *compressed_buf;
-        int total, cmax;
+    convert_int(wk, slot->null_buf, slot->src, n, len, slot->zeros_r_nulls);
 
-        if (fcb->nbytes < nbytes)
-            fcb->nbytes = nbytes;
-
-        /* first trim away zero high bytes */
-        if (nbytes < len)
-            trim_bytes(wk, n, len, len - nbytes);
-
-        total = nbytes * n;
-        /* get upper bound of compressed size */
-        if (fcb->cellhd.compressed == 1)
-            cmax = total;
-        else
-            cmax = G_compress_bound(total, fcb->cellhd.compressed);
-        compressed_buf = G_malloc(cmax + 1);
+    if (!compressed) {
+        slot->out = work_buf;
+        slot->out_size = (size_t)fcb->nbytes * n;
+        return;
+    }
 
-        compressed_buf[0] = work_buf[0] = nbytes;
+    nbytes = count_bytes(wk, n, len);
 
-        /* then compress the data */
-        if (fcb->cellhd.compressed == 1)
-            nwrite = rle_compress(compressed_buf + 1, work_buf + 1, n, nbytes);
-        else {
-            nwrite = G_compress(work_buf + 1, total, compressed_buf + 1, cmax,
-                                fcb->cellhd.compressed);
-        }
+    /* first trim away zero high bytes */
+    if (nbytes < len)
+        trim_bytes(wk, n, len, len - nbytes);
 
-        if (nwrite >= total)
-            nwrite = 0;
+    total = nbytes * n;
+    compressed_buf[0] = work_buf[0] = nbytes;
 
-        if (nwrite > 0) {
-            nwrite++;
+    /* then compress the data */
+    if (fcb->cellhd.compressed == 1)
+        nwrite = rle_compress(compressed_buf + 1, work_buf + 1, n, nbytes);
+    else {
+        nwrite = G_compress(work_buf + 1, total, compressed_buf + 1,
+                            slot->cmp_size - 1, fcb->cellhd.compressed);
+    }
 
-            if (write(fcb->data_fd, compressed_buf, nwrite) != nwrite)
-                G_fatal_error(
-                    _("Error writing compressed data for row %d of <%s>: %s"),
-                    row, fcb->name, strerror(errno));
-        }
-        else {
-            nwrite = nbytes * n + 1;
-            if (write(fcb->data_fd, work_buf, nwrite) != nwrite)
-                G_fatal_error(
-                    _("Error writing compressed data for row %d of <%s>: %s"),
-                    row, fcb->name, strerror(errno));
-        }
+    if (nwrite >= total)
+        nwrite = 0;
 
-        G_free(compressed_buf);
+    if (nwrite > 0) {
+        slot->out = compressed_buf;
+        slot->out_size = nwrite + 1;
     }
     else {
-        nwrite = fcb->nbytes * n;
-
-        if (write(fcb->data_fd, work_buf, nwrite) != nwrite)
-            G_fatal_error(
-                _("Error writing uncompressed data for row %d of <%s>: %s"),
-                row, fcb->name, strerror(errno));
+        slot->out = work_buf;
+        slot->out_size = total + 1;
     }
 
-    G_free(work_buf);
+    slot->nbytes = nbytes;
 }
 
 static void put_data_gdal(int fd, const void *rast, int row, int n,
@@ -478,110 +404,435 @@ static void put_data_gdal(int fd, const void *rast, int row, int n,
                       fcb->name);
 }
 
-static void put_raster_data(int fd, char *null_buf, const void *rast, int row,
-                            int n, int zeros_r_nulls, RASTER_MAP_TYPE map_type)
+/* compresses null bits for a compressed null file, returns data to write */
+static const unsigned char *compress_null_bits(const struct fileinfo *fcb,
+                                               const unsigned char *flags,
+                                               size_t size, unsigned char *cmp,
+                                               size_t cmax, size_t *nwrite)
+{
+    if (fcb->null_row_ptr) {
+        /* compress null bits file with LZ4, see lib/gis/compress.h */
+        int n = G_compress((unsigned char *)flags, size, cmp, cmax, 3);
+
+        if (n > 0 && (size_t)n < size) {
+            *nwrite = n;
+            return cmp;
+        }
+    }
+
+    *nwrite = size;
+
+    return flags;
+}
+
+static void write_null_data(int fd, int row, const unsigned char *data,
+                            size_t nwrite)
 {
     struct fileinfo *fcb = &R__.fileinfo[fd];
+    ssize_t res;
 
-    if (fcb->gdal)
-        put_data_gdal(fd, rast, row, n, zeros_r_nulls, map_type);
-    else if (map_type == CELL_TYPE)
-        put_data(fd, null_buf, rast, row, n, zeros_r_nulls);
+    if (fcb->null_row_ptr) {
+        fcb->null_row_ptr[row] = lseek(fcb->null_fd, 0L, SEEK_CUR);
+        if (fcb->null_row_ptr[row] == -1) {
+            int err = errno;
+            G_fatal_error(_("File read/write operation failed: %s (%d)"),
+                          strerror(err), err);
+        }
+
+        if ((res = write(fcb->null_fd, data, nwrite)) < 0 ||
+            (size_t)res != nwrite)
+            G_fatal_error(
+                _("Error writing compressed null data for row %d of <%s>: %s"),
+                row, fcb->name, strerror(errno));
+        return;
+    }
+
+    if (lseek(fcb->null_fd, (off_t)nwrite * row, SEEK_SET) == -1)
+        G_fatal_error(_("Error writing null row %d of <%s>"), row, fcb->name);
+
+    if ((res = write(fcb->null_fd, data, nwrite)) < 0 || (size_t)res != nwrite)
+        G_fatal_error(_("Error writing null row %d of <%s>: %s"), row,
+                      fcb->name, strerror(errno));
+}
+
+/*!
+   \brief Write null data
+
+   \param flags ?
+   \param row row number
+   \param col col number
+   \param fd file descriptor of cell data file
+
+   \return void
+ */
+void Rast__write_null_bits(int fd, const unsigned char *flags)
+{
+    struct fileinfo *fcb = &R__.fileinfo[fd];
+    int row = fcb->null_cur_row++;
+    size_t size = Rast__null_bitstream_size(fcb->cellhd.cols);
+    unsigned char *compressed_buf = NULL;
+    const unsigned char *data;
+    size_t cmax = 0, nwrite;
+
+    if (fcb->null_row_ptr) {
+        /* get upper bound of compressed size */
+        cmax = G_compress_bound(size, 3);
+        compressed_buf = G_malloc(cmax);
+    }
+
+    data = compress_null_bits(fcb, flags, size, compressed_buf, cmax, &nwrite);
+    write_null_data(fd, row, data, nwrite);
+
+    G_free(compressed_buf);
+}
+
+/* encodes a row with its null bits, run by the background threads */
+static void encode_row(void *closure)
+{
+    struct R_write_slot *slot = closure;
+    struct fileinfo *fcb = &R__.fileinfo[slot->fd];
+    int cols = fcb->cellhd.cols;
+
+    G_zero(slot->null_buf, cols);
+
+    if (fcb->map_type == CELL_TYPE)
+        encode_int_row(fcb, slot);
     else
-        put_fp_data(fd, null_buf, rast, row, n, map_type);
+        encode_fp_row(fcb, slot);
+
+    Rast__convert_01_flags(slot->null_buf, slot->null_bits, cols);
+    slot->null_out = compress_null_bits(
+        fcb, slot->null_bits, Rast__null_bitstream_size(cols), slot->null_cmp,
+        slot->null_cmp_size, &slot->null_out_size);
 }
 
-static void put_null_value_row(int fd, const char *flags)
+static void write_error(int fd, int row)
 {
     struct fileinfo *fcb = &R__.fileinfo[fd];
+    int compressed = (fcb->open_mode == OPEN_NEW_COMPRESSED);
+    int err = errno;
 
-    if (fcb->gdal)
+    if (fcb->map_type == CELL_TYPE && compressed)
+        G_fatal_error(_("Error writing compressed data for row %d of <%s>: %s"),
+                      row, fcb->name, strerror(err));
+    if (fcb->map_type == CELL_TYPE)
         G_fatal_error(
-            _("GDAL output doesn't support writing null rows separately"));
+            _("Error writing uncompressed data for row %d of <%s>: %s"), row,
+            fcb->name, strerror(err));
+    if (compressed)
+        G_fatal_error(
+            _("Error writing compressed FP data for row %d of <%s>: %s"), row,
+            fcb->name, strerror(err));
+    G_fatal_error(
+        _("Error writing uncompressed FP data for row %d of <%s>: %s"), row,
+        fcb->name, strerror(err));
+}
 
-    if (fcb->null_fd < 0)
-        G_fatal_error(_("No null file for <%s>"), fcb->name);
+/* writes an encoded row and its null bits to the files of the map */
+static void write_row(int fd, struct R_write_slot *slot)
+{
+    struct fileinfo *fcb = &R__.fileinfo[fd];
+    int row = slot->row;
 
-    Rast__convert_01_flags(flags, fcb->null_bits, fcb->cellhd.cols);
+    if (row < fcb->cellhd.rows) {
+        if (fcb->open_mode == OPEN_NEW_COMPRESSED) {
+            set_file_pointer(fd, row);
+            if (fcb->map_type == CELL_TYPE && fcb->nbytes < slot->nbytes)
+                fcb->nbytes = slot->nbytes;
+        }
 
-    Rast__write_null_bits(fd, fcb->null_bits);
+        if (!slot->out)
+            G_fatal_error(_("Error compressing data for row %d of <%s>"), row,
+                          fcb->name);
+
+        if (write(fcb->data_fd, slot->out, slot->out_size) !=
+            (ssize_t)slot->out_size)
+            write_error(fd, row);
+    }
+
+    /* write the null row for the data row */
+    write_null_data(fd, fcb->null_cur_row++, slot->null_out,
+                    slot->null_out_size);
+}
+
+/* writes the oldest row waiting in the writer */
+static void write_next_row(int fd)
+{
+    struct R_writer *wr = R__.fileinfo[fd].wr;
+    struct R_write_slot *slot = &wr->slots[wr->next_row % wr->nslots];
+
+    Rast__wait_job(&slot->job);
+    write_row(fd, slot);
+    slot->row = -1;
+    wr->next_row++;
 }
 
-static void write_null_bits_compressed(const unsigned char *flags, int row,
-                                       size_t size, int fd)
+/* hands a row over to the writer of the map */
+static void put_data(int fd, const void *rast, int zeros_r_nulls)
 {
     struct fileinfo *fcb = &R__.fileinfo[fd];
-    unsigned char *compressed_buf;
-    ssize_t nwrite;
-    size_t cmax;
-    int res;
+    struct R_writer *wr = fcb->wr;
+    int row = fcb->cur_row;
+    struct R_write_slot *slot = &wr->slots[row % wr->nslots];
+
+    /* all slots taken, write out rows up to the one in the slot */
+    while (slot->row >= 0)
+        write_next_row(fd);
+
+    slot->row = row;
+    slot->zeros_r_nulls = zeros_r_nulls;
+
+    if (wr->nslots == 1) {
+        slot->src = rast;
+        encode_row(slot);
+    }
+    else {
+        memcpy(slot->rast, rast,
+               (size_t)fcb->cellhd.cols * Rast_cell_size(fcb->map_type));
+        slot->src = slot->rast;
+        Rast__queue_job(&slot->job, encode_row, slot);
+    }
+
+    /* write out rows already encoded, in order */
+    while (wr->next_row <= row &&
+           Rast__job_done(&wr->slots[wr->next_row % wr->nslots].job))
+        write_next_row(fd);
+}
+
+/* copies a tile out of the tile row being written and compresses it,
+   run by the background threads */
+static void compress_tile(void *closure)
+{
+    struct R_tile_job *tj = closure;
+    struct fileinfo *fcb = &R__.fileinfo[tj->fd];
+    struct R_tiles *tl = fcb->tiles;
+    int col = tj->col * tl->cols;
+    int row = tj->band * tl->rows;
+    int ncols = fcb->cellhd.cols - col < tl->cols ? fcb->cellhd.cols - col
+                                                   : tl->cols;
+    int nrows = fcb->cellhd.rows - row < tl->rows ? fcb->cellhd.rows - row
+                                                   : tl->rows;
+    size_t row_size = (size_t)ncols * fcb->nbytes;
+    int i;
+
+    for (i = 0; i < nrows; i++)
+        memcpy(tj->tile + i * row_size,
+               tl->band + ((size_t)i * fcb->cellhd.cols + col) * fcb->nbytes,
+               row_size);
+
+    tj->nwrite = G_compress_flagged(tj->tile, (int)row_size * nrows, tj->cmp,
+                                    tj->cmp_size, fcb->cellhd.compressed);
+}
+
+static void write_tile(int fd, struct R_tile_job *tj)
+{
+    struct fileinfo *fcb = &R__.fileinfo[fd];
+    struct R_tiles *tl = fcb->tiles;
+    int tile = tj->band * tl->ncols + tj->col;
 
-    fcb->null_row_ptr[row] = lseek(fcb->null_fd, 0L, SEEK_CUR);
-    if (fcb->null_row_ptr[row] == -1) {
+    tl->ptr[tile] = lseek(fcb->data_fd, 0L, SEEK_CUR);
+    if (tl->ptr[tile] == -1) {
         int err = errno;
         G_fatal_error(_("File read/write operation failed: %s (%d)"),
                       strerror(err), err);
     }
 
-    /* get upper bound of compressed size */
-    cmax = G_compress_bound(size, 3);
-    compressed_buf = G_malloc(cmax);
+    if (tj->nwrite <= 0)
+        G_fatal_error(_("Error compressing data for tile %d of <%s>"), tile,
+                      fcb->name);
 
-    /* compress null bits file with LZ4, see lib/gis/compress.h */
-    nwrite = G_compress((unsigned char *)flags, size, compressed_buf, cmax, 3);
+    if (write(fcb->data_fd, tj->cmp, tj->nwrite) != tj->nwrite)
+        G_fatal_error(_("Error writing compressed data for tile %d of <%s>: "
+                        "%s"),
+                      tile, fcb->name, strerror(errno));
+}
 
-    if (nwrite > 0 && (size_t)nwrite < size) {
-        if ((res = write(fcb->null_fd, compressed_buf, nwrite)) < 0 ||
-            (unsigned int)res != nwrite)
-            G_fatal_error(
-                _("Error writing compressed null data for row %d of <%s>: %s"),
-                row, fcb->name, strerror(errno));
+/* compresses and writes the tiles of a complete tile row */
+static void write_tile_band(int fd, int band)
+{
+    struct R_tiles *tl = R__.fileinfo[fd].tiles;
+    int first, i, n;
+
+    for (first = 0; first < tl->ncols; first += tl->njobs) {
+        n = tl->ncols - first < tl->njobs ? tl->ncols - first : tl->njobs;
+
+        for (i = 0; i < n; i++) {
+            struct R_tile_job *tj = &tl->jobs[i];
+
+            tj->band = band;
+            tj->col = first + i;
+            if (tl->njobs > 1)
+                Rast__queue_job(&tj->job, compress_tile, tj);
+            else
+                compress_tile(tj);
+        }
+
+        for (i = 0; i < n; i++) {
+            Rast__wait_job(&tl->jobs[i].job);
+            write_tile(fd, &tl->jobs[i]);
+        }
     }
-    else {
-        if ((res = write(fcb->null_fd, flags, size)) < 0 ||
-            (unsigned int)res != size)
-            G_fatal_error(
-                _("Error writing compressed null data for row %d of <%s>: %s"),
-                row, fcb->name, strerror(errno));
+}
+
+static void alloc_tile_buffers(int fd)
+{
+    struct fileinfo *fcb = &R__.fileinfo[fd];
+    struct R_tiles *tl = fcb->tiles;
+    int tile_size = tl->rows * tl->cols * fcb->nbytes;
+    int threads = Rast__start_threads(R__.write_threads);
+    int i;
+
+    tl->band = G_malloc((size_t)tl->rows * fcb->cellhd.cols * fcb->nbytes);
+    tl->null_buf = G_malloc(fcb->cellhd.cols);
+
+    tl->njobs = threads > 1 ? threads : 1;
+    if (tl->njobs > tl->ncols)
+        tl->njobs = tl->ncols;
+    tl->jobs = G_calloc(tl->njobs, sizeof(struct R_tile_job));
+
+    for (i = 0; i < tl->njobs; i++) {
+        struct R_tile_job *tj = &tl->jobs[i];
+        int bound = G_compress_bound(tile_size, fcb->cellhd.compressed);
+
+        tj->fd = fd;
+        tj->job.state = JOB_FREE;
+        tj->tile = G_malloc(tile_size);
+        tj->cmp_size = (bound > tile_size ? bound : tile_size) + 1;
+        tj->cmp = G_malloc(tj->cmp_size);
     }
+}
 
-    G_free(compressed_buf);
+/* converts a row of a tiled map into file format, the tiles are written
+   once all rows of a tile row are there */
+static void put_tiled_data(int fd, const void *rast, int zeros_r_nulls)
+{
+    struct fileinfo *fcb = &R__.fileinfo[fd];
+    struct R_tiles *tl = fcb->tiles;
+    int row = fcb->cur_row;
+    int cols = fcb->cellhd.cols;
+    unsigned char *wk;
+
+    if (row >= fcb->cellhd.rows)
+        return;
+
+    if (!tl->band)
+        alloc_tile_buffers(fd);
+
+    wk = tl->band + (size_t)(row % tl->rows) * cols * fcb->nbytes;
+    G_zero(tl->null_buf, cols);
+
+    if (fcb->map_type == CELL_TYPE)
+        convert_int(wk, tl->null_buf, rast, cols, fcb->nbytes, zeros_r_nulls);
+    else if (fcb->map_type == FCELL_TYPE)
+        convert_float((float *)wk, tl->null_buf, rast, cols);
+    else
+        convert_double((double *)wk, tl->null_buf, rast, cols);
+
+    Rast__convert_01_flags(tl->null_buf, fcb->null_bits, cols);
+    Rast__write_null_bits(fd, fcb->null_bits);
+
+    if ((row + 1) % tl->rows == 0 || row + 1 == fcb->cellhd.rows)
+        write_tile_band(fd, row / tl->rows);
 }
 
 /*!
-   \brief Write null data
+   \brief Set up the writer of a new map (internal use only)
 
-   \param flags ?
-   \param row row number
-   \param col col number
-   \param fd file descriptor of cell data file
+   With R__.write_threads background threads, rows are converted and
+   compressed by these threads while the module goes on computing, and
+   written to the files in row order. Otherwise every row is encoded
+   and written at once.
 
-   \return void
+   \param fd file descriptor of a native map opened for writing
+
+   \return pointer to writer
  */
-void Rast__write_null_bits(int fd, const unsigned char *flags)
+struct R_writer *Rast__alloc_writer(int fd)
 {
     struct fileinfo *fcb = &R__.fileinfo[fd];
-    int row = fcb->null_cur_row++;
-    off_t offset;
-    size_t size;
-    int res;
+    int cols = fcb->cellhd.cols;
+    size_t row_size = (size_t)cols * Rast_cell_size(fcb->map_type);
+    size_t null_size = Rast__null_bitstream_size(cols);
+    struct R_writer *wr = G_malloc(sizeof(struct R_writer));
+    int threads = Rast__start_threads(R__.write_threads);
+    int i;
 
-    size = Rast__null_bitstream_size(fcb->cellhd.cols);
+    /* a few rows per thread keep them busy while rows are written */
+    wr->nslots = threads > 0 ? 2 * threads : 1;
+    wr->next_row = 0;
+    wr->slots = G_calloc(wr->nslots, sizeof(struct R_write_slot));
+
+    for (i = 0; i < wr->nslots; i++) {
+        struct R_write_slot *slot = &wr->slots[i];
+
+        slot->fd = fd;
+        slot->row = -1;
+        slot->job.state = JOB_FREE;
+        if (wr->nslots > 1)
+            slot->rast = G_malloc(row_size);
+        slot->null_buf = G_malloc(cols);
+        slot->work = G_malloc(row_size + 1);
+        if (fcb->open_mode == OPEN_NEW_COMPRESSED) {
+            size_t bound =
+                G_compress_bound(row_size, fcb->cellhd.compressed);
+
+            slot->cmp_size = (bound > row_size ? bound : row_size) + 1;
+            slot->cmp = G_malloc(slot->cmp_size);
+        }
+        slot->null_bits = Rast__allocate_null_bits(cols);
+        if (fcb->null_row_ptr) {
+            slot->null_cmp_size = G_compress_bound(null_size, 3);
+            slot->null_cmp = G_malloc(slot->null_cmp_size);
+        }
+    }
 
-    if (fcb->null_row_ptr) {
-        write_null_bits_compressed(flags, row, size, fd);
+    return wr;
+}
+
+/*!
+   \brief Write all rows waiting in the writer of a map (internal use only)
+
+   \param fd file descriptor of a map opened for writing
+ */
+void Rast__flush_writer(int fd)
+{
+    struct fileinfo *fcb = &R__.fileinfo[fd];
+
+    if (!fcb->wr)
         return;
-    }
 
-    offset = (off_t)size * row;
+    while (fcb->wr->next_row < fcb->cur_row)
+        write_next_row(fd);
+}
 
-    if (lseek(fcb->null_fd, offset, SEEK_SET) == -1)
-        G_fatal_error(_("Error writing null row %d of <%s>"), row, fcb->name);
+/*!
+   \brief Release the writer of a map (internal use only)
 
-    if ((res = write(fcb->null_fd, flags, size)) < 0 ||
-        (unsigned int)res != size)
-        G_fatal_error(_("Error writing null row %d of <%s>: %s"), row,
-                      fcb->name, strerror(errno));
+   Rows not yet written are dropped.
+
+   \param wr writer or NULL
+ */
+void Rast__free_writer(struct R_writer *wr)
+{
+    int i;
+
+    if (!wr)
+        return;
+
+    for (i = 0; i < wr->nslots; i++) {
+        struct R_write_slot *slot = &wr->slots[i];
+
+        Rast__wait_job(&slot->job);
+        G_free(slot->rast);
+        G_free(slot->null_buf);
+        G_free(slot->work);
+        G_free(slot->cmp);
+        G_free(slot->null_bits);
+        G_free(slot->null_cmp);
+    }
+
+    G_free(wr->slots);
+    G_free(wr);
 }
 
 static void convert_and_write_if(int fd, const void *vbuf)
@@ -701,7 +952,6 @@ static void put_raster_row(int fd, const void *buf, RASTER_MAP_TYPE data_type,
         {convert_and_write_fi, NULL, convert_and_write_fd},
         {convert_and_write_di, convert_and_write_df, NULL}};
     struct fileinfo *fcb = &R__.fileinfo[fd];
-    char *null_buf;
 
     switch (fcb->open_mode) {
     case OPEN_OLD:
@@ -723,11 +973,16 @@ static void put_raster_row(int fd, const void *buf, RASTER_MAP_TYPE data_type,
         return;
     }
 
-    null_buf = G_malloc(fcb->cellhd.cols);
-    G_zero(null_buf, fcb->cellhd.cols);
+    if (fcb->gdal)
+        put_data_gdal(fd, buf, fcb->cur_row, fcb->cellhd.cols, zeros_r_nulls,
+                      data_type);
+    else if (fcb->tiles)
+        put_tiled_data(fd, buf, zeros_r_nulls);
+    else
+        put_data(fd, buf, zeros_r_nulls);
 
-    put_raster_data(fd, null_buf, buf, fcb->cur_row, fcb->cellhd.cols,
-                    zeros_r_nulls, data_type);
+    if (fcb->block_stats)
+        Rast__update_block_stats(fd, buf, zeros_r_nulls);
 
     /* only for integer maps */
     if (data_type == CELL_TYPE) {
@@ -741,10 +996,4 @@ static void put_raster_row(int fd, const void *buf, RASTER_MAP_TYPE data_type,
                                  data_type);
 
     fcb->cur_row++;
-
-    /* write the null row for the data row */
-    if (!fcb->gdal)
-        put_null_value_row(fd, null_buf);
-
-    G_free(null_buf);
 }
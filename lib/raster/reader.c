@@ -0,0 +1,180 @@
+/*!
+   \file lib/raster/reader.c
+
+   \brief Raster library - Reentrant row readers
+
+   A reader is a read cursor over a raster map opened with
+   Rast_open_old(). It owns the decompression buffers and the row
+   cache which Rast_get_row() otherwise keeps per file descriptor, so
+   that several threads can read rows of the same opened map at once
+   without opening it once per thread.
+
+   All maps have to be opened, and the region has to be set, before
+   the readers are used from parallel code.
+
+   With Rast_want_mmap() the data file of a map is mapped into memory
+   once and all cursors decompress rows directly from the mapping.
+
+   (C) 2026 by the GRASS Development Team
+
+   This program is free software under the GNU General Public License
+   (>=v2).  Read the file COPYING that comes with GRASS for details.
+ */
+
+#include <string.h>
+#include <errno.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#ifndef _WIN32
+#include <sys/mman.h>
+#endif
+
+#include <grass/config.h>
+#include <grass/raster.h>
+#include <grass/glocale.h>
+
+#include "R.h"
+
+/*!
+   \brief Allocate read buffers of a cursor (internal use only)
+
+   \param fd file descriptor of a map opened for reading
+
+   \return pointer to new cursor
+ */
+struct Rast_reader *Rast__alloc_reader(int fd)
+{
+    struct fileinfo *fcb = &R__.fileinfo[fd];
+    struct Rast_reader *rd = G_calloc(1, sizeof(struct Rast_reader));
+
+    rd->fd = fd;
+    rd->cur_row = -1;
+    rd->null_cur_row = -1;
+    rd->data = G_calloc(fcb->cellhd.cols, fcb->nbytes);
+    rd->null_bits = Rast__allocate_null_bits(fcb->cellhd.cols);
+
+    return rd;
+}
+
+/*!
+   \brief Free read buffers of a cursor (internal use only)
+
+   \param rd cursor
+ */
+void Rast__free_reader(struct Rast_reader *rd)
+{
+    if (!rd)
+        return;
+
+    Rast__free_prefetch(rd->prefetch);
+    G_free(rd->data);
+    G_free(rd->null_bits);
+    G_free(rd->cmp);
+    G_free(rd->tile_buf);
+    G_free(rd->tile_tmp);
+    G_free(rd->tile_loaded);
+    G_free(rd);
+}
+
+/*!
+   \brief Map the data file of an old map into memory (internal use only)
+
+   On failure rows are read with pread() as usual.
+
+   \param fd file descriptor of a map opened for reading
+ */
+void Rast__map_data_file(int fd)
+{
+#ifndef _WIN32
+    struct fileinfo *fcb = &R__.fileinfo[fd];
+    struct stat st;
+    void *ptr;
+
+    if (fstat(fcb->data_fd, &st) != 0 || st.st_size <= 0 ||
+        (unsigned long long)st.st_size > (size_t)-1)
+        return;
+
+    ptr = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_SHARED, fcb->data_fd,
+               (off_t)0);
+    if (ptr == MAP_FAILED) {
+        G_debug(1, "Unable to map data file of <%s@%s>: %s", fcb->name,
+                fcb->mapset, strerror(errno));
+        return;
+    }
+
+    fcb->map = ptr;
+    fcb->map_size = (size_t)st.st_size;
+#else
+    (void)fd;
+#endif
+}
+
+/*!
+   \brief Unmap the data file of an old map (internal use only)
+
+   \param fd file descriptor of a map opened for reading
+ */
+void Rast__unmap_data_file(int fd)
+{
+    struct fileinfo *fcb = &R__.fileinfo[fd];
+
+#ifndef _WIN32
+    if (fcb->map)
+        munmap(fcb->map, fcb->map_size);
+#endif
+    fcb->map = NULL;
+    fcb->map_size = 0;
+}
+
+/*!
+   \brief Create a reader for an opened raster map
+
+   The reader is meant to be used by one thread at a time, typically
+   one reader per thread and map. Rows are read with
+   Rast_reader_get_row() and friends.
+
+   \param fd file descriptor returned by Rast_open_old()
+
+   \return pointer to reader
+ */
+struct Rast_reader *Rast_open_reader(int fd)
+{
+    struct fileinfo *fcb;
+    struct Rast_reader *rd;
+
+    if (fd < 0 || fd >= R__.fileinfo_count ||
+        R__.fileinfo[fd].open_mode != OPEN_OLD)
+        G_fatal_error(_("Rast_open_reader: file descriptor %d is not open "
+                        "for reading"),
+                      fd);
+
+    fcb = &R__.fileinfo[fd];
+    rd = Rast__alloc_reader(fd);
+
+    if (R__.auto_mask > 0 && fd != R__.mask_fd)
+        rd->mask = Rast__alloc_reader(R__.mask_fd);
+
+    /* the quant lookup table is built lazily on first use,
+       build it now before threads start sharing it */
+#pragma omp critical(Rast_open_reader)
+    if (fcb->map_type != CELL_TYPE && !fcb->quant.fp_lookup.active)
+        Rast__quant_organize_fp_lookup(&fcb->quant);
+
+    return rd;
+}
+
+/*!
+   \brief Release a reader
+
+   The raster map itself stays open.
+
+   \param rd reader created by Rast_open_reader()
+ */
+void Rast_close_reader(struct Rast_reader *rd)
+{
+    if (!rd)
+        return;
+
+    Rast__free_reader(rd->mask);
+    Rast__free_reader(rd);
+}
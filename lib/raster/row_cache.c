@@ -0,0 +1,395 @@
+/*!
+   \file lib/raster/row_cache.c
+
+   \brief Raster library - Cache of decompressed rows
+
+   Rows of compressed native maps are decompressed once per process
+   and kept in a cache shared by all file descriptors, so that a map
+   opened several times at once is not decompressed again for rows
+   still in the cache. Data rows and null rows are cached per row of
+   the cell file, before the region is applied, so cached rows serve
+   any region.
+
+   Only rows of files open on more than one file descriptor are cached,
+   so that maps read once do not pay for copying rows into the cache;
+   this is checked without taking the lock of the cache. Rows are
+   copied in and out of the cache outside the lock, a row being copied
+   out is not dropped until the copy is done.
+   Files are identified by device, inode, size and modification time
+   while they are open; when the last file descriptor of a file is
+   closed its rows are dropped, so that a map replaced later, even by
+   a file of the same size and time or reusing the inode, never gets
+   rows of the old one. The least recently used rows are dropped when
+   the cache exceeds its memory budget, see Rast_set_row_cache_size().
+
+   (C) 2026 by the GRASS Development Team
+
+   This program is free software under the GNU General Public License
+   (>=v2).  Read the file COPYING that comes with GRASS for details.
+ */
+
+#include <string.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#include <grass/config.h>
+#include <grass/raster.h>
+#include <grass/glocale.h>
+
+#include "R.h"
+
+#define HASH_SIZE 4096 /* power of 2 */
+
+struct file_id {
+    dev_t dev;
+    ino_t ino;
+    off_t size;
+    time_t mtime;
+    long mtime_nsec;
+    int opens; /* File descriptors open on the file, 0 if unused,
+                  read without the lock */
+};
+
+struct cached_row {
+    int id;                   /* File of the row              */
+    int row;                  /* Cell file row                */
+    int nbytes;               /* Bytes per cell of data rows  */
+    int refs;                 /* Copies of the row under way  */
+    size_t size;              /* Size of data                 */
+    unsigned char *data;      /* Decompressed row             */
+    struct cached_row *hnext; /* Next row in hash chain       */
+    struct cached_row *prev;  /* More recently used row       */
+    struct cached_row *next;  /* Less recently used row       */
+};
+
+static struct file_id *files;
+static int num_files, max_files;
+static struct cached_row *hash[HASH_SIZE];
+static struct cached_row *head, *tail; /* most and least recently used */
+static size_t cache_used;
+
+static unsigned int hash_key(int id, int row)
+{
+    return ((unsigned int)id * 2654435761u + (unsigned int)row) &
+           (HASH_SIZE - 1);
+}
+
+static void unlink_row(struct cached_row *cr)
+{
+    if (cr->prev)
+        cr->prev->next = cr->next;
+    else
+        head = cr->next;
+    if (cr->next)
+        cr->next->prev = cr->prev;
+    else
+        tail = cr->prev;
+}
+
+static void push_row(struct cached_row *cr)
+{
+    cr->prev = NULL;
+    cr->next = head;
+    if (head)
+        head->prev = cr;
+    else
+        tail = cr;
+    head = cr;
+}
+
+static struct cached_row *find_row(int id, int row)
+{
+    struct cached_row *cr;
+
+    for (cr = hash[hash_key(id, row)]; cr; cr = cr->hnext)
+        if (cr->id == id && cr->row == row)
+            return cr;
+
+    return NULL;
+}
+
+static void remove_row(struct cached_row *cr)
+{
+    struct cached_row **p = &hash[hash_key(cr->id, cr->row)];
+
+    while (*p != cr)
+        p = &(*p)->hnext;
+    *p = cr->hnext;
+
+    unlink_row(cr);
+    cache_used -= cr->size + sizeof(struct cached_row);
+}
+
+/* drop least recently used rows not being copied until size more
+   bytes fit in the budget, returns the dropped rows chained by next,
+   to be freed outside the lock */
+static struct cached_row *make_room(size_t size)
+{
+    struct cached_row *cr, *prev, *dropped = NULL;
+
+    for (cr = tail; cr && cache_used + size > R__.row_cache_size; cr = prev) {
+        int refs;
+
+        prev = cr->prev;
+#pragma omp atomic read
+        refs = cr->refs;
+        if (refs)
+            continue;
+        remove_row(cr);
+        cr->next = dropped;
+        dropped = cr;
+    }
+
+    return dropped;
+}
+
+static void free_rows(struct cached_row *cr)
+{
+    while (cr) {
+        struct cached_row *next = cr->next;
+
+        G_free(cr->data);
+        G_free(cr);
+        cr = next;
+    }
+}
+
+/* whether rows of a file are cached, files only grows when a file is
+   opened, which like the file table of the library must not happen
+   while rows are read */
+static int is_shared(int id)
+{
+    int opens;
+
+    if (!id)
+        return 0;
+
+#pragma omp atomic read
+    opens = files[id - 1].opens;
+
+    return opens > 1;
+}
+
+/*!
+   \brief Identify a file in the row cache (internal use only)
+
+   \param fd operating system file descriptor of a data or null file
+
+   \return id of the file, to be passed to Rast__get_cached_row() and
+   Rast__cache_row(), and released with Rast__release_row_cache_id()
+   \return 0 if the cache is disabled or the file cannot be identified
+ */
+int Rast__row_cache_id(int fd)
+{
+    struct stat st;
+    int i, id = 0;
+
+    if (R__.row_cache_size == 0 || fd < 0 || fstat(fd, &st) != 0)
+        return 0;
+
+#pragma omp critical(Rast_row_cache)
+    {
+        int unused = -1;
+
+        for (i = 0; i < num_files; i++) {
+            const struct file_id *f = &files[i];
+
+            if (f->opens == 0) {
+                if (unused < 0)
+                    unused = i;
+                continue;
+            }
+            if (f->dev == st.st_dev && f->ino == st.st_ino &&
+                f->size == st.st_size && f->mtime == st.st_mtime &&
+                f->mtime_nsec == STAT_MTIME_NSEC(&st))
+                break;
+        }
+
+        if (i == num_files) {
+            if (unused >= 0)
+                i = unused;
+            else {
+                if (num_files >= max_files) {
+                    max_files += 16;
+                    files =
+                        G_realloc(files, max_files * sizeof(struct file_id));
+                }
+                num_files++;
+            }
+            files[i].dev = st.st_dev;
+            files[i].ino = st.st_ino;
+            files[i].size = st.st_size;
+            files[i].mtime = st.st_mtime;
+            files[i].mtime_nsec = STAT_MTIME_NSEC(&st);
+            files[i].opens = 0;
+        }
+
+#pragma omp atomic update
+        files[i].opens++;
+
+        id = i + 1;
+    }
+
+    return id;
+}
+
+/*!
+   \brief Release a file of the row cache (internal use only)
+
+   To be called when a file descriptor identified with
+   Rast__row_cache_id() is closed. Rows of the file are dropped with
+   its last file descriptor.
+
+   \param id file id from Rast__row_cache_id(), may be 0
+ */
+void Rast__release_row_cache_id(int id)
+{
+    if (!id)
+        return;
+
+#pragma omp critical(Rast_row_cache)
+    {
+        int opens;
+
+#pragma omp atomic capture
+        opens = --files[id - 1].opens;
+
+        if (opens == 0) {
+            struct cached_row *cr, *next;
+
+            /* no file descriptor is left to copy rows of the file */
+            for (cr = head; cr; cr = next) {
+                next = cr->next;
+                if (cr->id == id) {
+                    remove_row(cr);
+                    G_free(cr->data);
+                    G_free(cr);
+                }
+            }
+
+            while (num_files > 0 && files[num_files - 1].opens == 0)
+                num_files--;
+        }
+    }
+}
+
+/*!
+   \brief Get a row from the row cache (internal use only)
+
+   \param id file id from Rast__row_cache_id()
+   \param row cell file row
+   \param[out] buf buffer for the row
+   \param size size of buf
+   \param[out] nbytes bytes per cell of the row, may be NULL
+
+   \return 1 if the row was in the cache
+   \return 0 if not
+ */
+int Rast__get_cached_row(int id, int row, void *buf, size_t size, int *nbytes)
+{
+    struct cached_row *cr;
+
+    if (!is_shared(id))
+        return 0;
+
+#pragma omp critical(Rast_row_cache)
+    {
+        cr = find_row(id, row);
+
+        if (cr && cr->size <= size) {
+#pragma omp atomic update
+            cr->refs++;
+            unlink_row(cr);
+            push_row(cr);
+        }
+        else
+            cr = NULL;
+    }
+
+    if (!cr)
+        return 0;
+
+    memcpy(buf, cr->data, cr->size);
+    if (nbytes)
+        *nbytes = cr->nbytes;
+
+#pragma omp atomic update
+    cr->refs--;
+
+    return 1;
+}
+
+/*!
+   \brief Add a decompressed row to the row cache (internal use only)
+
+   \param id file id from Rast__row_cache_id()
+   \param row cell file row
+   \param buf decompressed row
+   \param size size of the row in bytes
+   \param nbytes bytes per cell of the row
+ */
+void Rast__cache_row(int id, int row, const void *buf, size_t size, int nbytes)
+{
+    struct cached_row *cr, *dropped;
+
+    /* rows of a file opened once are read once in most cases */
+    if (!is_shared(id) || size + sizeof(struct cached_row) > R__.row_cache_size)
+        return;
+
+    cr = G_malloc(sizeof(struct cached_row));
+    cr->data = G_malloc(size);
+    cr->id = id;
+    cr->row = row;
+    cr->nbytes = nbytes;
+    cr->refs = 0;
+    cr->size = size;
+    memcpy(cr->data, buf, size);
+
+#pragma omp critical(Rast_row_cache)
+    {
+        /* cached meanwhile through another file descriptor */
+        if (find_row(id, row)) {
+            cr->next = NULL;
+            dropped = cr;
+        }
+        else {
+            unsigned int h = hash_key(id, row);
+
+            dropped = make_room(size + sizeof(struct cached_row));
+            cr->hnext = hash[h];
+            hash[h] = cr;
+            push_row(cr);
+            cache_used += size + sizeof(struct cached_row);
+        }
+    }
+
+    free_rows(dropped);
+}
+
+/*!
+   \brief Set the memory budget of the cache of decompressed rows
+
+   Rows of compressed native maps are kept decompressed in a cache
+   shared by all opened maps, up to <i>size</i> megabytes. Maps read
+   through several file descriptors at once, or opened again, are then
+   decompressed only once. The default is taken from the
+   GRASS_RASTER_ROW_CACHE environment variable, 64 if unset.
+
+   Rows already cached are dropped as needed to fit the new budget.
+
+   \param size budget in megabytes, 0 to disable the cache
+ */
+void Rast_set_row_cache_size(int size)
+{
+    struct cached_row *dropped;
+
+    Rast__init();
+
+#pragma omp critical(Rast_row_cache)
+    {
+        R__.row_cache_size = size > 0 ? (size_t)size << 20 : 0;
+        dropped = make_room(0);
+    }
+
+    free_rows(dropped);
+}
@@ -0,0 +1,122 @@
+"""Test of reading blocks of cells against reading rows
+
+@copyright 2026 by the GRASS Development Team
+
+@license This program is free software under the GNU General Public License (>=v2).
+Read the file COPYING that comes with GRASS
+for details
+"""
+
+import ctypes
+import math
+import os
+
+from grass.gunittest.case import TestCase
+from grass.gunittest.main import test
+from grass.lib.raster import (
+    CELL_TYPE,
+    DCELL_TYPE,
+    Rast_close,
+    Rast_get_block,
+    Rast_get_row,
+    Rast_open_old,
+    Rast_window_cols,
+    Rast_window_rows,
+)
+from grass.pygrass.gis import Mapset
+
+CELL_NULL = -(2**31)
+
+
+class RastGetBlockTestCase(TestCase):
+    maps = {
+        "get_block_dcell": "if(rand(0, 7) == 0, null(), rand(-100.0, 100.0))",
+        "get_block_cell": "if(row() % 6 == 0, null(), rand(-5000, 5000))",
+    }
+    # blocks inside the region, across its edges and beyond it
+    blocks = [
+        (0, 0, 1, 1),
+        (5, 3, 10, 7),
+        (0, 0, 37, 23),
+        (-4, -3, 9, 8),
+        (30, 18, 12, 9),
+        (-2, 10, 41, 5),
+        (12, -6, 3, 35),
+        (40, 25, 2, 2),
+    ]
+
+    @classmethod
+    def setUpClass(cls):
+        cls.use_temp_region()
+        cls.runModule("g.region", n=37, s=0, e=23, w=0, res=1)
+        for name, expression in cls.maps.items():
+            cls.runModule("r.mapcalc", expression=f"{name} = {expression}", seed=1)
+            # decompressed per tile
+            cls.runModule(
+                "r.mapcalc",
+                expression=f"{name}_tiled = {name}",
+                env_=dict(os.environ, GRASS_RASTER_TILE_SIZE="8"),
+            )
+        cls.mapset = Mapset().name
+
+    @classmethod
+    def tearDownClass(cls):
+        cls.del_temp_region()
+        cls.runModule(
+            "g.remove",
+            flags="f",
+            type="raster",
+            name=[name + suffix for name in cls.maps for suffix in ("", "_tiled")],
+        )
+
+    def read_rows(self, fd, ctype, map_type):
+        rows = Rast_window_rows()
+        cols = Rast_window_cols()
+        buf = (ctype * cols)()
+        cells = []
+        for row in range(rows):
+            Rast_get_row(fd, buf, row, map_type)
+            cells.append(list(buf))
+        return cells
+
+    def assertBlocksMatchRows(self, name, ctype, map_type, is_null):
+        fd = Rast_open_old(name, self.mapset)
+        try:
+            cells = self.read_rows(fd, ctype, map_type)
+            for row, col, nrows, ncols in self.blocks:
+                buf = (ctype * (nrows * ncols))()
+                Rast_get_block(fd, buf, row, col, nrows, ncols, map_type)
+                for i in range(nrows):
+                    for j in range(ncols):
+                        r, c = row + i, col + j
+                        value = buf[i * ncols + j]
+                        msg = f"<{name}> block {row},{col} cell {r},{c}"
+                        if 0 <= r < len(cells) and 0 <= c < len(cells[0]):
+                            expected = cells[r][c]
+                            if is_null(expected):
+                                self.assertTrue(is_null(value), msg=msg)
+                            else:
+                                self.assertEqual(value, expected, msg=msg)
+                        else:
+                            self.assertTrue(is_null(value), msg=msg)
+        finally:
+            Rast_close(fd)
+
+    def test_dcell(self):
+        for suffix in ("", "_tiled"):
+            self.assertBlocksMatchRows(
+                "get_block_dcell" + suffix, ctypes.c_double, DCELL_TYPE, math.isnan
+            )
+
+    def test_cell(self):
+        for suffix in ("", "_tiled"):
+            self.assertBlocksMatchRows(
+                "get_block_cell" + suffix,
+                ctypes.c_int,
+                CELL_TYPE,
+                lambda value: value == CELL_NULL,
+            )
+
+
+if __name__ == "__main__":
+    test()
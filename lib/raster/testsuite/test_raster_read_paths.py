@@ -0,0 +1,209 @@
+"""Test that the optional read and write paths of the raster library
+give the same maps as the default ones
+
+@copyright 2026 by the GRASS Development Team
+
+@license This program is free software under the GNU General Public License (>=v2).
+Read the file COPYING that comes with GRASS
+for details
+"""
+
+import os
+
+import grass.script as gs
+from grass.gunittest.case import TestCase
+from grass.gunittest.main import test
+
+
+class TestReadPaths(TestCase):
+    """Copy maps with r.mapcalc and compare them with the originals"""
+
+    maps = {
+        "rp_cell": "if(rand(0, 8) == 0, null(), rand(-1000, 1000))",
+        "rp_fcell": "if(rand(0, 8) == 0, null(), float(rand(-1.0, 1.0)))",
+        "rp_dcell": "if(row() % 7 == 0, null(), rand(-1e6, 1e6))",
+        # one and four bytes per cell, rows of nulls
+        "rp_cell1": "if(row() % 9 == 0, null(), rand(0, 200))",
+        "rp_cell4": "if(row() % 5 == 2, null(), rand(-2000000000, 2000000000))",
+    }
+    to_remove = []
+
+    @classmethod
+    def setUpClass(cls):
+        cls.use_temp_region()
+        cls.runModule("g.region", n=60, s=0, e=45, w=0, res=1)
+        for name, expression in cls.maps.items():
+            cls.runModule("r.mapcalc", expression=f"{name} = {expression}", seed=1)
+            cls.runModule("r.mapcalc", expression=f"{name}_u = {name}")
+            cls.runModule("r.compress", map=f"{name}_u", flags="u")
+            cls.to_remove.extend([name, f"{name}_u"])
+
+    @classmethod
+    def tearDownClass(cls):
+        cls.del_temp_region()
+        cls.runModule("g.remove", flags="f", type="raster", name=cls.to_remove)
+
+    def copy(self, name, output, **env):
+        """Copy a map in the current region with variables set"""
+        self.assertModule(
+            "r.mapcalc",
+            expression=f"{output} = {name}",
+            env_=dict(os.environ, **env),
+        )
+        self.to_remove.append(output)
+
+    def assertReadSame(self, name, tag, **env):
+        """Test that a map reads the same with variables set as without"""
+        self.copy(name, f"{name}_{tag}_ref")
+        self.copy(name, f"{name}_{tag}", **env)
+        self.assertRastersEqual(f"{name}_{tag}", reference=f"{name}_{tag}_ref")
+
+    def test_mmap(self):
+        """Test memory-mapped reads of compressed and uncompressed maps"""
+        for name in self.maps:
+            self.assertReadSame(name, "mmap", GRASS_RASTER_MMAP="1")
+            self.assertReadSame(f"{name}_u", "mmap", GRASS_RASTER_MMAP="1")
+
+    def test_prefetch(self):
+        """Test read-ahead in the map region and in one not aligned with it"""
+        for name in self.maps:
+            self.assertReadSame(name, "pf", GRASS_RASTER_PREFETCH="4")
+        # shifted by a fraction of a cell, rows of the map are skipped
+        # and repeated
+        self.runModule("g.region", n=57.3, s=2.1, e=40.7, w=3.2, nsres=0.7, ewres=1.3)
+        try:
+            for name in self.maps:
+                self.assertReadSame(name, "pfr", GRASS_RASTER_PREFETCH="4")
+                self.assertReadSame(f"{name}_u", "pfr", GRASS_RASTER_PREFETCH="2")
+        finally:
+            self.runModule("g.region", n=60, s=0, e=45, w=0, res=1)
+
+    def test_misaligned_regions(self):
+        """Test rows of regions aligned with the map against others"""
+        # three region columns per map column, cells read one by one
+        self.runModule("g.region", n=60, s=0, e=45, w=0, rows=180, cols=135)
+        try:
+            for name in self.maps:
+                self.copy(name, f"{name}_fine")
+        finally:
+            self.runModule("g.region", n=60, s=0, e=45, w=0, res=1)
+        # the middle one of three cells is read back
+        for name in self.maps:
+            self.assertRastersEqual(f"{name}_fine", reference=name)
+
+        # aligned with the map, starting inside it
+        self.runModule("g.region", n=50, s=5, e=40, w=7, res=1)
+        try:
+            for name in self.maps:
+                self.copy(name, f"{name}_sub")
+                self.copy(f"{name}_u", f"{name}_u_sub")
+                self.assertRastersEqual(f"{name}_sub", reference=f"{name}_fine")
+                self.assertRastersEqual(f"{name}_u_sub", reference=f"{name}_fine")
+        finally:
+            self.runModule("g.region", n=60, s=0, e=45, w=0, res=1)
+
+
+class TestWritePaths(TestCase):
+    """Write maps with r.mapcalc and compare the files written"""
+
+    expressions = {
+        "CELL": "if(rand(0, 8) == 0, null(), rand(-100000, 100000))",
+        "FCELL": "if(row() % 5 == 0, null(), float(rand(-1.0, 1.0)))",
+        "DCELL": "if(rand(0, 8) == 0, null(), rand(-1e6, 1e6))",
+    }
+    to_remove = []
+
+    @classmethod
+    def setUpClass(cls):
+        cls.use_temp_region()
+        cls.runModule("g.region", n=60, s=0, e=45, w=0, res=1)
+        env = gs.gisenv()
+        cls.mapset_path = os.path.join(
+            env["GISDBASE"], env["LOCATION_NAME"], env["MAPSET"]
+        )
+
+    @classmethod
+    def tearDownClass(cls):
+        cls.del_temp_region()
+        cls.runModule("g.remove", flags="f", type="raster", name=cls.to_remove)
+
+    def write(self, output, expression, **env):
+        """Write a map with variables set"""
+        self.assertModule(
+            "r.mapcalc",
+            expression=f"{output} = {expression}",
+            seed=1,
+            env_=dict(os.environ, **env),
+        )
+        self.to_remove.append(output)
+
+    def map_files(self, name):
+        """Data and null files of a map, by element"""
+        files = {}
+        for element in ("cell", "fcell"):
+            path = os.path.join(self.mapset_path, element, name)
+            if os.path.exists(path):
+                files[element] = path
+        misc = os.path.join(self.mapset_path, "cell_misc", name)
+        for element in sorted(os.listdir(misc)):
+            files[element] = os.path.join(misc, element)
+        return files
+
+    def assertWrittenSame(self, tag, **env):
+        """Test that maps are written byte for byte the same with
+        variables set as without"""
+        for map_type, expression in self.expressions.items():
+            reference = f"wp_{map_type}_{tag}_ref"
+            actual = f"wp_{map_type}_{tag}"
+            self.write(reference, expression)
+            self.write(actual, expression, **env)
+            reference_files = self.map_files(reference)
+            actual_files = self.map_files(actual)
+            self.assertEqual(sorted(actual_files), sorted(reference_files))
+            for element, path in actual_files.items():
+                self.assertFilesEqualMd5(path, reference_files[element])
+
+    def test_write_threads(self):
+        """Test rows compressed in the background"""
+        self.assertWrittenSame("wt", GRASS_RASTER_WRITE_THREADS="3")
+
+    def test_tiles(self):
+        """Test maps stored in tiles, read in regions crossing tiles"""
+        regions = [
+            {"n": 60, "s": 0, "e": 45, "w": 0, "res": 1},
+            # inside one tile, then across tile edges and the map edge
+            {"n": 30, "s": 20, "e": 30, "w": 20, "res": 1},
+            {"n": 50, "s": 10, "e": 50, "w": 14, "res": 1},
+            {"n": 63.5, "s": -2.5, "e": 44.1, "w": 0.4, "nsres": 0.9, "ewres": 2.3},
+        ]
+        try:
+            for map_type, expression in self.expressions.items():
+                reference = f"wp_{map_type}_tiles_ref"
+                self.write(reference, expression)
+                for threads in ("0", "3"):
+                    actual = f"wp_{map_type}_tiles_{threads}"
+                    self.write(
+                        actual,
+                        expression,
+                        GRASS_RASTER_TILE_SIZE="16",
+                        GRASS_RASTER_WRITE_THREADS=threads,
+                    )
+                    self.assertIn("tiles", self.map_files(actual))
+                    for region in regions:
+                        self.runModule("g.region", **region)
+                        self.assertRastersEqual(actual, reference=reference)
+                    self.runModule("g.region", **regions[0])
+        finally:
+            self.runModule("g.region", **regions[0])
+
+    def test_tiles_refused_as_rows(self):
+        """Test that a tiled map read as a row-based one fails to open,
+        as in versions without tiles"""
+        output = "wp_CELL_tiles_rows"
+        self.write(output, self.expressions["CELL"], GRASS_RASTER_TILE_SIZE="16")
+        os.remove(self.map_files(output)["tiles"])
+        self.assertModuleFail("r.univar", map=output)
+
+
+if __name__ == "__main__":
+    test()
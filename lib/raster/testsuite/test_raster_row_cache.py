@@ -0,0 +1,78 @@
+"""Test of the cache of decompressed rows shared by file descriptors
+
+@copyright 2026 by the GRASS Development Team
+
+@license This program is free software under the GNU General Public License (>=v2).
+Read the file COPYING that comes with GRASS
+for details
+"""
+
+from grass.gunittest.case import TestCase
+from grass.gunittest.main import test
+from grass.lib.raster import Rast_set_row_cache_size
+from grass.pygrass.raster import RasterRow
+from grass.pygrass.raster.buffer import Buffer
+
+
+class RowCacheTestCase(TestCase):
+    name = "RowCacheTestCase_map"
+    rows = 30
+    cols = 20
+
+    @classmethod
+    def setUpClass(cls):
+        cls.use_temp_region()
+        cls.runModule("g.region", n=cls.rows, s=0, e=cls.cols, w=0, res=1)
+
+    @classmethod
+    def tearDownClass(cls):
+        Rast_set_row_cache_size(64)
+        cls.runModule("g.remove", flags="f", type="raster", name=cls.name)
+        cls.del_temp_region()
+
+    def values(self, version, row):
+        """Cells of a row, constant so that every version of the map
+        compresses to the same size"""
+        return [version * 10 + row % 7] * self.cols
+
+    def write(self, version):
+        with RasterRow(self.name, mode="w", mtype="CELL", overwrite=True) as r:
+            for row in range(self.rows):
+                buf = Buffer((self.cols,), mtype="CELL")
+                buf[:] = self.values(version, row)
+                r.put_row(buf)
+
+    def assertReadBack(self, version):
+        """Read the map through two file descriptors at once"""
+        first = RasterRow(self.name)
+        second = RasterRow(self.name)
+        first.open("r")
+        second.open("r")
+        try:
+            # each row twice, from the file and from the cache
+            for reader in (first, second):
+                for row in range(self.rows):
+                    self.assertEqual(
+                        list(reader[row]),
+                        self.values(version, row),
+                        msg=f"row {row} of version {version}",
+                    )
+            for row in reversed(range(self.rows)):
+                self.assertEqual(list(first[row]), list(second[row]))
+        finally:
+            first.close()
+            second.close()
+
+    def test_rewrite(self):
+        """Rewrite the map in this process, within the same second"""
+        for size in (64, 0):
+            Rast_set_row_cache_size(size)
+            for version in range(4):
+                self.write(version)
+                self.assertReadBack(version)
+                # open again without a change
+                self.assertReadBack(version)
+
+
+if __name__ == "__main__":
+    test()
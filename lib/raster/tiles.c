@@ -0,0 +1,215 @@
+/*!
+   \file lib/raster/tiles.c
+
+   \brief Raster library - Tiled cell files
+
+   Compressed native maps may be stored in square tiles instead of rows,
+   so that reading a small region of a large map decompresses only the
+   tiles overlapping the region instead of whole rows. Each tile is
+   compressed on its own. Tiles are numbered row by row from the top
+   left corner of the map, those in the last tile row and column are
+   cut to the size of the map. The data file starts with a zero byte,
+   then the addresses of the tiles follow in the format of the row
+   addresses of row-based files (see format.c). Row-based files start
+   with the size of the row addresses instead, GRASS versions without
+   tiles fail to open a map with a size of zero rather than read the
+   tiles as rows.
+
+   Cells are stored in file format, XDR for floating-point maps and
+   sizeof(CELL) bytes per cell for integer maps. Null values are kept
+   in the usual row-based null file. The tile size is recorded in
+   cell_misc/<name>/tiles; maps without this file are row-based.
+
+   Rows of a tiled map are read with Rast_get_row() as usual. Each
+   cursor keeps one row of tiles decompressed, only the tiles in the
+   current region are decompressed.
+
+   (C) 2026 by the GRASS Development Team
+
+   This program is free software under the GNU General Public License
+   (>=v2).  Read the file COPYING that comes with GRASS for details.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <grass/config.h>
+#include <grass/raster.h>
+#include <grass/glocale.h>
+
+#include "R.h"
+
+#define TILE_FILE "tiles"
+
+/*!
+   \brief Set up the tile layout of a map (internal use only)
+
+   \param cellhd cell header of the map
+   \param rows rows of cells per tile
+   \param cols columns of cells per tile
+
+   \return pointer to tile layout
+ */
+struct R_tiles *Rast__alloc_tiles(const struct Cell_head *cellhd, int rows,
+                                  int cols)
+{
+    struct R_tiles *tl = G_calloc(1, sizeof(struct R_tiles));
+
+    tl->rows = rows;
+    tl->cols = cols;
+    tl->nrows = (cellhd->rows + rows - 1) / rows;
+    tl->ncols = (cellhd->cols + cols - 1) / cols;
+    tl->ptr = G_calloc((size_t)tl->nrows * tl->ncols + 1, sizeof(off_t));
+
+    return tl;
+}
+
+/*!
+   \brief Release the tile layout of a map (internal use only)
+
+   Waits for tiles still being compressed.
+
+   \param tl tile layout or NULL
+ */
+void Rast__free_tiles(struct R_tiles *tl)
+{
+    int i;
+
+    if (!tl)
+        return;
+
+    for (i = 0; i < tl->njobs; i++) {
+        Rast__wait_job(&tl->jobs[i].job);
+        G_free(tl->jobs[i].tile);
+        G_free(tl->jobs[i].cmp);
+    }
+
+    G_free(tl->jobs);
+    G_free(tl->band);
+    G_free(tl->null_buf);
+    G_free(tl->ptr);
+    G_free(tl);
+}
+
+/*!
+   \brief Read the tile layout of an existing map (internal use only)
+
+   \param name map name
+   \param mapset mapset of the map
+   \param cellhd cell header of the map
+
+   \return pointer to tile layout
+   \return NULL if the map is row-based
+ */
+struct R_tiles *Rast__read_tile_info(const char *name, const char *mapset,
+                                     const struct Cell_head *cellhd)
+{
+    struct Key_Value *key_val;
+    const char *rows, *cols;
+    FILE *fp;
+    int r = 0, c = 0;
+
+    fp = G_fopen_old_misc("cell_misc", TILE_FILE, name, mapset);
+    if (!fp)
+        return NULL;
+    key_val = G_fread_key_value(fp);
+    fclose(fp);
+
+    if (key_val) {
+        rows = G_find_key_value("rows", key_val);
+        cols = G_find_key_value("cols", key_val);
+        if (rows && cols) {
+            r = atoi(rows);
+            c = atoi(cols);
+        }
+        G_free_key_value(key_val);
+    }
+
+    if (r <= 0 || c <= 0 || r > MAX_TILE_SIZE || c > MAX_TILE_SIZE ||
+        cellhd->compressed <= 0)
+        G_fatal_error(_("Invalid tile layout for raster map <%s@%s>"), name,
+                      mapset);
+
+    return Rast__alloc_tiles(cellhd, r, c);
+}
+
+/*!
+   \brief Record the tile layout of a new map (internal use only)
+
+   Removes the record of an earlier map of the same name if the new
+   map is row-based.
+
+   \param fd file descriptor of a map opened for writing
+ */
+void Rast__write_tile_info(int fd)
+{
+    struct fileinfo *fcb = &R__.fileinfo[fd];
+    struct Key_Value *key_val;
+    char path[GPATH_MAX];
+    char buf[32];
+
+    G_file_name_misc(path, "cell_misc", TILE_FILE, fcb->name, fcb->mapset);
+
+    if (!fcb->tiles) {
+        remove(path);
+        return;
+    }
+
+    key_val = G_create_key_value();
+    sprintf(buf, "%d", fcb->tiles->rows);
+    G_set_key_value("rows", buf, key_val);
+    sprintf(buf, "%d", fcb->tiles->cols);
+    G_set_key_value("cols", buf, key_val);
+
+    G__make_mapset_element_misc("cell_misc", fcb->name);
+    G_write_key_value_file(path, key_val);
+
+    G_free_key_value(key_val);
+}
+
+/*!
+   \brief Set the tile size of new raster maps
+
+   Compressed maps subsequently opened with Rast_open_new() and friends
+   are stored in square tiles of <i>size</i> by <i>size</i> cells
+   instead of rows. Small regions of large tiled maps are read much
+   faster, at the cost of memory: every reader keeps a full row of
+   tiles decompressed. The default is taken from the
+   GRASS_RASTER_TILE_SIZE environment variable.
+
+   Tiled maps cannot be read by GRASS versions without support for
+   them, these versions fail to open tiled maps.
+
+   \param size tile size in cells, 0 for row-based maps
+ */
+void Rast_set_tile_size(int size)
+{
+    Rast__init();
+
+    if (size > MAX_TILE_SIZE)
+        size = MAX_TILE_SIZE;
+    R__.tile_size = size > 0 ? size : 0;
+}
+
+/*!
+   \brief Get the tile size of an opened raster map
+
+   \param fd file descriptor
+   \param[out] rows rows of cells per tile
+   \param[out] cols columns of cells per tile
+
+   \return 1 if the map is tiled
+   \return 0 if the map is row-based, rows and cols are left unchanged
+ */
+int Rast_get_tile_size(int fd, int *rows, int *cols)
+{
+    struct fileinfo *fcb = &R__.fileinfo[fd];
+
+    if (!fcb->tiles)
+        return 0;
+
+    *rows = fcb->tiles->rows;
+    *cols = fcb->tiles->cols;
+
+    return 1;
+}
@@ -102,6 +102,16 @@ void Rast__create_window_mapping(int fd)
         }
     }
 
+    /* windows matching the cells of the map are copied a row at a time */
+    fcb->col_offset = fcb->col_map[0] - 1;
+    for (i = 0; i < R__.rd_window.cols; i++) {
+        if (!fcb->col_map[i] ||
+            fcb->col_map[i] != fcb->col_map[0] + (COLUMN_MAPPING)i) {
+            fcb->col_offset = -1;
+            break;
+        }
+    }
+
     G_debug(3, "create window mapping (%d columns)", R__.rd_window.cols);
     /*  for (i = 0; i < R__.rd_window.cols; i++)
        fprintf(stderr, "%s%ld", i % 15 ? " " : "\n", (long)fcb->col_map[i]);
@@ -0,0 +1,299 @@
+/**
+ * \file lib/segment/compress.c
+ *
+ * \brief Segment compressed pages.
+ *
+ * With compression, a segment written to the segment file is compressed
+ * and stored past the segments in the usual layout, at an offset kept in
+ * an index. The space taken by a segment is a power of two times
+ * MIN_EXTENT bytes, a segment which outgrows its space moves to a larger
+ * one and its old space is reused by other segments. A segment which
+ * does not get smaller is stored uncompressed. Segments never written
+ * since compression was turned on are read from the usual layout.
+ *
+ * This program is free software under the GNU General Public License
+ * (>=v2). Read the file COPYING that comes with GRASS for details.
+ *
+ * \author GRASS Development Team
+ *
+ * \date 2026
+ */
+
+#include <string.h>
+
+#include <grass/gis.h>
+#include <grass/glocale.h>
+
+#include "local_proto.h"
+
+#define MIN_EXTENT 256
+
+/**
+ * \brief Store segments compressed in the segment file.
+ *
+ * Segments written to the segment file from now on are compressed
+ * with the given method, e.g. <i>G_compressor_number("LZ4")</i> or
+ * <i>G_compressor_number("ZSTD")</i>. This saves disk space and i/o for
+ * data with many zeros, nulls or smooth values, at the cost of the
+ * time taken to compress and expand the segments. The data in the
+ * segment file is still accessed with the usual routines.
+ *
+ * Segment_open() calls this routine with the method named in the
+ * environment variable GRASS_SEGMENT_COMPRESSOR, if it is set.
+ *
+ * \param[in,out] SEG segment
+ * \param[in] method compressor number, see G_compressor_number()
+ * \return 1 if successful
+ * \return -1 if SEGMENT is not available (not open), the method is not
+ * available or another method was set before
+ */
+int Segment_set_compression(SEGMENT *SEG, int method)
+{
+    struct seg_pages *pages;
+    int n_total_segs, i;
+
+    if (SEG->open != 1)
+        return -1;
+
+    if (method < 1 || G_check_compressor(method) != 1) {
+        G_warning(_("Segment compression method %d not available"), method);
+        return -1;
+    }
+
+    /* all in memory */
+    if (SEG->cache)
+        return 1;
+
+    /* segments stored before must still be expanded */
+    if (SEG->pages) {
+        if (SEG->pages->method == method)
+            return 1;
+        G_warning(_("Segment compression method can not be changed"));
+        return -1;
+    }
+
+    n_total_segs = SEG->spr * ((SEG->nrows + SEG->srows - 1) / SEG->srows);
+
+    pages = G_malloc(sizeof(struct seg_pages));
+    pages->method = method;
+    pages->bound = G_compress_bound(SEG->size, method);
+    if (pages->bound < SEG->size)
+        pages->bound = SEG->size;
+    pages->end = SEG->offset + (off_t)n_total_segs * SEG->size;
+    pages->offset = G_malloc(n_total_segs * sizeof(off_t));
+    pages->nbytes = G_malloc(n_total_segs * sizeof(int));
+    pages->class = G_malloc(n_total_segs);
+    for (i = 0; i < n_total_segs; i++)
+        pages->offset[i] = -1;
+
+    for (pages->nclasses = 1; MIN_EXTENT << (pages->nclasses - 1) < SEG->size;
+         pages->nclasses++)
+        ;
+    pages->free = G_calloc(pages->nclasses, sizeof(*pages->free));
+#ifdef HAVE_PTHREAD_H
+    pthread_mutex_init(&pages->mutex, NULL);
+#endif
+
+    SEG->pages = pages;
+    SEG->zbuf = G_malloc(pages->bound);
+
+    /* the stripes share the index, each has its own buffer */
+    for (i = 0; i < SEG->nstripes; i++) {
+        SEGMENT *S = seg_lock(SEG, i);
+
+        S->pages = pages;
+        S->zbuf = G_malloc(pages->bound);
+        seg_unlock(SEG, i);
+    }
+
+    G_debug(1, "Segment_set_compression: %s", G_compressor_name(method));
+
+    return 1;
+}
+
+/**
+ * \brief Internal use only
+ *
+ * Reads a segment stored compressed.
+ *
+ * \param[in] SEG segment
+ * \param[in] n segment number
+ * \param[out] buf segment data, SEG->size bytes
+ * \return 1 if successful
+ * \return 0 if the segment is not stored compressed
+ * \return -1 if unable to read or expand the segment
+ */
+int seg_read_page(SEGMENT *SEG, int n, void *buf)
+{
+    struct seg_pages *pages = SEG->pages;
+    int nbytes = pages->nbytes[n];
+
+    if (pages->offset[n] < 0)
+        return 0;
+
+    if (nbytes == SEG->size) {
+        if (seg_read_at(SEG, buf, nbytes, pages->offset[n]) != nbytes)
+            return -1;
+        return 1;
+    }
+
+    if (seg_read_at(SEG, SEG->zbuf, nbytes, pages->offset[n]) != nbytes)
+        return -1;
+
+    if (G_expand(SEG->zbuf, nbytes, buf, SEG->size, pages->method) !=
+        SEG->size) {
+        G_warning(_("Unable to expand segment %d"), n);
+        return -1;
+    }
+
+    return 1;
+}
+
+/* offset of free space of the given class */
+static off_t take_space(struct seg_pages *pages, int class)
+{
+    off_t offset;
+
+#ifdef HAVE_PTHREAD_H
+    pthread_mutex_lock(&pages->mutex);
+#endif
+    if (pages->free[class].n > 0)
+        offset = pages->free[class].offset[--pages->free[class].n];
+    else {
+        offset = pages->end;
+        pages->end += (off_t)MIN_EXTENT << class;
+    }
+#ifdef HAVE_PTHREAD_H
+    pthread_mutex_unlock(&pages->mutex);
+#endif
+
+    return offset;
+}
+
+static void give_space(struct seg_pages *pages, int class, off_t offset)
+{
+#ifdef HAVE_PTHREAD_H
+    pthread_mutex_lock(&pages->mutex);
+#endif
+    if (pages->free[class].n >= pages->free[class].max) {
+        pages->free[class].max += 64;
+        pages->free[class].offset =
+            G_realloc(pages->free[class].offset,
+                      pages->free[class].max * sizeof(off_t));
+    }
+    pages->free[class].offset[pages->free[class].n++] = offset;
+#ifdef HAVE_PTHREAD_H
+    pthread_mutex_unlock(&pages->mutex);
+#endif
+}
+
+/**
+ * \brief Internal use only
+ *
+ * Writes a segment compressed.
+ *
+ * \param[in] SEG segment
+ * \param[in] n segment number
+ * \param[in] buf segment data, SEG->size bytes
+ * \return 1 if successful
+ * \return -1 if unable to write the segment
+ */
+int seg_write_page(SEGMENT *SEG, int n, void *buf)
+{
+    struct seg_pages *pages = SEG->pages;
+    const void *data = SEG->zbuf;
+    int nbytes, class;
+
+    nbytes = G_compress(buf, SEG->size, SEG->zbuf, pages->bound,
+                        pages->method);
+    if (nbytes <= 0 || nbytes >= SEG->size) {
+        data = buf;
+        nbytes = SEG->size;
+    }
+
+    for (class = 0; MIN_EXTENT << class < nbytes; class++)
+        ;
+
+    if (pages->offset[n] >= 0 && pages->class[n] != class) {
+        give_space(pages, pages->class[n], pages->offset[n]);
+        pages->offset[n] = -1;
+    }
+    if (pages->offset[n] < 0) {
+        pages->offset[n] = take_space(pages, class);
+        pages->class[n] = class;
+    }
+    pages->nbytes[n] = nbytes;
+
+    if (seg_write_at(SEG, data, nbytes, pages->offset[n]) != nbytes)
+        return -1;
+
+    return 1;
+}
+
+/**
+ * \brief Internal use only
+ *
+ * Frees the index of the compressed segments.
+ *
+ * \param[in,out] SEG segment
+ */
+void seg_release_pages(SEGMENT *SEG)
+{
+    struct seg_pages *pages = SEG->pages;
+    int i;
+
+    G_free(SEG->zbuf);
+    SEG->zbuf = NULL;
+
+    if (!pages)
+        return;
+
+    for (i = 0; i < pages->nclasses; i++)
+        G_free(pages->free[i].offset);
+    G_free(pages->free);
+    G_free(pages->offset);
+    G_free(pages->nbytes);
+    G_free(pages->class);
+#ifdef HAVE_PTHREAD_H
+    pthread_mutex_destroy(&pages->mutex);
+#endif
+    G_free(pages);
+    SEG->pages = NULL;
+}
+
+/**
+ * \brief Internal use only
+ *
+ * Copies data from or to a segment through the segments in memory, used
+ * for rows of compressed segments, which can not be accessed in place in
+ * the file.
+ *
+ * \param[in,out] SEG segment
+ * \param[in] n segment number
+ * \param[in] index position in the segment
+ * \param[in,out] buf data
+ * \param[in] size number of bytes
+ * \param[in] put 1 to copy buf to the segment, 0 to copy from it
+ * \return 1 if successful
+ * \return -1 if unable to page the segment in
+ */
+int seg_transfer(SEGMENT *SEG, int n, int index, void *buf, int size, int put)
+{
+    SEGMENT *S = seg_lock(SEG, n);
+    int i;
+
+    if ((i = seg_pagein(S, n)) < 0) {
+        seg_unlock(SEG, n);
+        return -1;
+    }
+
+    if (put) {
+        memcpy(&S->scb[i].buf[index], buf, size);
+        S->scb[i].dirty = 1;
+    }
+    else
+        memcpy(buf, &S->scb[i].buf[index], size);
+    seg_unlock(SEG, n);
+
+    return 1;
+}
@@ -34,6 +34,7 @@ int Segment_flush(SEGMENT *SEG)
         for (i = 0; i < SEG->nseg; i++)
             if (SEG->scb[i].n >= 0 && SEG->scb[i].dirty)
                 seg_pageout(SEG, i);
+        seg_flush_stripes(SEG);
     }
 
     return 0;
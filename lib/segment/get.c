@@ -35,6 +35,7 @@
  */
 int Segment_get(SEGMENT *SEG, void *buf, off_t row, off_t col)
 {
+    SEGMENT *S;
     int index, n, i;
 
     if (SEG->cache) {
@@ -45,10 +46,14 @@ int Segment_get(SEGMENT *SEG, void *buf, off_t row, off_t col)
     }
 
     SEG->address(SEG, row, col, &n, &index);
-    if ((i = seg_pagein(SEG, n)) < 0)
+    S = seg_lock(SEG, n);
+    if ((i = seg_pagein(S, n)) < 0) {
+        seg_unlock(SEG, n);
         return -1;
+    }
 
-    memcpy(buf, &SEG->scb[i].buf[index], SEG->len);
+    memcpy(buf, &S->scb[i].buf[index], SEG->len);
+    seg_unlock(SEG, n);
 
     return 1;
 }
@@ -21,6 +21,25 @@
 
 #include "local_proto.h"
 
+static int get_row_pages(SEGMENT *SEG, void *buf, off_t row)
+{
+    off_t col;
+    int n, index, size;
+
+    for (col = 0; col < SEG->ncols; col += SEG->scols) {
+        size = (col + SEG->scols > SEG->ncols ? SEG->ncols - col : SEG->scols) *
+               SEG->len;
+        SEG->address(SEG, row, col, &n, &index);
+        if (seg_transfer(SEG, n, index, buf, size, 0) < 0) {
+            G_warning("Segment_get_row: unable to read segment %d", n);
+            return -1;
+        }
+        buf = ((char *)buf) + size;
+    }
+
+    return 1;
+}
+
 /**
  * \fn int Segment_get_row (SEGMENT *SEG, void *buf, int row)
  *
@@ -54,20 +73,17 @@ int Segment_get_row(const SEGMENT *SEG, void *buf, off_t row)
         return 1;
     }
 
+    /* compressed segments are read through the segments in memory */
+    if (SEG->pages)
+        return get_row_pages((SEGMENT *)SEG, buf, row);
+
     ncols = SEG->ncols - SEG->spill;
     scols = SEG->scols;
     size = scols * SEG->len;
 
     for (col = 0; col < ncols; col += scols) {
         SEG->address(SEG, row, col, &n, &index);
-        if (SEG->seek(SEG, n, index) == -1) {
-            int err = errno;
-            G_warning(_("File read/write operation failed: %s (%d)"),
-                      strerror(err), err);
-            return -1;
-        }
-
-        if (read(SEG->fd, buf, size) != size) {
+        if (seg_read_at(SEG, buf, size, seg_offset(SEG, n, index)) != size) {
             G_warning("Segment_get_row: %s", strerror(errno));
             return -1;
         }
@@ -81,14 +97,7 @@ int Segment_get_row(const SEGMENT *SEG, void *buf, off_t row)
     }
     if ((size = SEG->spill * SEG->len)) {
         SEG->address(SEG, row, col, &n, &index);
-        if (SEG->seek(SEG, n, index) == -1) {
-            int err = errno;
-            G_warning(_("File read/write operation failed: %s (%d)"),
-                      strerror(err), err);
-            return -1;
-        }
-
-        if (read(SEG->fd, buf, size) != size) {
+        if (seg_read_at(SEG, buf, size, seg_offset(SEG, n, index)) != size) {
             G_warning("Segment_get_row: %s", strerror(errno));
             return -1;
         }
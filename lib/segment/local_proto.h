@@ -3,6 +3,36 @@
 
 #include <grass/segment.h>
 
+#ifdef HAVE_PTHREAD_H
+#include <pthread.h>
+#endif
+
+/* segments loaded for the threads, see threads.c */
+struct seg_stripe {
+    SEGMENT seg; /* own slots and age queue, shared file and index */
+#ifdef HAVE_PTHREAD_H
+    pthread_mutex_t mutex;
+#endif
+};
+
+/* compressed segments in the file, see compress.c */
+struct seg_pages {
+    int method;    /* compressor, see G_compressor_number() */
+    int bound;     /* size of a compressed segment buffer */
+    off_t end;     /* end of the segment file */
+    off_t *offset; /* of each segment, -1 if not stored compressed */
+    int *nbytes;   /* bytes stored, SEG->size if uncompressed */
+    char *class;   /* space taken, MIN_EXTENT << class bytes */
+    int nclasses;
+    struct {
+        off_t *offset;
+        int n, max;
+    } *free; /* free space of each class */
+#ifdef HAVE_PTHREAD_H
+    pthread_mutex_t mutex; /* end and free */
+#endif
+};
+
 /* internal functions */
 
 /* address.c */
@@ -10,6 +40,12 @@ int seg_address(const SEGMENT *, off_t, off_t, int *, int *);
 int seg_address_fast(const SEGMENT *, off_t, off_t, int *, int *);
 int seg_address_slow(const SEGMENT *, off_t, off_t, int *, int *);
 
+/* compress.c */
+int seg_read_page(SEGMENT *, int, void *);
+int seg_write_page(SEGMENT *, int, void *);
+void seg_release_pages(SEGMENT *);
+int seg_transfer(SEGMENT *, int, int, void *, int, int);
+
 /* pagein.c */
 int seg_pagein(SEGMENT *, int);
 
@@ -20,8 +56,18 @@ int seg_pageout(SEGMENT *, int);
 int seg_seek(const SEGMENT *, int, int);
 int seg_seek_fast(const SEGMENT *, int, int);
 int seg_seek_slow(const SEGMENT *, int, int);
+off_t seg_offset(const SEGMENT *, int, int);
+ssize_t seg_read_at(const SEGMENT *, void *, size_t, off_t);
+ssize_t seg_write_at(const SEGMENT *, const void *, size_t, off_t);
 
 /* setup.c */
 int seg_setup(SEGMENT *);
+int seg_setup_slots(SEGMENT *);
+
+/* threads.c */
+SEGMENT *seg_lock(SEGMENT *, int);
+void seg_unlock(SEGMENT *, int);
+int seg_flush_stripes(SEGMENT *);
+void seg_release_stripes(SEGMENT *);
 
 #endif /* Segment_LOCAL_H */
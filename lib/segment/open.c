@@ -11,6 +11,7 @@
  * \date 2018
  */
 
+#include <stdlib.h>
 #include <unistd.h>
 #include <fcntl.h>
 #include <grass/gis.h>
@@ -46,6 +47,7 @@ int Segment_open(SEGMENT *SEG, char *fname, off_t nrows, off_t ncols, int srows,
 {
     int ret;
     int nseg_total;
+    char *name;
 
     nseg_total = ((nrows + srows - 1) / srows) * ((ncols + scols - 1) / scols);
 
@@ -58,6 +60,10 @@ int Segment_open(SEGMENT *SEG, char *fname, off_t nrows, off_t ncols, int srows,
         SEG->nseg = nseg;
         SEG->cache = G_calloc(sizeof(char) * SEG->nrows * SEG->ncols, SEG->len);
         SEG->scb = NULL;
+        SEG->nstripes = 0;
+        SEG->stripes = NULL;
+        SEG->pages = NULL;
+        SEG->zbuf = NULL;
         SEG->open = 1;
 
         return 1;
@@ -116,5 +122,15 @@ int Segment_open(SEGMENT *SEG, char *fname, off_t nrows, off_t ncols, int srows,
         }
     }
 
+    /* optional compression, see Segment_set_compression() */
+    if ((name = getenv("GRASS_SEGMENT_COMPRESSOR")) && *name) {
+        int method = G_compressor_number(name);
+
+        if (method < 1)
+            G_warning(_("Unknown segment compression method <%s>"), name);
+        else
+            Segment_set_compression(SEG, method);
+    }
+
     return 1;
 }
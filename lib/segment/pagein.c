@@ -90,16 +90,15 @@ int seg_pagein(SEGMENT *SEG, int n)
     /* read in the segment */
     SEG->scb[cur].n = n;
     SEG->scb[cur].dirty = 0;
-    if (SEG->seek(SEG, SEG->scb[cur].n, 0) == -1) {
-        int err = errno;
-        G_warning(_("File read/write operation failed: %s (%d)"), strerror(err),
-                  err);
-        return -1;
+    if (SEG->pages && (read_result = seg_read_page(SEG, n,
+                                                   SEG->scb[cur].buf)) != 0) {
+        if (read_result < 0) {
+            G_warning("Segment pagein: unable to read segment %d", n);
+            return -1;
+        }
     }
-
-    read_result = read(SEG->fd, SEG->scb[cur].buf, SEG->size);
-
-    if (read_result == 0) {
+    else if ((read_result = seg_read_at(SEG, SEG->scb[cur].buf, SEG->size,
+                                        seg_offset(SEG, n, 0))) == 0) {
         /* this can happen if the file was not zero-filled,
          * i.e. formatted with Segment_format_nofill() or
          * Segment_format() used lseek for file initialization */
@@ -36,14 +36,15 @@
  */
 int seg_pageout(SEGMENT *SEG, int i)
 {
-    if (SEG->seek(SEG, SEG->scb[i].n, 0) == -1) {
-        int err = errno;
-        G_warning(_("File read/write operation failed: %s (%d)"), strerror(err),
-                  err);
-        return -1;
-    }
+    int ok;
+
     errno = 0;
-    if (write(SEG->fd, SEG->scb[i].buf, SEG->size) != SEG->size) {
+    if (SEG->pages)
+        ok = seg_write_page(SEG, SEG->scb[i].n, SEG->scb[i].buf) > 0;
+    else
+        ok = seg_write_at(SEG, SEG->scb[i].buf, SEG->size,
+                          seg_offset(SEG, SEG->scb[i].n, 0)) == SEG->size;
+    if (!ok) {
         int err = errno;
 
         if (err)
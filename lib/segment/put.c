@@ -41,6 +41,7 @@
  */
 int Segment_put(SEGMENT *SEG, const void *buf, off_t row, off_t col)
 {
+    SEGMENT *S;
     int index, n, i;
 
     if (SEG->cache) {
@@ -51,14 +52,17 @@ int Segment_put(SEGMENT *SEG, const void *buf, off_t row, off_t col)
     }
 
     SEG->address(SEG, row, col, &n, &index);
-    if ((i = seg_pagein(SEG, n)) < 0) {
+    S = seg_lock(SEG, n);
+    if ((i = seg_pagein(S, n)) < 0) {
+        seg_unlock(SEG, n);
         G_warning("segment lib: put: pagein failed");
         return -1;
     }
 
-    SEG->scb[i].dirty = 1;
+    S->scb[i].dirty = 1;
 
-    memcpy(&SEG->scb[i].buf[index], buf, SEG->len);
+    memcpy(&S->scb[i].buf[index], buf, SEG->len);
+    seg_unlock(SEG, n);
 
     return 1;
 }
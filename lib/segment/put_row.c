@@ -21,6 +21,25 @@
 
 #include "local_proto.h"
 
+static int put_row_pages(SEGMENT *SEG, const void *buf, off_t row)
+{
+    off_t col;
+    int n, index, size;
+
+    for (col = 0; col < SEG->ncols; col += SEG->scols) {
+        size = (col + SEG->scols > SEG->ncols ? SEG->ncols - col : SEG->scols) *
+               SEG->len;
+        SEG->address(SEG, row, col, &n, &index);
+        if (seg_transfer(SEG, n, index, (void *)buf, size, 1) < 0) {
+            G_warning("Segment_put_row: unable to write segment %d", n);
+            return -1;
+        }
+        buf = ((const char *)buf) + size;
+    }
+
+    return 1;
+}
+
 /*      buf is CELL *   WRAT code       */
 /* int Segment_put_row (SEGMENT *SEG, CELL *buf,int row) */
 
@@ -56,6 +75,10 @@ int Segment_put_row(const SEGMENT *SEG, const void *buf, off_t row)
         return 1;
     }
 
+    /* compressed segments are written through the segments in memory */
+    if (SEG->pages)
+        return put_row_pages((SEGMENT *)SEG, buf, row);
+
     ncols = SEG->ncols - SEG->spill;
     scols = SEG->scols;
     size = scols * SEG->len;
@@ -64,14 +87,8 @@ int Segment_put_row(const SEGMENT *SEG, const void *buf, off_t row)
 
     for (col = 0; col < ncols; col += scols) {
         SEG->address(SEG, row, col, &n, &index);
-        if (SEG->seek(SEG, n, index) == -1) {
-            int err = errno;
-            G_warning(_("File read/write operation failed: %s (%d)"),
-                      strerror(err), err);
-            return -1;
-        }
-
-        if ((result = write(SEG->fd, buf, size)) != size) {
+        if ((result = seg_write_at(SEG, buf, size,
+                                   seg_offset(SEG, n, index))) != size) {
             G_warning("Segment_put_row write error %s", strerror(errno));
             /*      printf("Segment_put_row result = %d. ncols: %d, scols %d,
              * size: %d, col %d, row: %d,  SEG->fd:
@@ -89,14 +106,7 @@ int Segment_put_row(const SEGMENT *SEG, const void *buf, off_t row)
 
     if ((size = SEG->spill * SEG->len)) {
         SEG->address(SEG, row, col, &n, &index);
-        if (SEG->seek(SEG, n, index) == -1) {
-            int err = errno;
-            G_warning(_("File read/write operation failed: %s (%d)"),
-                      strerror(err), err);
-            return -1;
-        }
-
-        if (write(SEG->fd, buf, size) != size) {
+        if (seg_write_at(SEG, buf, size, seg_offset(SEG, n, index)) != size) {
             G_warning("Segment_put_row final write error: %s", strerror(errno));
             return -1;
         }
@@ -37,6 +37,9 @@ int Segment_release(SEGMENT *SEG)
     if (SEG->open != 1)
         return -1;
 
+    seg_release_stripes(SEG);
+    seg_release_pages(SEG);
+
     for (i = 0; i < SEG->nseg; i++)
         G_free(SEG->scb[i].buf);
     G_free(SEG->scb);
@@ -59,3 +59,120 @@ int seg_seek(const SEGMENT *SEG, int n, int index)
 {
     return SEG->seek(SEG, n, index);
 }
+
+/**
+ * \brief Internal use only
+ *
+ * Offset of a segment in the segment file.
+ *
+ * \param[in] SEG segment
+ * \param[in] n segment number
+ * \param[in] index offset in the segment
+ * \return offset in the file
+ */
+off_t seg_offset(const SEGMENT *SEG, int n, int index)
+{
+    if (SEG->fast_seek)
+        return SEG_SEEK_FAST(SEG, n, index);
+
+    return SEG_SEEK_SLOW(SEG, n, index);
+}
+
+#if defined(_WIN32) && defined(HAVE_PTHREAD_H)
+/* no pread() and pwrite(), the threads share the file position */
+static pthread_mutex_t io_mutex = PTHREAD_MUTEX_INITIALIZER;
+#endif
+
+/**
+ * \brief Internal use only
+ *
+ * Reads from the segment file at an offset without using the file
+ * position, so that several threads can read at once.
+ *
+ * \param[in] SEG segment
+ * \param[out] buf buffer
+ * \param[in] size number of bytes
+ * \param[in] offset offset in the file
+ * \return number of bytes read, less than size at the end of the file
+ * \return -1 on error
+ */
+ssize_t seg_read_at(const SEGMENT *SEG, void *buf, size_t size, off_t offset)
+{
+#ifndef _WIN32
+    size_t total = 0;
+
+    while (total < size) {
+        ssize_t n = pread(SEG->fd, (char *)buf + total, size - total,
+                          offset + (off_t)total);
+
+        if (n < 0)
+            return -1;
+        if (n == 0)
+            break;
+        total += n;
+    }
+
+    return total;
+#else
+    ssize_t n;
+
+#ifdef HAVE_PTHREAD_H
+    pthread_mutex_lock(&io_mutex);
+#endif
+    if (lseek(SEG->fd, offset, SEEK_SET) == -1)
+        n = -1;
+    else
+        n = read(SEG->fd, buf, size);
+#ifdef HAVE_PTHREAD_H
+    pthread_mutex_unlock(&io_mutex);
+#endif
+
+    return n;
+#endif
+}
+
+/**
+ * \brief Internal use only
+ *
+ * Writes to the segment file at an offset, see seg_read_at().
+ *
+ * \param[in] SEG segment
+ * \param[in] buf data
+ * \param[in] size number of bytes
+ * \param[in] offset offset in the file
+ * \return number of bytes written
+ * \return -1 on error
+ */
+ssize_t seg_write_at(const SEGMENT *SEG, const void *buf, size_t size,
+                     off_t offset)
+{
+#ifndef _WIN32
+    size_t total = 0;
+
+    while (total < size) {
+        ssize_t n = pwrite(SEG->fd, (const char *)buf + total, size - total,
+                           offset + (off_t)total);
+
+        if (n <= 0)
+            return n < 0 ? -1 : (ssize_t)total;
+        total += n;
+    }
+
+    return total;
+#else
+    ssize_t n;
+
+#ifdef HAVE_PTHREAD_H
+    pthread_mutex_lock(&io_mutex);
+#endif
+    if (lseek(SEG->fd, offset, SEEK_SET) == -1)
+        n = -1;
+    else
+        n = write(SEG->fd, buf, size);
+#ifdef HAVE_PTHREAD_H
+    pthread_mutex_unlock(&io_mutex);
+#endif
+
+    return n;
+#endif
+}
@@ -42,6 +42,10 @@ int seg_setup(SEGMENT *SEG)
 
     SEG->open = 0;
     SEG->cache = NULL;
+    SEG->nstripes = 0;
+    SEG->stripes = NULL;
+    SEG->pages = NULL;
+    SEG->zbuf = NULL;
 
     if (SEG->nrows <= 0 || SEG->ncols <= 0 || SEG->srows <= 0 ||
         SEG->scols <= 0 || SEG->len <= 0 || SEG->nseg <= 0) {
@@ -119,6 +123,48 @@ int seg_setup(SEGMENT *SEG)
         NULL)
         return -2;
 
+    SEG->srowscols = SEG->srows * SEG->scols;
+    SEG->size = SEG->srowscols * SEG->len;
+
+    for (i = 0; i < SEG->nseg; i++)
+        if ((SEG->scb[i].buf = G_malloc(SEG->size)) == NULL)
+            return -2;
+
+    if (seg_setup_slots(SEG) < 0)
+        return -2;
+
+    SEG->open = 1;
+
+    /* index for each segment, same like cache of r.proj */
+
+    /* alternative using less memory: RB Tree */
+    /* SEG->loaded = rbtree_create(cmp, sizeof(SEGID)); */
+    /* SEG->loaded = NULL; */
+
+    SEG->load_idx = G_malloc(n_total_segs * sizeof(int));
+
+    for (i = 0; i < n_total_segs; i++)
+        SEG->load_idx[i] = -1;
+
+    return 1;
+}
+
+/**
+ * \brief Internal use only
+ *
+ * Marks all slots of the segment free and sets up the age queue.
+ *
+ * The buffers of the <b>SEG->nseg</b> slots in <b>SEG->scb</b> must be
+ * allocated.
+ *
+ * \param[in,out] SEG segment
+ * \return 1 if successful
+ * \return -2 if unable to allocate memory
+ */
+int seg_setup_slots(SEGMENT *SEG)
+{
+    int i;
+
     if ((SEG->freeslot = (int *)G_malloc(SEG->nseg * sizeof(int))) == NULL)
         return -2;
 
@@ -126,13 +172,7 @@ int seg_setup(SEGMENT *SEG)
                                                sizeof(struct aq))) == NULL)
         return -2;
 
-    SEG->srowscols = SEG->srows * SEG->scols;
-    SEG->size = SEG->srowscols * SEG->len;
-
     for (i = 0; i < SEG->nseg; i++) {
-        if ((SEG->scb[i].buf = G_malloc(SEG->size)) == NULL)
-            return -2;
-
         SEG->scb[i].n = -1; /* mark free */
         SEG->scb[i].dirty = 0;
         SEG->scb[i].age = NULL;
@@ -155,18 +195,6 @@ int seg_setup(SEGMENT *SEG)
 
     SEG->nfreeslots = SEG->nseg;
     SEG->cur = 0;
-    SEG->open = 1;
-
-    /* index for each segment, same like cache of r.proj */
-
-    /* alternative using less memory: RB Tree */
-    /* SEG->loaded = rbtree_create(cmp, sizeof(SEGID)); */
-    /* SEG->loaded = NULL; */
-
-    SEG->load_idx = G_malloc(n_total_segs * sizeof(int));
-
-    for (i = 0; i < n_total_segs; i++)
-        SEG->load_idx[i] = -1;
 
     return 1;
 }
@@ -0,0 +1,152 @@
+"""Test of segment access by several threads
+
+@copyright 2026 by the GRASS Development Team
+
+@license This program is free software under the GNU General Public License (>=v2).
+Read the file COPYING that comes with GRASS
+for details
+"""
+
+import ctypes
+import os
+import shutil
+import tempfile
+import threading
+
+from grass.gunittest.case import TestCase
+from grass.gunittest.main import test
+from grass.lib.gis import G_compressor_number
+from grass.lib.segment import (
+    SEGMENT,
+    Segment_close,
+    Segment_flush,
+    Segment_get,
+    Segment_get_row,
+    Segment_open,
+    Segment_put,
+    Segment_set_compression,
+    Segment_set_threads,
+)
+
+
+class SegmentThreadsTestCase(TestCase):
+    nrows = 100
+    ncols = 90
+    # 13 x 12 segments, few of them in memory
+    srows = 8
+    scols = 8
+    nseg = 12
+    nthreads = 4
+
+    def setUp(self):
+        self.tmpdir = tempfile.mkdtemp()
+
+    def tearDown(self):
+        shutil.rmtree(self.tmpdir)
+
+    def value(self, row, col, version):
+        """Zeros first, then values which compress worse"""
+        return float(version * (row * self.ncols + col))
+
+    def in_threads(self, nthreads, function):
+        """Call function for each row, rows shared out among threads so
+        that threads write to the same segments"""
+        errors = []
+
+        def work(first):
+            for row in range(first, self.nrows, nthreads):
+                if function(row) != 1:
+                    errors.append(row)
+
+        threads = [threading.Thread(target=work, args=(t,)) for t in range(nthreads)]
+        for thread in threads:
+            thread.start()
+        for thread in threads:
+            thread.join()
+        self.assertEqual(errors, [])
+
+    def put_rows(self, seg, nthreads, version):
+        def put(row):
+            for col in range(self.ncols):
+                value = ctypes.c_double(self.value(row, col, version))
+                if Segment_put(seg, ctypes.byref(value), row, col) != 1:
+                    return -1
+            return 1
+
+        self.in_threads(nthreads, put)
+
+    def get_rows(self, seg, nthreads):
+        cells = [None] * self.nrows
+
+        def get(row):
+            value = ctypes.c_double()
+            cells[row] = []
+            for col in range(self.ncols):
+                if Segment_get(seg, ctypes.byref(value), row, col) != 1:
+                    return -1
+                cells[row].append(value.value)
+            return 1
+
+        self.in_threads(nthreads, get)
+        return cells
+
+    def run_segment(self, nthreads, compressor=None):
+        """Write and read a segment, return the rows read from the file
+        and the cells read through the segments in memory"""
+        seg = SEGMENT()
+        fname = os.path.join(self.tmpdir, f"seg_{nthreads}_{compressor}")
+        ret = Segment_open(
+            ctypes.byref(seg),
+            fname.encode(),
+            self.nrows,
+            self.ncols,
+            self.srows,
+            self.scols,
+            ctypes.sizeof(ctypes.c_double),
+            self.nseg,
+        )
+        self.assertEqual(ret, 1)
+        try:
+            if compressor:
+                method = G_compressor_number(compressor.encode())
+                self.assertEqual(Segment_set_compression(ctypes.byref(seg), method), 1)
+            # segments loaded by one thread are handed to the stripes
+            self.put_rows(ctypes.byref(seg), 1, 0)
+            self.assertEqual(Segment_set_threads(ctypes.byref(seg), nthreads), 1)
+            # compressed segments outgrow the space taken by the zeros
+            self.put_rows(ctypes.byref(seg), nthreads, 1)
+            cells = self.get_rows(ctypes.byref(seg), nthreads)
+
+            # segments changed in all stripes are written to the file
+            Segment_flush(ctypes.byref(seg))
+            rows = []
+            buf = (ctypes.c_double * self.ncols)()
+            for row in range(self.nrows):
+                self.assertEqual(Segment_get_row(ctypes.byref(seg), buf, row), 1)
+                rows.append(list(buf))
+        finally:
+            Segment_close(ctypes.byref(seg))
+
+        return rows, cells
+
+    def assertSameAsOneThread(self, compressor=None):
+        expected = [
+            [self.value(row, col, 1) for col in range(self.ncols)]
+            for row in range(self.nrows)
+        ]
+        rows, cells = self.run_segment(1, compressor)
+        self.assertEqual(rows, expected)
+        self.assertEqual(cells, expected)
+        rows, cells = self.run_segment(self.nthreads, compressor)
+        self.assertEqual(rows, expected)
+        self.assertEqual(cells, expected)
+
+    def test_threads(self):
+        self.assertSameAsOneThread()
+
+    def test_threads_compressed(self):
+        self.assertSameAsOneThread("ZLIB")
+
+
+if __name__ == "__main__":
+    test()
@@ -0,0 +1,208 @@
+/**
+ * \file lib/segment/threads.c
+ *
+ * \brief Segment access by several threads.
+ *
+ * The segments in memory are split into stripes, segment n goes to
+ * stripe n % nstripes. Each stripe has its own slots, age queue and last
+ * accessed segment, and a lock held while a thread pages a segment of
+ * the stripe in or out or copies data from or to it. Threads accessing
+ * segments of different stripes do not wait for each other. The segment
+ * file is read and written with pread() and pwrite(), which do not use
+ * the shared file position.
+ *
+ * This program is free software under the GNU General Public License
+ * (>=v2). Read the file COPYING that comes with GRASS for details.
+ *
+ * \author GRASS Development Team
+ *
+ * \date 2026
+ */
+
+#include <grass/gis.h>
+#include <grass/glocale.h>
+
+#include "local_proto.h"
+
+/* stripes per thread, more stripes make it less likely that two threads
+   wait for the same lock */
+#define STRIPES_PER_THREAD 4
+
+/**
+ * \brief Allow access to a segment by several threads.
+ *
+ * After this call, Segment_get(), Segment_put(), Segment_get_row(),
+ * Segment_put_row() and Segment_flush() may be called by <b>nthreads</b>
+ * threads at once, for instance from an OpenMP parallel loop. Threads
+ * writing the same cell at once, or reading a cell another thread
+ * writes, must synchronize themselves.
+ *
+ * The segments retained in memory are shared out among stripes, each with
+ * its own lock. Segments loaded before are written to the file if needed
+ * and dropped from memory. A segment kept in memory entirely, see
+ * Segment_open(), needs no locks.
+ *
+ * Without POSIX threads, the segment can only be used by one thread.
+ *
+ * \param[in,out] SEG segment
+ * \param[in] nthreads number of threads
+ * \return 1 if successful
+ * \return 0 if the segment can not be shared by threads
+ * \return -1 if SEGMENT is not available (not open) or unable to write
+ * the loaded segments
+ */
+int Segment_set_threads(SEGMENT *SEG, int nthreads)
+{
+#ifdef HAVE_PTHREAD_H
+    int nstripes, i, k;
+
+    if (SEG->open != 1)
+        return -1;
+
+    if (SEG->cache || nthreads <= 1 || SEG->nstripes)
+        return 1;
+
+    /* the segments in memory are the ones of the stripes from now on */
+    for (i = 0; i < SEG->nseg; i++) {
+        if (SEG->scb[i].n < 0)
+            continue;
+        if (SEG->scb[i].dirty && seg_pageout(SEG, i) < 0)
+            return -1;
+        SEG->load_idx[SEG->scb[i].n] = -1;
+    }
+    G_free(SEG->freeslot);
+    G_free(SEG->agequeue);
+    seg_setup_slots(SEG);
+
+    nstripes = nthreads * STRIPES_PER_THREAD;
+    if (nstripes > SEG->nseg)
+        nstripes = SEG->nseg;
+
+    G_debug(1, "Segment_set_threads: %d stripes of %d segments", nstripes,
+            SEG->nseg / nstripes);
+
+    SEG->stripes = G_malloc(nstripes * sizeof(struct seg_stripe));
+    for (k = 0; k < nstripes; k++) {
+        struct seg_stripe *st = &SEG->stripes[k];
+        SEGMENT *S = &st->seg;
+
+        /* a copy sharing the file, the index and the buffers */
+        *S = *SEG;
+        S->nstripes = 0;
+        S->stripes = NULL;
+        if (SEG->pages)
+            S->zbuf = G_malloc(SEG->pages->bound);
+        S->nseg = (SEG->nseg - k + nstripes - 1) / nstripes;
+        S->scb = G_malloc(S->nseg * sizeof(struct scb));
+        for (i = 0; i < S->nseg; i++)
+            S->scb[i].buf = SEG->scb[k + i * nstripes].buf;
+        seg_setup_slots(S);
+
+        pthread_mutex_init(&st->mutex, NULL);
+    }
+    SEG->nstripes = nstripes;
+
+    return 1;
+#else
+    if (SEG->open != 1)
+        return -1;
+
+    return SEG->cache || nthreads <= 1;
+#endif
+}
+
+/**
+ * \brief Internal use only
+ *
+ * Locks the stripe of a segment if the segment is shared by threads.
+ *
+ * \param[in] SEG segment
+ * \param[in] n segment number
+ * \return segment structure to page segment n in
+ */
+SEGMENT *seg_lock(SEGMENT *SEG, int n)
+{
+#ifdef HAVE_PTHREAD_H
+    if (SEG->nstripes) {
+        struct seg_stripe *st = &SEG->stripes[n % SEG->nstripes];
+
+        pthread_mutex_lock(&st->mutex);
+
+        return &st->seg;
+    }
+#endif
+
+    return SEG;
+}
+
+/**
+ * \brief Internal use only
+ *
+ * Unlocks the stripe locked by seg_lock().
+ *
+ * \param[in] SEG segment
+ * \param[in] n segment number
+ */
+void seg_unlock(SEGMENT *SEG, int n)
+{
+#ifdef HAVE_PTHREAD_H
+    if (SEG->nstripes)
+        pthread_mutex_unlock(&SEG->stripes[n % SEG->nstripes].mutex);
+#endif
+}
+
+/**
+ * \brief Internal use only
+ *
+ * Writes the modified segments of all stripes to the file.
+ *
+ * \param[in] SEG segment
+ * \return 0 if successful
+ * \return -1 if unable to write a segment
+ */
+int seg_flush_stripes(SEGMENT *SEG)
+{
+    int ret = 0;
+    int k, i;
+
+    for (k = 0; k < SEG->nstripes; k++) {
+        SEGMENT *S = seg_lock(SEG, k);
+
+        for (i = 0; i < S->nseg; i++)
+            if (S->scb[i].n >= 0 && S->scb[i].dirty &&
+                seg_pageout(S, i) < 0)
+                ret = -1;
+
+        seg_unlock(SEG, k);
+    }
+
+    return ret;
+}
+
+/**
+ * \brief Internal use only
+ *
+ * Frees the stripes, the buffers belong to the segment.
+ *
+ * \param[in,out] SEG segment
+ */
+void seg_release_stripes(SEGMENT *SEG)
+{
+    int k;
+
+    for (k = 0; k < SEG->nstripes; k++) {
+        struct seg_stripe *st = &SEG->stripes[k];
+
+        G_free(st->seg.scb);
+        G_free(st->seg.freeslot);
+        G_free(st->seg.agequeue);
+        G_free(st->seg.zbuf);
+#ifdef HAVE_PTHREAD_H
+        pthread_mutex_destroy(&st->mutex);
+#endif
+    }
+
+    G_free(SEG->stripes);
+    SEG->stripes = NULL;
+    SEG->nstripes = 0;
+}
@@ -24,8 +24,22 @@
 
 /* These routines manage the list of grid-cell candidates for
  * visiting to calculate distances to surrounding cells.
- * A min-heap approach is used.  Components are
- * sorted first by distance then by the order in which they were added.
+ * Components are sorted first by distance then by the order in which
+ * they were added.
+ *
+ * A radix heap is used as long as distances are not negative and not
+ * smaller than the last distance retrieved, as in a Dijkstra search
+ * with non-negative costs. Points are kept in 65 buckets by the highest
+ * bit in which their distance differs from the last distance
+ * retrieved, distances compared as the bits of doubles which are not
+ * negative. Inserting a point appends it to its bucket. Retrieving a
+ * point takes it from bucket 0, distances equal to the last one, in the
+ * order the points were added. If bucket 0 is empty, the points of the
+ * next bucket are redistributed to the lower buckets. A point is thus
+ * moved at most 64 times, and each step touches only adjacent memory.
+ *
+ * If a smaller distance is inserted, all points are moved to a
+ * min-heap, which is used from then on.
  *
  * insert ()
  *   inserts a new row-col with its distance value into the heap
@@ -38,6 +52,7 @@
  */
 
 #include <stdlib.h>
+#include <string.h>
 #include <grass/gis.h>
 #include <grass/glocale.h>
 #include "cost.h"
@@ -45,11 +60,25 @@
 #define GET_PARENT(c) (((c) - 2) / 3 + 1)
 #define GET_CHILD(p)  (((p) * 3) - 1)
 
+#define NBUCKETS 65
+
 static long next_point = 0;
 static long heap_size = 0;
 static long heap_alloced = 0;
 static struct cost **heap_index, *free_point;
 
+/* radix heap */
+static int use_radix;
+static long radix_size;
+static unsigned long long last_key;
+static struct bucket {
+    struct cost *pnt;
+    long n, alloced;
+    long first; /* next point of bucket 0 */
+} buckets[NBUCKETS];
+static struct cost lowest[2]; /* points returned by get_lowest() */
+static int cur_lowest;
+
 int init_heap(void)
 {
     next_point = 0;
@@ -59,17 +88,29 @@ int init_heap(void)
 
     free_point = NULL;
 
+    use_radix = 1;
+    radix_size = 0;
+    last_key = 0;
+    memset(buckets, 0, sizeof(buckets));
+    cur_lowest = 0;
+
     return 0;
 }
 
 int free_heap(void)
 {
+    int i;
+
     if (heap_alloced)
         G_free(heap_index);
 
     if (free_point)
         G_free(free_point);
 
+    for (i = 0; i < NBUCKETS; i++)
+        G_free(buckets[i].pnt);
+    memset(buckets, 0, sizeof(buckets));
+
     return 0;
 }
 
@@ -115,7 +156,7 @@ long sift_up(long start, struct cost *child_pnt)
     return child;
 }
 
-struct cost *insert(double min_cost, int row, int col)
+static struct cost *heap_insert(double min_cost, long age, int row, int col)
 {
     struct cost *new_cell;
 
@@ -127,11 +168,10 @@ struct cost *insert(double min_cost, int row, int col)
         new_cell = (struct cost *)(G_malloc(sizeof(struct cost)));
 
     new_cell->min_cost = min_cost;
-    new_cell->age = next_point;
+    new_cell->age = age;
     new_cell->row = row;
     new_cell->col = col;
 
-    next_point++;
     heap_size++;
     if (heap_size >= heap_alloced) {
         heap_alloced += 1000;
@@ -145,7 +185,7 @@ struct cost *insert(double min_cost, int row, int col)
     return (new_cell);
 }
 
-struct cost *get_lowest(void)
+static struct cost *heap_get_lowest(void)
 {
     struct cost *next_cell;
     register long parent, child, childr, i;
@@ -203,8 +243,167 @@ struct cost *get_lowest(void)
     return next_cell;
 }
 
+/* key of a distance, in the order of the distances if not negative */
+static unsigned long long get_key(double min_cost)
+{
+    unsigned long long key;
+
+    if (min_cost == 0)
+        return 0; /* also -0 */
+    memcpy(&key, &min_cost, sizeof(key));
+
+    return key;
+}
+
+/* bucket of a key: 0 if equal to the last key, else 1 + the highest bit
+ * in which they differ */
+static int get_bucket(unsigned long long key)
+{
+    unsigned long long diff = key ^ last_key;
+    int b = 0;
+
+    if (diff >> 32) {
+        diff >>= 32;
+        b += 32;
+    }
+    if (diff >> 16) {
+        diff >>= 16;
+        b += 16;
+    }
+    if (diff >> 8) {
+        diff >>= 8;
+        b += 8;
+    }
+    while (diff) {
+        diff >>= 1;
+        b++;
+    }
+
+    return b;
+}
+
+static struct cost *bucket_add(int b, struct cost *pnt)
+{
+    struct bucket *bk = &buckets[b];
+
+    if (bk->n >= bk->alloced) {
+        bk->alloced = bk->alloced ? bk->alloced * 2 : 64;
+        bk->pnt = (struct cost *)G_realloc(bk->pnt,
+                                           bk->alloced * sizeof(struct cost));
+    }
+    bk->pnt[bk->n] = *pnt;
+
+    return &bk->pnt[bk->n++];
+}
+
+static int cmp_age(const void *a, const void *b)
+{
+    const struct cost *ca = a, *cb = b;
+
+    return ca->age < cb->age ? -1 : ca->age > cb->age;
+}
+
+/* move all points to the min-heap */
+static void radix_to_heap(void)
+{
+    int i;
+    long j;
+
+    G_debug(1, "Distance smaller than the last one, using a min-heap");
+
+    for (i = 0; i < NBUCKETS; i++) {
+        struct bucket *bk = &buckets[i];
+
+        for (j = bk->first; j < bk->n; j++)
+            heap_insert(bk->pnt[j].min_cost, bk->pnt[j].age, bk->pnt[j].row,
+                        bk->pnt[j].col);
+        G_free(bk->pnt);
+    }
+    memset(buckets, 0, sizeof(buckets));
+    radix_size = 0;
+    use_radix = 0;
+}
+
+struct cost *insert(double min_cost, int row, int col)
+{
+    struct cost pnt;
+    unsigned long long key;
+
+    if (use_radix) {
+        key = get_key(min_cost);
+        if (min_cost < 0 || key < last_key)
+            radix_to_heap();
+    }
+
+    if (!use_radix)
+        return heap_insert(min_cost, next_point++, row, col);
+
+    pnt.min_cost = min_cost;
+    pnt.age = next_point++;
+    pnt.row = row;
+    pnt.col = col;
+    radix_size++;
+
+    /* valid until the next insert */
+    return bucket_add(get_bucket(key), &pnt);
+}
+
+struct cost *get_lowest(void)
+{
+    struct bucket *bk = &buckets[0];
+    int b;
+    long j;
+
+    if (!use_radix)
+        return heap_get_lowest();
+
+    if (radix_size == 0)
+        return NULL;
+
+    if (bk->first >= bk->n) {
+        struct bucket *from;
+        unsigned long long key, min_key;
+
+        bk->n = bk->first = 0;
+
+        /* the next bucket, its smallest distance is the new last one */
+        for (b = 1; buckets[b].n == 0; b++)
+            ;
+        from = &buckets[b];
+        min_key = get_key(from->pnt[0].min_cost);
+        for (j = 1; j < from->n; j++) {
+            key = get_key(from->pnt[j].min_cost);
+            if (key < min_key)
+                min_key = key;
+        }
+        last_key = min_key;
+
+        /* all points go to lower buckets, none to bucket b */
+        for (j = 0; j < from->n; j++)
+            bucket_add(get_bucket(get_key(from->pnt[j].min_cost)),
+                       &from->pnt[j]);
+        from->n = 0;
+
+        /* equal distances by the order they were added */
+        if (bk->n > 1)
+            qsort(bk->pnt, bk->n, sizeof(struct cost), cmp_age);
+    }
+
+    radix_size--;
+
+    /* the caller may still use the previous point */
+    cur_lowest = !cur_lowest;
+    lowest[cur_lowest] = bk->pnt[bk->first++];
+
+    return &lowest[cur_lowest];
+}
+
 int delete(struct cost *delete_cell)
 {
+    /* points of the radix heap are not allocated */
+    if (delete_cell == &lowest[0] || delete_cell == &lowest[1])
+        return 0;
+
     if (free_point)
         G_free(delete_cell);
     else
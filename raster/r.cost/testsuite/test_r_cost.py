@@ -0,0 +1,137 @@
+"""Test of r.cost
+
+@copyright 2026 by the GRASS Development Team
+
+@license This program is free software under the GNU General Public License (>=v2).
+Read the file COPYING that comes with GRASS
+for details
+"""
+
+import os
+
+from grass.gunittest.case import TestCase
+from grass.gunittest.main import test
+
+
+class TestCostSegments(TestCase):
+    """Compare outputs computed with segments stored compressed"""
+
+    start = "638000,220000,634000,224000,643000,217000"
+    to_remove = []
+
+    @classmethod
+    def setUpClass(cls):
+        cls.use_temp_region()
+        cls.runModule("g.region", raster="elevation")
+
+    @classmethod
+    def tearDownClass(cls):
+        cls.del_temp_region()
+        cls.runModule("g.remove", flags="f", type="raster", name=cls.to_remove)
+
+    def cost(self, output, **env):
+        """Run r.cost with the least memory, most segments are on disk"""
+        self.assertModule(
+            "r.cost",
+            input="elevation",
+            output=output,
+            outdir=f"{output}_dir",
+            start_coordinates=self.start,
+            memory=1,
+            env_=dict(os.environ, **env),
+        )
+        self.to_remove.extend([output, f"{output}_dir"])
+
+    def test_compressor(self):
+        """Test that compressed segments give the same costs
+
+        Segments hold no costs yet when the search starts, once filled they
+        grow out of the space they first took in the segment file.
+        """
+        self.cost("cost_seg_ref")
+        for compressor in ("LZ4", "ZLIB"):
+            output = f"cost_seg_{compressor}"
+            self.cost(output, GRASS_SEGMENT_COMPRESSOR=compressor)
+            self.assertRastersEqual(output, reference="cost_seg_ref", precision=0)
+            self.assertRastersEqual(
+                f"{output}_dir", reference="cost_seg_ref_dir", precision=0
+            )
+
+
+class TestCostHeap(TestCase):
+    """Compare the radix heap with the min-heap on equal costs
+
+    A negative start value makes r.cost move all cells to the min-heap.
+    The negative start is surrounded by null costs, so that it changes
+    no other cell.
+    """
+
+    to_remove = []
+
+    @classmethod
+    def setUpClass(cls):
+        cls.use_temp_region()
+        cls.runModule("g.region", n=40, s=0, e=50, w=0, res=1)
+        isolated = "row() == 3 && col() == 3"
+        starts = (
+            "if(row() == 10 && col() == 10, 0, "
+            "if(row() == 10 && col() == 40, 2, "
+            "if(row() == 30 && col() == 25, 1, null())))"
+        )
+        maps = {
+            "heap_cost": f"if(row() <= 5 && col() <= 5 && !({isolated}), null(), 1)",
+            "heap_start": starts,
+            "heap_start_neg": f"if({isolated}, -1, {starts})",
+        }
+        for name, expression in maps.items():
+            cls.runModule("r.mapcalc", expression=f"{name} = {expression}")
+            cls.to_remove.append(name)
+
+    @classmethod
+    def tearDownClass(cls):
+        cls.del_temp_region()
+        cls.runModule("g.remove", flags="f", type="raster", name=cls.to_remove)
+
+    def cost(self, output, start, flags):
+        """Run r.cost with the start values as start costs"""
+        self.assertModule(
+            "r.cost",
+            flags="r" + flags,
+            input="heap_cost",
+            start_raster=start,
+            output=output,
+            nearest=f"{output}_near",
+            outdir=f"{output}_dir",
+        )
+        self.to_remove.extend([output, f"{output}_near", f"{output}_dir"])
+
+    def assertSameAsMinHeap(self, flags):
+        radix = f"heap_radix{flags}"
+        min_heap = f"heap_min{flags}"
+        self.cost(radix, "heap_start", flags)
+        self.cost(min_heap, "heap_start_neg", flags)
+        for suffix in ("", "_near", "_dir"):
+            # without the isolated start
+            self.runModule(
+                "r.mapcalc",
+                expression=(
+                    f"{min_heap}{suffix}_cut = "
+                    f"if(row() == 3 && col() == 3, null(), {min_heap}{suffix})"
+                ),
+            )
+            self.to_remove.append(f"{min_heap}{suffix}_cut")
+            self.assertRastersEqual(
+                f"{radix}{suffix}", reference=f"{min_heap}{suffix}_cut", precision=0
+            )
+
+    def test_ties(self):
+        """Test that cells with equal costs are taken in the same order"""
+        self.assertSameAsMinHeap("")
+
+    def test_ties_knight(self):
+        """Test ties with the knight's move"""
+        self.assertSameAsMinHeap("k")
+
+
+if __name__ == "__main__":
+    test()
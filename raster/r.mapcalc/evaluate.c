@@ -5,6 +5,11 @@
 #include <stdlib.h>
 #include <unistd.h>
 #include <string.h>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sched.h>
+#endif
 
 #include <grass/gis.h>
 #include <grass/raster.h>
@@ -18,7 +23,13 @@
 
 int current_depth;
 int *current_row;
+int *current_col;
 int depths, rows;
+int region_columns;
+
+/* rows begun by each thread, to evaluate shared subexpressions once per
+   row */
+static int *rows_begun;
 
 /* Local variables for map management */
 static expression **map_list = NULL;
@@ -97,6 +108,10 @@ static void free_buf(expression *e)
     threads = omp_get_max_threads();
 #endif
 
+    /* operations inside fused kernels have no buffers */
+    if (!e->buf)
+        return;
+
     for (int t = 0; t < threads; t++) {
         G_free(e->buf[t]);
         e->buf[t] = NULL;
@@ -110,7 +125,9 @@ static void free_argv(expression *e)
     int i;
 
     for (i = 1; i <= e->data.func.argc; i++) {
-        free_buf(e->data.func.args[i]);
+        /* the buffers of variables belong to their bindings */
+        if (e->data.func.args[i]->type != expr_type_variable)
+            free_buf(e->data.func.args[i]);
         e->data.func.args[i]->buf = NULL;
     }
 
@@ -150,6 +167,15 @@ static void initialize_function(expression *e)
     int i;
 
     allocate_buf(e);
+
+    /* fused subtrees only need the buffers of their leaves */
+    e->kernel = build_kernel(e, bytecode_flag);
+    if (e->kernel) {
+        for (i = 0; i < e->kernel->num_leaves; i++)
+            initialize(e->kernel->leaves[i]);
+        return;
+    }
+
     e->data.func.argv = G_malloc((e->data.func.argc + 1) * sizeof(void **));
     e->data.func.argv[0] = e->buf;
 
@@ -163,6 +189,55 @@ static void initialize_binding(expression *e)
 {
     initialize(e->data.bind.val);
     set_buf(e, e->data.bind.val->buf);
+
+    if (!e->data.bind.var) {
+        int threads = 1;
+#if defined(_OPENMP)
+        threads = omp_get_max_threads();
+#endif
+        e->data.bind.evaluated = G_calloc(threads, sizeof(int));
+    }
+}
+
+static void evaluate_constant(expression *e);
+static void evaluate_function(expression *e);
+
+/* constant expressions are evaluated once, for all threads */
+static void fold(expression *e)
+{
+    int threads = 1;
+#if defined(_OPENMP)
+    threads = omp_get_max_threads();
+#endif
+
+    if (e->type == expr_type_constant)
+        evaluate_constant(e);
+    else
+        evaluate_function(e);
+
+    for (int t = 1; t < threads; t++)
+        memcpy(e->buf[t], e->buf[0], columns * Rast_cell_size(e->res_type));
+}
+
+/* whether the value of e may be left uncomputed: it has no bindings,
+   which define variables, and no rand(), which would draw other numbers */
+static int is_pure(const expression *e)
+{
+    int i;
+
+    switch (e->type) {
+    case expr_type_binding:
+        return 0;
+    case expr_type_function:
+        if (e->data.func.func == f_rand)
+            return 0;
+        for (i = 1; i <= e->data.func.argc; i++)
+            if (!is_pure(e->data.func.args[i]))
+                return 0;
+        return 1;
+    default:
+        return 1;
+    }
 }
 
 static void initialize(expression *e)
@@ -187,6 +262,11 @@ static void initialize(expression *e)
     default:
         G_fatal_error(_("Unknown type: %d"), e->type);
     }
+
+    e->pure = is_pure(e);
+
+    if (e->constant)
+        fold(e);
 }
 
 /****************************************************************************/
@@ -240,9 +320,28 @@ static void evaluate_constant(expression *e)
     }
 }
 
-static void evaluate_variable(expression *e UNUSED)
+/* a thread begins to evaluate the expressions for a row, or a row of a
+   tile */
+static void begin_row(int tid)
 {
-    /* this is a no-op */
+    rows_begun[tid]++;
+}
+
+static void evaluate_variable(expression *e)
+{
+    expression *b = e->data.var.bind;
+    int tid = 0;
+#if defined(_OPENMP)
+    tid = omp_get_thread_num();
+#endif
+
+    /* shared subexpressions are evaluated where first used in the row,
+       so that they are left unevaluated where no use of them is */
+    if (b->data.bind.evaluated &&
+        b->data.bind.evaluated[tid] != rows_begun[tid]) {
+        b->data.bind.evaluated[tid] = rows_begun[tid];
+        evaluate(b->data.bind.val);
+    }
 }
 
 static void evaluate_map(expression *e)
@@ -251,12 +350,194 @@ static void evaluate_map(expression *e)
 #if defined(_OPENMP)
     tid = omp_get_thread_num();
 #endif
+
+    if (e->data.map.band) {
+        get_band_row(e, current_row[tid] + e->data.map.row,
+                     current_col[tid] + e->data.map.col, e->buf[tid]);
+        return;
+    }
+
     get_map_row(e->data.map.idx[tid], e->data.map.mod,
                 current_depth + e->data.map.depth,
                 current_row[tid] + e->data.map.row, e->data.map.col,
                 e->buf[tid], e->res_type);
 }
 
+/****************************************************************************/
+
+/* Arguments whose values are not used are left unevaluated, for rows:
+ *
+ * - if() evaluates its condition first, then only the arguments selected
+ *   by some cell of the row. A condition which is null in the whole row
+ *   selects none.
+ * - Functions whose result is null where any argument is null, and fused
+ *   kernels, evaluate their first argument first. If it is null in the
+ *   whole row, so is the result.
+ *
+ * Arguments which are not pure, see is_pure(), are always evaluated.
+ * Shared subexpressions, see optimize.c, are evaluated by the first of
+ * their uses evaluated in the row.
+ */
+
+/* functions whose result is null where any argument is null */
+static func_t *const strict_funcs[] = {
+    f_add,    f_sub,    f_mul,   f_div,    f_mod,    f_pow,    f_neg,
+    f_abs,    f_ceil,   f_floor, f_gt,     f_ge,     f_lt,     f_le,
+    f_eq,     f_ne,     f_and,   f_or,     f_not,    f_bitand, f_bitor,
+    f_bitxor, f_shiftl, f_shiftr, f_shiftru, f_bitnot, f_sqrt, f_sin,
+    f_cos,    f_tan,    f_acos,  f_asin,   f_exp,    f_log,    f_atan,
+    f_int,    f_float,  f_double, f_round, f_max,    f_min,    f_median,
+    f_mode,   NULL};
+
+static int is_strict(func_t *func)
+{
+    int i;
+
+    for (i = 0; strict_funcs[i]; i++)
+        if (strict_funcs[i] == func)
+            return 1;
+
+    return 0;
+}
+
+static int all_null(const void *buf, int res_type)
+{
+    const CELL *ibuf = buf;
+    const FCELL *fbuf = buf;
+    const DCELL *dbuf = buf;
+    int i;
+
+    switch (res_type) {
+    case CELL_TYPE:
+        for (i = 0; i < columns; i++)
+            if (!IS_NULL_C(&ibuf[i]))
+                return 0;
+        break;
+    case FCELL_TYPE:
+        for (i = 0; i < columns; i++)
+            if (!IS_NULL_F(&fbuf[i]))
+                return 0;
+        break;
+    case DCELL_TYPE:
+        for (i = 0; i < columns; i++)
+            if (!IS_NULL_D(&dbuf[i]))
+                return 0;
+        break;
+    }
+
+    return 1;
+}
+
+/* evaluate the expressions args[i] with use[i] set or not pure */
+static void evaluate_some(expression **args, const int *use, int num)
+{
+    int count = 0;
+    int i;
+
+    for (i = 0; i < num; i++)
+        if (use[i] || !args[i]->pure)
+            count++;
+
+    for (i = 0; i < num; i++)
+        if (use[i] || !args[i]->pure) {
+            if (count > 1)
+                begin_evaluate(args[i]);
+            else
+                evaluate(args[i]);
+        }
+
+    if (count > 1)
+        for (i = 0; i < num; i++)
+            if (use[i] || !args[i]->pure)
+                end_evaluate(args[i]);
+}
+
+/* evaluate the arguments of a function whose result is null where any
+   argument is null, returns 0 if the result is null in the whole row */
+static int evaluate_strict(expression **args, int num, int tid)
+{
+    int *use = G_alloca(num * sizeof(int));
+    int i;
+
+    evaluate(args[0]);
+
+    if (num > 1 && all_null(args[0]->buf[tid], args[0]->res_type)) {
+        for (i = 1; i < num; i++)
+            if (!args[i]->pure)
+                break;
+        if (i == num) {
+            G_freea(use);
+            return 0;
+        }
+    }
+
+    use[0] = 0;
+    for (i = 1; i < num; i++)
+        use[i] = 1;
+    evaluate_some(args + 1, use + 1, num - 1);
+
+    G_freea(use);
+
+    return 1;
+}
+
+/* evaluate the condition of if() and the arguments it selects */
+static void evaluate_if(expression *e, int tid)
+{
+    int argc = e->data.func.argc;
+    expression **args = e->data.func.args;
+    const DCELL *cond;
+    int use[5] = {0, 0, 0, 0, 0};
+    int i;
+
+    evaluate(args[1]);
+
+    if (argc == 1)
+        return;
+
+    cond = args[1]->buf[tid];
+    for (i = 0; i < columns; i++) {
+        if (IS_NULL_D(&cond[i]))
+            continue;
+        if (argc == 4)
+            use[cond[i] > 0.0 ? 2 : cond[i] == 0.0 ? 3 : 4] = 1;
+        else
+            use[cond[i] != 0.0 ? 2 : 3] = 1;
+    }
+
+    evaluate_some(args + 2, use + 2, argc - 1);
+}
+
+static void set_null(expression *e, int tid)
+{
+    Rast_set_null_value(e->buf[tid], columns, e->res_type);
+}
+
+/****************************************************************************/
+
+static void evaluate_kernel(expression *e)
+{
+    kernel *k = e->kernel;
+    int tid = 0;
+#if defined(_OPENMP)
+    tid = omp_get_thread_num();
+#endif
+
+    /* bytecode evaluates its leaves when it needs them */
+    if (k->bytecode) {
+        run_kernel(k, e->buf[tid], tid, evaluate);
+        return;
+    }
+
+    /* the fused operations are null where an operand is null */
+    if (!evaluate_strict(k->leaves, k->num_leaves, tid)) {
+        set_null(e, tid);
+        return;
+    }
+
+    run_kernel(k, e->buf[tid], tid, NULL);
+}
+
 static void evaluate_function(expression *e)
 {
     int i;
@@ -266,7 +547,20 @@ static void evaluate_function(expression *e)
     tid = omp_get_thread_num();
 #endif
 
-    if (e->data.func.argc > 1 && e->data.func.func != f_eval) {
+    if (e->kernel) {
+        evaluate_kernel(e);
+        return;
+    }
+
+    if (e->data.func.func == f_if)
+        evaluate_if(e, tid);
+    else if (e->data.func.argc > 1 && is_strict(e->data.func.func)) {
+        if (!evaluate_strict(e->data.func.args + 1, e->data.func.argc, tid)) {
+            set_null(e, tid);
+            return;
+        }
+    }
+    else if (e->data.func.argc > 1 && e->data.func.func != f_eval) {
         for (i = 1; i <= e->data.func.argc; i++)
             begin_evaluate(e->data.func.args[i]);
 
@@ -278,7 +572,7 @@ static void evaluate_function(expression *e)
             evaluate(e->data.func.args[i]);
 
     /* copy the argv in the individual thread */
-    void **thread_argv = G_malloc((e->data.func.argc + 1) * sizeof(void *));
+    void **thread_argv = G_alloca((e->data.func.argc + 1) * sizeof(void *));
     for (i = 0; i < e->data.func.argc + 1; i++)
         thread_argv[i] = e->data.func.argv[i][tid];
 
@@ -289,7 +583,7 @@ static void evaluate_function(expression *e)
     for (i = 0; i < e->data.func.argc + 1; i++)
         e->data.func.argv[i][tid] = thread_argv[i];
 
-    G_free(thread_argv);
+    G_freea(thread_argv);
 
     switch (res) {
     case E_ARG_LO:
@@ -323,6 +617,10 @@ static void evaluate_function(expression *e)
 
 static void evaluate_binding(expression *e)
 {
+    /* shared subexpressions are evaluated through their uses */
+    if (e->data.bind.evaluated)
+        return;
+
     evaluate(e->data.bind.val);
 }
 
@@ -330,6 +628,10 @@ static void evaluate_binding(expression *e)
 
 static void evaluate(expression *e)
 {
+    /* computed by initialize() */
+    if (e->constant)
+        return;
+
     switch (e->type) {
     case expr_type_constant:
         evaluate_constant(e);
@@ -357,6 +659,761 @@ static expr_list *exprs;
 
 /****************************************************************************/
 
+/* The threads evaluate blocks of consecutive rows, in any order. Each
+ * evaluated row is stored in a buffer of the output rows of a few blocks,
+ * whichever thread finds the next row of an output map to write there
+ * writes the rows of this map in order. The maps are written independently,
+ * so with many outputs several threads write at once, each to its own map.
+ * A slot of the buffer is free once its row is written to all maps.
+ *
+ * A block of rows is evaluated by one thread, so the rows of maps with
+ * neighborhood modifiers are read once per block by the row cache of the
+ * thread, see map.c.
+ */
+
+#define MAX_BLOCK_ROWS   16
+#define MAX_REORDER_SIZE (64 << 20) /* bytes */
+
+struct reorder {
+    int size;         /* number of rows */
+    int next;         /* first row not yet written to all maps */
+    int *row;         /* row in each slot, -1 if empty */
+    void ***buf;      /* output rows of each slot */
+    expression **out; /* expressions written */
+    int *out_next;    /* next row to write of each of them */
+    int num_out;
+    int count, n; /* progress */
+    int verbose;
+#if defined(_OPENMP)
+    omp_lock_t state;   /* next, row and out_next */
+    omp_lock_t *writer; /* of each map, held by the thread writing */
+#endif
+};
+
+static struct reorder reorder;
+
+static void lock_state(void)
+{
+#if defined(_OPENMP)
+    omp_set_lock(&reorder.state);
+#endif
+}
+
+static void unlock_state(void)
+{
+#if defined(_OPENMP)
+    omp_unset_lock(&reorder.state);
+#endif
+}
+
+/* let the other threads run, e.g. the one evaluating the next row to write
+   when there are more threads than processors */
+static void yield(void)
+{
+#ifdef _WIN32
+    SwitchToThread();
+#else
+    sched_yield();
+#endif
+}
+
+static int block_rows(int threads, size_t row_size)
+{
+    int block = rows / (threads * 4);
+
+    if (block > MAX_BLOCK_ROWS)
+        block = MAX_BLOCK_ROWS;
+    while (block > 1 && (size_t)block * threads * 2 * row_size > MAX_REORDER_SIZE)
+        block /= 2;
+    if (block < 1)
+        block = 1;
+
+    return block;
+}
+
+static void setup_reorder(expression **exp_arr, int num_exprs, int threads,
+                          int *block)
+{
+    size_t row_size = 0;
+    int i, j;
+
+    reorder.out = G_malloc(num_exprs * sizeof(expression *));
+    reorder.out_next = G_malloc(num_exprs * sizeof(int));
+    reorder.num_out = 0;
+    for (i = 0; i < num_exprs; i++) {
+        expression *e = exp_arr[i];
+
+        if (e->type == expr_type_binding && e->data.bind.fd >= 0) {
+            reorder.out[reorder.num_out++] = e;
+            row_size += columns * Rast_cell_size(e->res_type);
+        }
+    }
+
+    *block = block_rows(threads, row_size);
+    reorder.size = *block * threads * 2;
+    reorder.row = G_malloc(reorder.size * sizeof(int));
+    reorder.buf = G_malloc(reorder.size * sizeof(void **));
+    for (i = 0; i < reorder.size; i++) {
+        reorder.buf[i] = G_malloc(reorder.num_out * sizeof(void *));
+        for (j = 0; j < reorder.num_out; j++)
+            reorder.buf[i][j] =
+                G_malloc(columns * Rast_cell_size(reorder.out[j]->res_type));
+    }
+
+#if defined(_OPENMP)
+    omp_init_lock(&reorder.state);
+    reorder.writer = G_malloc(reorder.num_out * sizeof(omp_lock_t));
+    for (j = 0; j < reorder.num_out; j++)
+        omp_init_lock(&reorder.writer[j]);
+#endif
+}
+
+static void start_reorder(void)
+{
+    int i;
+
+    reorder.next = 0;
+    for (i = 0; i < reorder.size; i++)
+        reorder.row[i] = -1;
+    for (i = 0; i < reorder.num_out; i++)
+        reorder.out_next[i] = 0;
+}
+
+static void release_reorder(void)
+{
+    int i, j;
+
+#if defined(_OPENMP)
+    omp_destroy_lock(&reorder.state);
+    for (j = 0; j < reorder.num_out; j++)
+        omp_destroy_lock(&reorder.writer[j]);
+    G_free(reorder.writer);
+#endif
+
+    for (i = 0; i < reorder.size; i++) {
+        for (j = 0; j < reorder.num_out; j++)
+            G_free(reorder.buf[i][j]);
+        G_free(reorder.buf[i]);
+    }
+    G_free(reorder.buf);
+    G_free(reorder.row);
+    G_free(reorder.out_next);
+    G_free(reorder.out);
+}
+
+static int row_ready(int row)
+{
+    int ready;
+
+    lock_state();
+    ready = reorder.row[row % reorder.size] == row;
+    unlock_state();
+
+    return ready;
+}
+
+/* free the slots of the rows written to all maps, with the state locked */
+static void release_rows(void)
+{
+    for (;;) {
+        int slot = reorder.next % reorder.size;
+        int j;
+
+        if (reorder.row[slot] != reorder.next)
+            return;
+        for (j = 0; j < reorder.num_out; j++)
+            if (reorder.out_next[j] <= reorder.next)
+                return;
+
+        reorder.row[slot] = -1;
+        reorder.next++;
+
+        if (reorder.verbose)
+            G_percent(reorder.n, reorder.count, 2);
+        reorder.n++;
+    }
+}
+
+/* write the stored rows of output j in order, unless another thread does */
+static void write_output(int j)
+{
+    expression *e = reorder.out[j];
+
+#if defined(_OPENMP)
+    if (!omp_test_lock(&reorder.writer[j]))
+        return;
+#endif
+
+    for (;;) {
+        int row = reorder.out_next[j];
+
+        if (!row_ready(row)) {
+#if defined(_OPENMP)
+            omp_unset_lock(&reorder.writer[j]);
+            /* the row may have been stored after the test, by a thread
+               which found the writer busy */
+            if (!row_ready(row) || !omp_test_lock(&reorder.writer[j]))
+                return;
+            continue;
+#else
+            return;
+#endif
+        }
+
+        put_map_row(e->data.bind.fd, reorder.buf[row % reorder.size][j],
+                    current_depth, row, e->res_type);
+
+        lock_state();
+        reorder.out_next[j]++;
+        release_rows();
+        unlock_state();
+    }
+}
+
+/* write the stored rows, thread tid starting with its own output so that
+   the threads spread over the maps */
+static void write_rows(int tid)
+{
+    int j;
+
+    for (j = 0; j < reorder.num_out; j++)
+        write_output((tid + j) % reorder.num_out);
+}
+
+/* store the output rows of the row evaluated by thread tid */
+static void store_row(int row, int tid)
+{
+    int slot = row % reorder.size;
+    int j;
+
+    /* wait for the slot while the rows before are written */
+    for (;;) {
+        int room;
+
+        lock_state();
+        room = row < reorder.next + reorder.size;
+        unlock_state();
+
+        if (room)
+            break;
+
+        write_rows(tid);
+        yield();
+    }
+
+    for (j = 0; j < reorder.num_out; j++) {
+        expression *e = reorder.out[j];
+
+        memcpy(reorder.buf[slot][j], e->buf[tid],
+               columns * Rast_cell_size(e->res_type));
+    }
+
+    lock_state();
+    reorder.row[slot] = row;
+    /* without maps to write, the row is done */
+    release_rows();
+    unlock_state();
+
+    write_rows(tid);
+}
+
+/****************************************************************************/
+
+/* Reductions, e.g. gmean(x), are computed in passes over the region before
+ * the one writing the maps, after which they are constants. A reduction
+ * whose argument uses other reductions is computed in a later pass, so
+ * that gmean((x - gmean(x))^2) takes two. A pass evaluates the arguments
+ * of its reductions and the bindings they use. Bindings using rand() are
+ * rejected there, they would be given other numbers in each pass.
+ *
+ * Reductions which are top level expressions are reported, they are
+ * computed in the pass writing the maps.
+ *
+ * The statistics of each row, or tile row, are kept apart and merged in
+ * order, so the results do not depend on the number of threads.
+ */
+
+struct reduction {
+    expression *e;
+    int pass;           /* 0 for the pass writing the maps */
+    struct stats total;
+    struct stats *part; /* of the rows of the current depth or band */
+};
+
+static struct reduction *reductions;
+static int num_reductions, num_passes, num_parts;
+
+static int binding_index(const expression *b, expression **exp_arr,
+                         int num_exprs)
+{
+    int i;
+
+    for (i = 0; i < num_exprs; i++)
+        if (exp_arr[i] == b)
+            return i;
+
+    G_fatal_error("internal error: binding_index: unknown binding");
+
+    return -1;
+}
+
+/* the number of passes needed before e can be evaluated, passes[] of the
+   top level expressions before it */
+static int needed_passes(const expression *e, expression **exp_arr,
+                         int num_exprs, const int *passes)
+{
+    int n = 0;
+    int i;
+
+    switch (e->type) {
+    case expr_type_variable:
+        return passes[binding_index(e->data.var.bind, exp_arr, num_exprs)];
+    case expr_type_binding:
+        return needed_passes(e->data.bind.val, exp_arr, num_exprs, passes);
+    case expr_type_function:
+        for (i = 1; i <= e->data.func.argc; i++) {
+            int m = needed_passes(e->data.func.args[i], exp_arr, num_exprs,
+                                  passes);
+
+            if (m > n)
+                n = m;
+        }
+        return is_reduction(e) ? n + 1 : n;
+    default:
+        return 0;
+    }
+}
+
+static void add_reduction(expression *e, int pass)
+{
+    struct reduction *r;
+
+    reductions =
+        G_realloc(reductions, (num_reductions + 1) * sizeof(struct reduction));
+    r = &reductions[num_reductions++];
+    r->e = e;
+    r->pass = pass;
+    memset(&r->total, 0, sizeof(r->total));
+    r->part = G_malloc(num_parts * sizeof(struct stats));
+
+    if (pass > num_passes)
+        num_passes = pass;
+}
+
+static void find_reductions(expression *e, expression **exp_arr,
+                            int num_exprs, const int *passes)
+{
+    int i;
+
+    switch (e->type) {
+    case expr_type_function:
+        for (i = 1; i <= e->data.func.argc; i++)
+            find_reductions(e->data.func.args[i], exp_arr, num_exprs, passes);
+        if (is_reduction(e))
+            add_reduction(e, needed_passes(e, exp_arr, num_exprs, passes));
+        break;
+    case expr_type_binding:
+        find_reductions(e->data.bind.val, exp_arr, num_exprs, passes);
+        break;
+    }
+}
+
+/* collect the reductions, returns those of the top level expressions */
+static struct reduction **setup_reductions(expression **exp_arr,
+                                           int num_exprs)
+{
+    struct reduction **top = G_calloc(num_exprs, sizeof(struct reduction *));
+    int *passes = G_malloc(num_exprs * sizeof(int));
+    int *index = G_malloc(num_exprs * sizeof(int));
+    int i;
+
+    reductions = NULL;
+    num_reductions = 0;
+    num_passes = 0;
+
+    for (i = 0; i < num_exprs; i++) {
+        expression *e = exp_arr[i];
+
+        passes[i] = needed_passes(e, exp_arr, num_exprs, passes);
+        index[i] = -1;
+
+        if (is_reduction(e)) {
+            /* only its arguments may be needed by others */
+            int j;
+
+            for (j = 1; j <= e->data.func.argc; j++)
+                find_reductions(e->data.func.args[j], exp_arr, num_exprs,
+                                passes);
+            index[i] = num_reductions;
+            add_reduction(e, 0);
+        }
+        else
+            find_reductions(e, exp_arr, num_exprs, passes);
+    }
+
+    /* the array may have moved */
+    for (i = 0; i < num_exprs; i++)
+        if (index[i] >= 0)
+            top[i] = &reductions[index[i]];
+
+    G_free(index);
+    G_free(passes);
+
+    return top;
+}
+
+static void release_reductions(struct reduction **top)
+{
+    int k;
+
+    for (k = 0; k < num_reductions; k++)
+        G_free(reductions[k].part);
+    G_free(reductions);
+    reductions = NULL;
+    num_reductions = 0;
+    G_free(top);
+}
+
+/* mark the top level expressions used by e */
+static void need_bindings(const expression *e, int *need,
+                          expression **exp_arr, int num_exprs)
+{
+    int i;
+
+    switch (e->type) {
+    case expr_type_variable:
+        i = binding_index(e->data.var.bind, exp_arr, num_exprs);
+        if (!need[i]) {
+            need[i] = 1;
+            need_bindings(exp_arr[i], need, exp_arr, num_exprs);
+        }
+        break;
+    case expr_type_function:
+        for (i = 1; i <= e->data.func.argc; i++)
+            need_bindings(e->data.func.args[i], need, exp_arr, num_exprs);
+        break;
+    case expr_type_binding:
+        need_bindings(e->data.bind.val, need, exp_arr, num_exprs);
+        break;
+    }
+}
+
+/* whether e draws random numbers, not counting the bindings it uses */
+static int uses_rand(const expression *e)
+{
+    int i;
+
+    switch (e->type) {
+    case expr_type_function:
+        if (e->data.func.func == f_rand)
+            return 1;
+        for (i = 1; i <= e->data.func.argc; i++)
+            if (uses_rand(e->data.func.args[i]))
+                return 1;
+        return 0;
+    case expr_type_binding:
+        return uses_rand(e->data.bind.val);
+    default:
+        return 0;
+    }
+}
+
+/* accumulate the first ncols cells of the argument of r in part */
+static void reduce_row(struct reduction *r, int part, int ncols, int tid)
+{
+    expression *arg = r->e->data.func.args[1];
+
+    evaluate(arg);
+    stats_row(&r->part[part], arg->buf[tid], ncols);
+}
+
+static void merge_parts(int pass, int num)
+{
+    int k, i;
+
+    for (k = 0; k < num_reductions; k++) {
+        struct reduction *r = &reductions[k];
+
+        if (r->pass == pass)
+            for (i = 0; i < num; i++)
+                stats_merge(&r->total, &r->part[i]);
+    }
+}
+
+/* the value of a reduction is constant from now on */
+static void set_reduction(struct reduction *r)
+{
+    expression *e = r->e;
+    DCELL x = stats_value(e, &r->total);
+    int threads = 1;
+    int t, i;
+
+#if defined(_OPENMP)
+    threads = omp_get_max_threads();
+#endif
+
+    for (t = 0; t < threads; t++) {
+        DCELL *buf = e->buf[t];
+
+        for (i = 0; i < columns; i++)
+            buf[i] = x;
+    }
+
+    e->constant = 1;
+}
+
+static void print_reduction(FILE *fp, const struct reduction *r)
+{
+    char *name = format_expression(r->e);
+    DCELL x = stats_value(r->e, &r->total);
+
+    if (Rast_is_d_null_value(&x))
+        fprintf(fp, "%s=null\n", name);
+    else
+        fprintf(fp, "%s=%.15g\n", name, x);
+
+    G_free(name);
+}
+
+/****************************************************************************/
+
+/* With tile=rows,cols, the region is evaluated in bands of rows, each split
+ * into tiles of columns which the threads evaluate in parallel. The
+ * expressions are evaluated for a row of a tile at a time, with columns
+ * set to the width of a tile, so that the buffers of a thread have this
+ * width instead of that of the region. The rows of the maps needed by a
+ * band are read before it is evaluated, see tile.c, its output rows are
+ * written after.
+ *
+ * The last tile of a band may extend past the region, the cells past it
+ * are not used.
+ */
+
+struct tiles {
+    int rows, cols;   /* of a tile, 0 if not tiled */
+    int num;          /* number of tiles in a band */
+    expression **out; /* expressions written */
+    int num_out;
+    void **buf; /* output rows of the band */
+};
+
+static struct tiles tiles;
+
+static void setup_tiles(void)
+{
+    tiles.rows = tile_rows < rows ? tile_rows : rows;
+    tiles.cols = tile_cols < region_columns ? tile_cols : region_columns;
+    tiles.num = (region_columns + tiles.cols - 1) / tiles.cols;
+    columns = tiles.cols;
+
+    G_verbose_message(_("Evaluating tiles of %d rows and %d columns"),
+                      tiles.rows, tiles.cols);
+}
+
+static void setup_tile_outputs(expression **exp_arr, int num_exprs)
+{
+    int i;
+
+    tiles.out = G_malloc(num_exprs * sizeof(expression *));
+    tiles.num_out = 0;
+    for (i = 0; i < num_exprs; i++) {
+        expression *e = exp_arr[i];
+
+        if (e->type == expr_type_binding && e->data.bind.fd >= 0)
+            tiles.out[tiles.num_out++] = e;
+    }
+
+    tiles.buf = G_malloc(tiles.num_out * sizeof(void *));
+    for (i = 0; i < tiles.num_out; i++)
+        tiles.buf[i] = G_malloc((size_t)tiles.rows * region_columns *
+                                Rast_cell_size(tiles.out[i]->res_type));
+}
+
+static void release_tiles(void)
+{
+    int i;
+
+    for (i = 0; i < tiles.num_out; i++)
+        G_free(tiles.buf[i]);
+    G_free(tiles.buf);
+    G_free(tiles.out);
+}
+
+/* number of columns of a tile in the region */
+static int tile_columns(int tile)
+{
+    int n = region_columns - tile * tiles.cols;
+
+    return n < tiles.cols ? n : tiles.cols;
+}
+
+/* store the output cells of a tile row evaluated by thread tid */
+static void store_tile(int i, int tile, int tid)
+{
+    int j;
+
+    for (j = 0; j < tiles.num_out; j++) {
+        expression *e = tiles.out[j];
+        size_t size = Rast_cell_size(e->res_type);
+        char *dst = (char *)tiles.buf[j] +
+                    ((size_t)i * region_columns + tile * tiles.cols) * size;
+
+        memcpy(dst, e->buf[tid], tile_columns(tile) * size);
+    }
+}
+
+static void write_band(int row0, int num)
+{
+    int i, j;
+
+    columns = region_columns;
+
+    for (i = 0; i < num; i++) {
+        for (j = 0; j < tiles.num_out; j++) {
+            expression *e = tiles.out[j];
+            size_t size = Rast_cell_size(e->res_type);
+
+            put_map_row(e->data.bind.fd,
+                        (char *)tiles.buf[j] + (size_t)i * region_columns * size,
+                        current_depth, row0 + i, e->res_type);
+        }
+
+        if (reorder.verbose)
+            G_percent(reorder.n, reorder.count, 2);
+        reorder.n++;
+    }
+
+    columns = tiles.cols;
+}
+
+/* evaluate the region in tiles, for a pass computing reductions the
+   expressions with need[] set, for pass 0 all, writing the maps */
+static void run_tiles(int pass, const int *need, expression **exp_arr,
+                      int num_exprs, struct reduction **top)
+{
+    int i, k;
+
+    for (current_depth = 0; current_depth < depths; current_depth++) {
+        int row0;
+
+        for (row0 = 0; row0 < rows; row0 += tiles.rows) {
+            int num = rows - row0 < tiles.rows ? rows - row0 : tiles.rows;
+            int t;
+
+            columns = region_columns;
+            load_bands(row0);
+            columns = tiles.cols;
+
+#pragma omp parallel for default(shared) schedule(dynamic, 1) private(i, k)
+            for (t = 0; t < num * tiles.num; t++) {
+                int tid = 0;
+#if defined(_OPENMP)
+                tid = omp_get_thread_num();
+#endif
+                int tile = t / num;
+                int part = (t % num) * tiles.num + tile;
+                int ncols = tile_columns(tile);
+
+                current_row[tid] = row0 + t % num;
+                current_col[tid] = tile * tiles.cols;
+                begin_row(tid);
+
+                if (pass > 0) {
+                    for (i = 0; i < num_exprs; i++)
+                        if (need[i])
+                            evaluate(exp_arr[i]);
+                    for (k = 0; k < num_reductions; k++)
+                        if (reductions[k].pass == pass)
+                            reduce_row(&reductions[k], part, ncols, tid);
+                    continue;
+                }
+
+                for (i = 0; i < num_exprs; i++) {
+                    if (top[i])
+                        reduce_row(top[i], part, ncols, tid);
+                    else
+                        evaluate(exp_arr[i]);
+                }
+                store_tile(t % num, tile, tid);
+            }
+
+            /* in the order of the cells in the region */
+            merge_parts(pass, num * tiles.num);
+
+            if (pass == 0)
+                write_band(row0, num);
+            else {
+                reorder.n += num;
+                if (reorder.verbose)
+                    G_percent(reorder.n, reorder.count, 2);
+            }
+        }
+    }
+}
+
+/****************************************************************************/
+
+/* pass over the region computing the reductions of the given pass */
+static void reduce(int pass, expression **exp_arr, int num_exprs, int block)
+{
+    int *need = G_calloc(num_exprs, sizeof(int));
+    int i, k;
+
+    for (k = 0; k < num_reductions; k++)
+        if (reductions[k].pass == pass)
+            need_bindings(reductions[k].e, need, exp_arr, num_exprs);
+
+    for (i = 0; i < num_exprs; i++)
+        if (need[i] && uses_rand(exp_arr[i]))
+            G_fatal_error(_("Variable <%s> uses rand() and cannot be used in "
+                            "the statistics of the region, which evaluate "
+                            "it again. Write it to a map first."),
+                          exp_arr[i]->data.bind.var);
+
+    G_verbose_message(_("Computing reductions, pass %d of %d..."), pass,
+                      num_passes);
+
+    if (tiles.rows)
+        run_tiles(pass, need, exp_arr, num_exprs, NULL);
+    else
+        for (current_depth = 0; current_depth < depths; current_depth++) {
+            int row;
+
+#pragma omp parallel for default(shared) schedule(dynamic, block) private(i, k)
+            for (row = 0; row < rows; row++) {
+                int tid = 0;
+#if defined(_OPENMP)
+                tid = omp_get_thread_num();
+#endif
+                current_row[tid] = row;
+                begin_row(tid);
+                for (i = 0; i < num_exprs; i++)
+                    if (need[i])
+                        evaluate(exp_arr[i]);
+                for (k = 0; k < num_reductions; k++)
+                    if (reductions[k].pass == pass)
+                        reduce_row(&reductions[k], row, columns, tid);
+            }
+
+            merge_parts(pass, rows);
+
+            reorder.n += rows;
+            if (reorder.verbose)
+                G_percent(reorder.n, reorder.count, 2);
+        }
+
+    for (k = 0; k < num_reductions; k++)
+        if (reductions[k].pass == pass) {
+            set_reduction(&reductions[k]);
+            if (G_verbose() > G_verbose_std())
+                print_reduction(stderr, &reductions[k]);
+        }
+
+    G_free(need);
+}
+
+/****************************************************************************/
+
 static void error_handler(void *p UNUSED)
 {
     expr_list *l;
@@ -372,10 +1429,10 @@ static void error_handler(void *p UNUSED)
 
 void execute(expr_list *ee)
 {
-    int verbose;
     expr_list *l;
     expression **exp_arr;
-    int count, n, i;
+    struct reduction **top;
+    int block, pass, i;
     int num_exprs = 0;
     int threads = 1;
 
@@ -396,6 +1453,10 @@ void execute(expr_list *ee)
 
         var = e->data.bind.var;
 
+        /* shared subexpression, see optimize.c */
+        if (!var)
+            continue;
+
         if (!overwrite_flag && check_output_map(var))
             G_fatal_error(_("output map <%s> exists. To overwrite, "
                             "use the --overwrite flag"),
@@ -422,6 +1483,11 @@ void execute(expr_list *ee)
 
     setup_region();
 
+    /* the buffers have the width of a tile */
+    tiles.rows = 0;
+    if (tile_rows > 0)
+        setup_tiles();
+
     /* Parse each expression and initialize the maps, buffers and variables */
 
     for (i = 0; i < num_exprs; i++) {
@@ -431,7 +1497,7 @@ void execute(expr_list *ee)
 
         initialize(e);
 
-        if (e->type != expr_type_binding)
+        if (e->type != expr_type_binding || !e->data.bind.var)
             continue;
 
         var = e->data.bind.var;
@@ -445,7 +1511,7 @@ void execute(expr_list *ee)
     threads = omp_get_max_threads();
     /* Make sure the number of threads no more that the number of rows in
      * rasters */
-    if ((threads > rows) && (threads > 1)) {
+    if ((threads > rows) && (threads > 1) && !tiles.rows) {
         threads = rows;
         omp_set_num_threads(threads);
         G_verbose_message(
@@ -455,46 +1521,62 @@ void execute(expr_list *ee)
     }
 #endif
     current_row = (int *)G_malloc(sizeof(int) * threads);
-    count = rows * depths;
-    n = 0;
+    current_col = (int *)G_calloc(threads, sizeof(int));
+    rows_begun = G_calloc(threads, sizeof(int));
+    block = 1;
+    if (tiles.rows) {
+        setup_bands(map_list, num_maps, tiles.rows);
+        setup_tile_outputs(exp_arr, num_exprs);
+        num_parts = tiles.rows * tiles.num;
+    }
+    else {
+        setup_reorder(exp_arr, num_exprs, threads, &block);
+        num_parts = rows;
+    }
+    top = setup_reductions(exp_arr, num_exprs);
+    reorder.count = rows * depths * (num_passes + 1);
+    reorder.n = 0;
+    reorder.verbose = isatty(2);
 
-    verbose = isatty(2);
-    for (current_depth = 0; current_depth < depths; current_depth++) {
-        int row;
-#pragma omp parallel for default(shared) schedule(static, 1) private(i) ordered
-        for (row = 0; row < rows; row++) {
-            if (verbose)
-                G_percent(n, count, 2);
+    for (pass = 1; pass <= num_passes; pass++)
+        reduce(pass, exp_arr, num_exprs, block);
+
+    if (tiles.rows)
+        run_tiles(0, NULL, exp_arr, num_exprs, top);
+    else
+        for (current_depth = 0; current_depth < depths; current_depth++) {
+            int row;
 
-            int tid = 0;
+            start_reorder();
+#pragma omp parallel for default(shared) schedule(dynamic, block) private(i)
+            for (row = 0; row < rows; row++) {
+                int tid = 0;
 #if defined(_OPENMP)
-            tid = omp_get_thread_num();
+                tid = omp_get_thread_num();
 #endif
-            /* calculate through expressions row by row */
-            current_row[tid] = row;
-            for (i = 0; i < num_exprs; i++) {
-                expression *e = exp_arr[i];
-                evaluate(e);
-            }
-#pragma omp ordered
-            {
+                /* calculate through expressions row by row */
+                current_row[tid] = row;
+                begin_row(tid);
                 for (i = 0; i < num_exprs; i++) {
                     expression *e = exp_arr[i];
-                    /* write out values to a file row by row */
-                    if (e->type == expr_type_binding) {
-                        put_map_row(e->data.bind.fd, e->buf[tid], e->res_type);
-                    }
+
+                    if (top[i])
+                        reduce_row(top[i], row, columns, tid);
+                    else
+                        evaluate(e);
                 }
+                /* write out values to a file row by row, in order */
+                store_row(row, tid);
             }
-#pragma omp atomic update
-            n++;
+
+            merge_parts(0, rows);
         }
-    }
 
     G_finish_workers();
+    columns = region_columns;
 
-    if (verbose)
-        G_percent(n, count, 2);
+    if (reorder.verbose)
+        G_percent(reorder.n, reorder.count, 2);
 
     close_maps();
 
@@ -504,13 +1586,17 @@ void execute(expr_list *ee)
         expression *val;
         int fd;
 
-        if (e->type != expr_type_binding)
+        if (e->type != expr_type_binding || !e->data.bind.var)
             continue;
 
         var = e->data.bind.var;
         val = e->data.bind.val;
         fd = e->data.bind.fd;
 
+        /* the value of a shared subexpression */
+        if (val->type == expr_type_variable && !val->data.var.name)
+            val = val->data.var.bind->data.bind.val;
+
         close_output_map(fd);
         e->data.bind.fd = -1;
 
@@ -528,13 +1614,38 @@ void execute(expr_list *ee)
 
     G_unset_error_routine();
 
+    for (i = 0; i < num_exprs; i++)
+        if (top[i])
+            print_reduction(stdout, top[i]);
+
     /* Free the memory and make it unreachable */
+    release_reductions(top);
+    if (tiles.rows) {
+        release_bands();
+        release_tiles();
+    }
+    else
+        release_reorder();
     G_free(current_row);
+    G_free(current_col);
+    G_free(rows_begun);
     for (i = 0; i < num_exprs; i++) {
         expression *e = exp_arr[i];
+
+        if (e->type == expr_type_binding) {
+            G_free(e->data.bind.evaluated);
+            e->data.bind.evaluated = NULL;
+        }
+        /* the buffers of variables belong to their bindings */
+        if (e->type == expr_type_binding &&
+            e->data.bind.val->type == expr_type_variable)
+            continue;
         free_buf(e);
-        if (e->type == expr_type_function)
+        if (e->type == expr_type_function) {
             free_argv(e);
+            free_kernel(e->kernel);
+            e->kernel = NULL;
+        }
         if (e->type == expr_type_map && e->data.map.idx) {
             G_free(e->data.map.idx);
             e->data.map.idx = NULL;
@@ -542,6 +1653,8 @@ void execute(expr_list *ee)
     }
     G_free(exp_arr);
     current_row = NULL;
+    current_col = NULL;
+    rows_begun = NULL;
     exp_arr = NULL;
 }
 
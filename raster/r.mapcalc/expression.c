@@ -47,6 +47,9 @@ static expression *allocate(int type, int res_type)
     e->res_type = res_type;
     e->buf = NULL;
     e->worker = NULL;
+    e->kernel = NULL;
+    e->constant = 0;
+    e->pure = 0;
     return e;
 }
 
@@ -177,6 +180,7 @@ expression *constant_int(int x)
     expression *e = allocate(expr_type_constant, CELL_TYPE);
 
     e->data.con.ival = x;
+    e->constant = 1;
     return e;
 }
 
@@ -185,6 +189,7 @@ expression *constant_float(float x)
     expression *e = allocate(expr_type_constant, FCELL_TYPE);
 
     e->data.con.fval = x;
+    e->constant = 1;
     return e;
 }
 
@@ -193,6 +198,7 @@ expression *constant_double(double x)
     expression *e = allocate(expr_type_constant, DCELL_TYPE);
 
     e->data.con.fval = x;
+    e->constant = 1;
     return e;
 }
 
@@ -210,6 +216,16 @@ expression *variable(const char *name)
     return e;
 }
 
+/* value of a binding without name, see optimize.c */
+expression *bound_value(expression *bind)
+{
+    expression *e = allocate(expr_type_variable, bind->res_type);
+
+    e->data.var.name = NULL;
+    e->data.var.bind = bind;
+    return e;
+}
+
 expression *mapname(const char *name, int mod, int row, int col, int depth)
 {
     int res_type = map_type(name, mod);
@@ -224,6 +240,7 @@ expression *mapname(const char *name, int mod, int row, int col, int depth)
     e->data.map.row = row;
     e->data.map.col = col;
     e->data.map.depth = depth;
+    e->data.map.band = NULL;
     return e;
 }
 
@@ -234,6 +251,7 @@ expression *binding(const char *var, expression *val)
     e->data.bind.var = var;
     e->data.bind.val = val;
     e->data.bind.fd = -1;
+    e->data.bind.evaluated = NULL;
     return e;
 }
 
@@ -321,8 +339,12 @@ static char *format_constant(const expression *e)
     return strdup(buff);
 }
 
-static char *format_variable(const expression *e)
+static char *format_variable(const expression *e, int prec)
 {
+    /* shared subexpressions are shown where they occur */
+    if (!e->data.var.name)
+        return format_expression_prec(e->data.var.bind->data.bind.val, prec);
+
     return strdup(e->data.var.name);
 }
 
@@ -480,7 +502,7 @@ static char *format_expression_prec(const expression *e, int prec)
     case expr_type_constant:
         return format_constant(e);
     case expr_type_variable:
-        return format_variable(e);
+        return format_variable(e, prec);
     case expr_type_map:
         return format_map(e);
     case expr_type_function:
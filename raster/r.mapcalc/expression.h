@@ -27,7 +27,8 @@ typedef struct expr_data_map {
     const char *name;
     int mod;
     int row, col, depth;
-    int *idx; /* array to store fds for multi-threads*/
+    int *idx;            /* array to store fds for multi-threads*/
+    struct band *band;   /* rows read for tiles, see tile.c */
 } expr_data_map;
 
 typedef struct expr_data_func {
@@ -45,6 +46,8 @@ typedef struct expr_data_bind {
     const char *var;
     struct expression *val;
     int fd;
+    int *evaluated; /* last row evaluated by each thread, shared
+                       subexpressions only, see optimize.c */
 } expr_data_bind;
 
 typedef struct expression {
@@ -59,6 +62,9 @@ typedef struct expression {
         expr_data_bind bind;
     } data;
     void *worker;
+    struct kernel *kernel; /* fused subtree, see kernel.c */
+    int constant;          /* same value for all cells, see optimize.c */
+    int pure;              /* may be left unevaluated, see evaluate.c */
 } expression;
 
 typedef struct expr_list {
@@ -77,6 +83,7 @@ extern expression *constant_int(int x);
 extern expression *constant_float(float x);
 extern expression *constant_double(double x);
 extern expression *variable(const char *name);
+extern expression *bound_value(expression *bind);
 extern expression *mapname(const char *name, int mod, int row, int col,
                            int depth);
 extern expression *operator(const char *name, const char *oper, int prec,
@@ -15,3 +15,11 @@ extern func_t f_nsres;
 extern func_t f_tbres;
 
 extern func_t f_area;
+
+extern func_t f_gsum;
+extern func_t f_gcount;
+extern func_t f_gmin;
+extern func_t f_gmax;
+extern func_t f_gmean;
+extern func_t f_gvar;
+extern func_t f_gstddev;
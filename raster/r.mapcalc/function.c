@@ -23,6 +23,14 @@ func_desc local_func_descs[] = {{"col", c_int0, f_col},
 
                                 {"area", c_double0, f_area},
 
+                                {"gsum", c_double1, f_gsum},
+                                {"gcount", c_double1, f_gcount},
+                                {"gmin", c_double1, f_gmin},
+                                {"gmax", c_double1, f_gmax},
+                                {"gmean", c_double1, f_gmean},
+                                {"gvar", c_double1, f_gvar},
+                                {"gstddev", c_double1, f_gstddev},
+
                                 {NULL, NULL, NULL}};
 
 void print_function_names(void)
@@ -2,12 +2,16 @@
 #define __GLOBALS_H_
 
 extern int overwrite_flag;
+extern int bytecode_flag;
 extern long seed_value;
 extern long seeded;
 extern int region_approach;
+extern int tile_rows, tile_cols;
 
 extern int current_depth;
 extern int *current_row;
+extern int *current_col;
 extern int depths, rows;
+extern int region_columns;
 
 #endif /* __GLOBALS_H_ */
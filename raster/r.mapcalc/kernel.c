@@ -0,0 +1,1270 @@
+#if defined(_OPENMP)
+#include <omp.h>
+#endif
+
+#include <math.h>
+#include <string.h>
+
+#include <grass/gis.h>
+#include <grass/raster.h>
+#include <grass/calc.h>
+#include <grass/glocale.h>
+
+#include "mapcalc.h"
+
+/****************************************************************************/
+
+/* Fused kernels: a subtree of element-wise arithmetic is evaluated in one
+ * pass over the row, chunk by chunk, with the intermediate values held in
+ * small chunk buffers instead of full-width rows. The leaves of the
+ * subtree (maps, variables and other functions) are evaluated as usual
+ * into their row buffers first, constants are expanded once.
+ *
+ * Floating-point nulls are NaN and propagate through the arithmetic,
+ * integer nulls are checked per operation, as in lib/calc.
+ *
+ * With the -b flag, kernels are bytecode for whole expressions: the
+ * comparison and logical operators, if(), isnull(), abs(), min(), max()
+ * and int() are compiled too, so that only maps, variables and the other
+ * functions are leaves. The leaves which may be left unevaluated, see
+ * evaluate.c, are evaluated for the row when a chunk first needs them.
+ * The operands of if() which no cell of a chunk selects are skipped, as
+ * are the other operands of an operator whose first operand is null in
+ * the whole chunk. The chunk is shorter for kernels with many
+ * intermediate values, so that these stay in the CPU cache.
+ */
+
+#define KERNEL_CHUNK     256       /* cells */
+#define KERNEL_MIN_CHUNK 16        /* cells, of bytecode */
+#define KERNEL_CACHE     (32 << 10) /* bytes of intermediate values */
+#define KERNEL_STACK     16        /* operands of fused arithmetic */
+
+enum kernel_code {
+    K_LOAD,  /* row buffer of a leaf */
+    K_CONST, /* constant */
+    K_ADD,
+    K_SUB,
+    K_MUL,
+    K_DIV,
+    K_NEG,
+    K_CONV, /* conversion to float or double, or int for bytecode */
+    /* bytecode only */
+    K_GT,
+    K_GE,
+    K_LT,
+    K_LE,
+    K_EQ,
+    K_NE,
+    K_AND,
+    K_OR,
+    K_AND2,
+    K_OR2,
+    K_NOT,
+    K_ISNULL,
+    K_ABS,
+    K_MIN,
+    K_MAX,
+    K_IF,
+    K_SKIP, /* skip an operand of if() which no cell selects */
+    K_NULL  /* skip the other operands if the first is null */
+};
+
+struct kernel_op {
+    int code;
+    int type;         /* result type */
+    int arg_type;     /* operand type, of the first operand */
+    int argc;         /* operands taken from the stack, of if() for K_SKIP */
+    int arg;          /* K_LOAD: leaf, K_SKIP: operand of if() */
+    int skip;         /* K_SKIP, K_NULL: operations skipped */
+    expression *leaf; /* K_LOAD, K_CONST */
+    void *con;        /* K_CONST, one chunk of the constant */
+};
+
+/* bytecode operations with their functions */
+static const struct {
+    func_t *func;
+    int code;
+} bytecode_funcs[] = {{f_gt, K_GT},       {f_ge, K_GE},   {f_lt, K_LT},
+                      {f_le, K_LE},       {f_eq, K_EQ},   {f_ne, K_NE},
+                      {f_and, K_AND},     {f_or, K_OR},   {f_and2, K_AND2},
+                      {f_or2, K_OR2},     {f_not, K_NOT}, {f_isnull, K_ISNULL},
+                      {f_abs, K_ABS},     {f_min, K_MIN}, {f_max, K_MAX},
+                      {f_if, K_IF},       {NULL, 0}};
+
+/****************************************************************************/
+
+/* whether the operands of e from i on have the type t */
+static int args_of_type(const expression *e, int i, int t)
+{
+    for (; i <= e->data.func.argc; i++)
+        if (e->data.func.argt[i] != t)
+            return 0;
+
+    return 1;
+}
+
+static int bytecode_op(const expression *e)
+{
+    func_t *f = e->data.func.func;
+    int argc = e->data.func.argc;
+    const int *argt = e->data.func.argt;
+    int code = -1;
+    int i;
+
+    for (i = 0; bytecode_funcs[i].func; i++)
+        if (bytecode_funcs[i].func == f)
+            code = bytecode_funcs[i].code;
+
+    /* the types lib/calc accepts */
+    switch (code) {
+    case K_GT:
+    case K_GE:
+    case K_LT:
+    case K_LE:
+    case K_EQ:
+    case K_NE:
+        return argc == 2 && argt[0] == CELL_TYPE && argt[2] == argt[1] ? code
+                                                                       : -1;
+    case K_AND:
+    case K_OR:
+    case K_AND2:
+    case K_OR2:
+        return argc >= 1 && args_of_type(e, 0, CELL_TYPE) ? code : -1;
+    case K_NOT:
+        return argc == 1 && args_of_type(e, 0, CELL_TYPE) ? code : -1;
+    case K_ISNULL:
+        return argc == 1 && argt[0] == CELL_TYPE ? code : -1;
+    case K_ABS:
+        return argc == 1 && argt[1] == argt[0] ? code : -1;
+    case K_MIN:
+    case K_MAX:
+        return argc >= 1 && args_of_type(e, 1, argt[0]) ? code : -1;
+    case K_IF:
+        return argc >= 1 && argc <= 4 && argt[1] == DCELL_TYPE &&
+                       args_of_type(e, 2, argt[0]) &&
+                       (argc > 1 || argt[0] == CELL_TYPE)
+                   ? code
+                   : -1;
+    default:
+        return -1;
+    }
+}
+
+static int fused_op(const expression *e, int bytecode)
+{
+    func_t *f;
+    int i;
+
+    /* constant subtrees are evaluated once */
+    if (e->type != expr_type_function || e->constant)
+        return -1;
+
+    f = e->data.func.func;
+
+    if (f == f_double || f == f_float || (bytecode && f == f_int))
+        return e->data.func.argc == 1 && e->data.func.argt[0] == e->res_type
+                   ? K_CONV
+                   : -1;
+
+    if (bytecode) {
+        int code = bytecode_op(e);
+
+        if (code >= 0)
+            return code;
+    }
+
+    /* operands of the result type only, as lib/calc requires */
+    for (i = 0; i <= e->data.func.argc; i++)
+        if (e->data.func.argt[i] != e->res_type)
+            return -1;
+
+    if (f == f_add && e->data.func.argc >= 1)
+        return K_ADD;
+    if (f == f_mul && e->data.func.argc >= 1)
+        return K_MUL;
+    if (f == f_sub && e->data.func.argc == 2)
+        return K_SUB;
+    if (f == f_div && e->data.func.argc == 2)
+        return K_DIV;
+    if (f == f_neg && e->data.func.argc == 1)
+        return K_NEG;
+
+    return -1;
+}
+
+/* number of connected fusable nodes from e down */
+static int fused_size(const expression *e, int bytecode)
+{
+    int i, n;
+
+    if (fused_op(e, bytecode) < 0)
+        return 0;
+
+    n = 1;
+    for (i = 1; i <= e->data.func.argc; i++)
+        n += fused_size(e->data.func.args[i], bytecode);
+
+    return n;
+}
+
+/* operations whose result is null where any operand is null */
+static int is_strict_op(int code)
+{
+    switch (code) {
+    case K_ADD:
+    case K_SUB:
+    case K_MUL:
+    case K_DIV:
+    case K_GT:
+    case K_GE:
+    case K_LT:
+    case K_LE:
+    case K_EQ:
+    case K_NE:
+    case K_AND:
+    case K_OR:
+    case K_MIN:
+    case K_MAX:
+        return 1;
+    default:
+        return 0;
+    }
+}
+
+/* whether operands i to n of e need more than expanding constants */
+static int computed(const expression *e, int i, int n)
+{
+    for (; i <= n; i++)
+        if (e->data.func.args[i]->type != expr_type_constant)
+            return 1;
+
+    return 0;
+}
+
+static struct kernel_op *new_op(kernel *k, int code, int type)
+{
+    struct kernel_op *op;
+
+    if (k->num_ops >= k->max_ops) {
+        k->max_ops += 16;
+        k->ops = G_realloc(k->ops, k->max_ops * sizeof(struct kernel_op));
+    }
+
+    op = &k->ops[k->num_ops++];
+    op->code = code;
+    op->type = type;
+    op->arg_type = type;
+    op->argc = 0;
+    op->arg = 0;
+    op->skip = 0;
+    op->leaf = NULL;
+    op->con = NULL;
+
+    return op;
+}
+
+static void push(kernel *k, int n)
+{
+    k->sp += n;
+    if (k->sp > k->depth)
+        k->depth = k->sp;
+}
+
+static void compile(kernel *k, expression *e)
+{
+    struct kernel_op *op;
+    int code = fused_op(e, k->bytecode);
+    int lazy = k->bytecode && e->data.func.argc > 1;
+    int null_op = -1;
+    int i;
+
+    if (code < 0 && e->type == expr_type_constant) {
+        op = new_op(k, K_CONST, e->res_type);
+        op->leaf = e;
+        push(k, 1);
+        return;
+    }
+
+    if (code < 0) {
+        if (k->num_leaves >= k->max_leaves) {
+            k->max_leaves += 8;
+            k->leaves =
+                G_realloc(k->leaves, k->max_leaves * sizeof(expression *));
+        }
+        op = new_op(k, K_LOAD, e->res_type);
+        op->leaf = e;
+        op->arg = k->num_leaves;
+        k->leaves[k->num_leaves++] = e;
+        push(k, 1);
+        return;
+    }
+
+    for (i = 1; i <= e->data.func.argc; i++) {
+        expression *arg = e->data.func.args[i];
+        int skip_op = -1;
+
+        if (lazy && code == K_IF && i > 1 &&
+            arg->type != expr_type_constant) {
+            skip_op = k->num_ops;
+            op = new_op(k, K_SKIP, e->res_type);
+            op->argc = e->data.func.argc;
+            op->arg = i;
+        }
+
+        compile(k, arg);
+
+        if (skip_op >= 0)
+            k->ops[skip_op].skip = k->num_ops - skip_op - 1;
+
+        if (lazy && i == 1 && is_strict_op(code) &&
+            computed(e, 2, e->data.func.argc)) {
+            null_op = k->num_ops;
+            op = new_op(k, K_NULL, e->res_type);
+            op->arg_type = e->data.func.argt[1];
+        }
+    }
+
+    op = new_op(k, code, e->res_type);
+    op->arg_type = e->data.func.argt[1];
+    op->argc = e->data.func.argc;
+    k->sp -= op->argc;
+    push(k, 1);
+
+    /* the operation itself is skipped too */
+    if (null_op >= 0)
+        k->ops[null_op].skip = k->num_ops - null_op - 1;
+}
+
+/* cells of a chunk, so that the intermediate values stay in the cache */
+static int chunk_size(const kernel *k)
+{
+    int n = KERNEL_CACHE / (k->depth * (int)sizeof(DCELL));
+
+    n -= n % KERNEL_MIN_CHUNK;
+    if (n > KERNEL_CHUNK)
+        n = KERNEL_CHUNK;
+    if (n < KERNEL_MIN_CHUNK)
+        n = KERNEL_MIN_CHUNK;
+
+    return n;
+}
+
+/* expand the constants to a chunk */
+static void *expand(const expression *e, int n)
+{
+    void *con = G_malloc((size_t)n * Rast_cell_size(e->res_type));
+    CELL *c = con;
+    FCELL *f = con;
+    DCELL *d = con;
+    int i;
+
+    for (i = 0; i < n; i++)
+        switch (e->res_type) {
+        case CELL_TYPE:
+            c[i] = e->data.con.ival;
+            break;
+        case FCELL_TYPE:
+            f[i] = e->data.con.fval;
+            break;
+        default:
+            d[i] = e->data.con.fval;
+            break;
+        }
+
+    return con;
+}
+
+/*!
+   \brief Build a fused kernel for an expression
+
+   \param e function expression
+   \param bytecode non-zero to compile the whole expression, see above
+
+   \return kernel, NULL if e is not worth fusing
+ */
+kernel *build_kernel(expression *e, int bytecode)
+{
+    kernel *k;
+    size_t size;
+    int threads = 1;
+    int i;
+
+#if defined(_OPENMP)
+    threads = omp_get_max_threads();
+#endif
+
+    /* a single operation gains nothing */
+    if (fused_size(e, bytecode) < 2)
+        return NULL;
+
+    k = G_calloc(1, sizeof(kernel));
+    k->bytecode = bytecode;
+    compile(k, e);
+
+    if (!bytecode && k->depth > KERNEL_STACK) {
+        free_kernel(k);
+        return NULL;
+    }
+
+    k->chunk = chunk_size(k);
+    for (i = 0; i < k->num_ops; i++)
+        if (k->ops[i].code == K_CONST)
+            k->ops[i].con = expand(k->ops[i].leaf, k->chunk);
+
+    /* the chunks of the stack, the stack and the leaves evaluated */
+    size = (size_t)k->depth * k->chunk * sizeof(DCELL) +
+           k->depth * sizeof(void *) + k->num_leaves;
+    k->scratch = G_malloc(threads * sizeof(void *));
+    for (i = 0; i < threads; i++)
+        k->scratch[i] = G_malloc(size);
+    k->threads = threads;
+
+    G_debug(3, "Fused kernel of %d operations, %d leaves, %d cells a chunk",
+            k->num_ops, k->num_leaves, k->chunk);
+
+    return k;
+}
+
+void free_kernel(kernel *k)
+{
+    int i;
+
+    if (!k)
+        return;
+
+    for (i = 0; i < k->num_ops; i++)
+        G_free(k->ops[i].con);
+    for (i = 0; i < k->threads; i++)
+        G_free(k->scratch[i]);
+    G_free(k->scratch);
+    G_free(k->ops);
+    G_free(k->leaves);
+    G_free(k);
+}
+
+/****************************************************************************/
+
+static void run_add_mul(const struct kernel_op *op, const void **arg,
+                        void *res, int n)
+{
+    int mul = op->code == K_MUL;
+    int i, j;
+
+    switch (op->type) {
+    case CELL_TYPE: {
+        const CELL **a = (const CELL **)arg;
+        CELL *r = res;
+
+        for (i = 0; i < n; i++) {
+            CELL v = mul;
+
+            for (j = 0; j < op->argc; j++) {
+                if (IS_NULL_C(&a[j][i])) {
+                    SET_NULL_C(&v);
+                    break;
+                }
+                if (mul)
+                    v *= a[j][i];
+                else
+                    v += a[j][i];
+            }
+            r[i] = v;
+        }
+        break;
+    }
+    case FCELL_TYPE: {
+        const FCELL **a = (const FCELL **)arg;
+        FCELL *r = res;
+
+        for (i = 0; i < n; i++) {
+            FCELL v = mul;
+
+            if (mul)
+                for (j = 0; j < op->argc; j++)
+                    v *= a[j][i];
+            else
+                for (j = 0; j < op->argc; j++)
+                    v += a[j][i];
+            r[i] = v;
+        }
+        break;
+    }
+    default: {
+        const DCELL **a = (const DCELL **)arg;
+        DCELL *r = res;
+
+        for (i = 0; i < n; i++) {
+            DCELL v = mul;
+
+            if (mul)
+                for (j = 0; j < op->argc; j++)
+                    v *= a[j][i];
+            else
+                for (j = 0; j < op->argc; j++)
+                    v += a[j][i];
+            r[i] = v;
+        }
+        break;
+    }
+    }
+}
+
+static void run_sub(const struct kernel_op *op, const void **arg, void *res,
+                    int n)
+{
+    int i;
+
+    switch (op->type) {
+    case CELL_TYPE: {
+        const CELL *a = arg[0], *b = arg[1];
+        CELL *r = res;
+
+        for (i = 0; i < n; i++)
+            if (IS_NULL_C(&a[i]) || IS_NULL_C(&b[i]))
+                SET_NULL_C(&r[i]);
+            else
+                r[i] = a[i] - b[i];
+        break;
+    }
+    case FCELL_TYPE: {
+        const FCELL *a = arg[0], *b = arg[1];
+        FCELL *r = res;
+
+        for (i = 0; i < n; i++)
+            r[i] = a[i] - b[i];
+        break;
+    }
+    default: {
+        const DCELL *a = arg[0], *b = arg[1];
+        DCELL *r = res;
+
+        for (i = 0; i < n; i++)
+            r[i] = a[i] - b[i];
+        break;
+    }
+    }
+}
+
+static void run_div(const struct kernel_op *op, const void **arg, void *res,
+                    int n)
+{
+    int i;
+
+    switch (op->type) {
+    case CELL_TYPE: {
+        const CELL *a = arg[0], *b = arg[1];
+        CELL *r = res;
+
+        for (i = 0; i < n; i++)
+            if (IS_NULL_C(&a[i]) || IS_NULL_C(&b[i]) || b[i] == 0)
+                SET_NULL_C(&r[i]);
+            else
+                r[i] = a[i] / b[i];
+        break;
+    }
+    case FCELL_TYPE: {
+        const FCELL *a = arg[0], *b = arg[1];
+        FCELL *r = res;
+
+        for (i = 0; i < n; i++) {
+            FCELL v;
+
+            if (b[i] == 0.0f)
+                SET_NULL_F(&v);
+            else {
+                floating_point_exception = 0;
+                v = a[i] / b[i];
+                if (floating_point_exception)
+                    SET_NULL_F(&v);
+            }
+            r[i] = v;
+        }
+        break;
+    }
+    default: {
+        const DCELL *a = arg[0], *b = arg[1];
+        DCELL *r = res;
+
+        for (i = 0; i < n; i++) {
+            DCELL v;
+
+            if (b[i] == 0.0)
+                SET_NULL_D(&v);
+            else {
+                floating_point_exception = 0;
+                v = a[i] / b[i];
+                if (floating_point_exception)
+                    SET_NULL_D(&v);
+            }
+            r[i] = v;
+        }
+        break;
+    }
+    }
+}
+
+static void run_neg(const struct kernel_op *op, const void **arg, void *res,
+                    int n)
+{
+    int i;
+
+    switch (op->type) {
+    case CELL_TYPE: {
+        const CELL *a = arg[0];
+        CELL *r = res;
+
+        for (i = 0; i < n; i++)
+            if (IS_NULL_C(&a[i]))
+                SET_NULL_C(&r[i]);
+            else
+                r[i] = -a[i];
+        break;
+    }
+    case FCELL_TYPE: {
+        const FCELL *a = arg[0];
+        FCELL *r = res;
+
+        for (i = 0; i < n; i++)
+            r[i] = -a[i];
+        break;
+    }
+    default: {
+        const DCELL *a = arg[0];
+        DCELL *r = res;
+
+        for (i = 0; i < n; i++)
+            r[i] = -a[i];
+        break;
+    }
+    }
+}
+
+/* the operand may be in the result chunk: widening conversions run
+   backwards so that no operand is overwritten before it is read */
+static void run_conv(const struct kernel_op *op, const void **arg, void *res,
+                     int n)
+{
+    CELL *rc = res;
+    FCELL *rf = res;
+    DCELL *rd = res;
+    int i;
+
+    switch (op->arg_type) {
+    case CELL_TYPE: {
+        const CELL *a = arg[0];
+
+        if (op->type == CELL_TYPE)
+            memmove(rc, a, n * sizeof(CELL));
+        else if (op->type == FCELL_TYPE) {
+            for (i = 0; i < n; i++)
+                if (IS_NULL_C(&a[i]))
+                    SET_NULL_F(&rf[i]);
+                else
+                    rf[i] = (FCELL)a[i];
+        }
+        else {
+            for (i = n - 1; i >= 0; i--)
+                if (IS_NULL_C(&a[i]))
+                    SET_NULL_D(&rd[i]);
+                else
+                    rd[i] = (DCELL)a[i];
+        }
+        break;
+    }
+    case FCELL_TYPE: {
+        const FCELL *a = arg[0];
+
+        if (op->type == CELL_TYPE) {
+            for (i = 0; i < n; i++)
+                if (IS_NULL_F(&a[i]))
+                    SET_NULL_C(&rc[i]);
+                else
+                    rc[i] = (CELL)a[i];
+        }
+        else if (op->type == FCELL_TYPE)
+            memmove(rf, a, n * sizeof(FCELL));
+        else
+            for (i = n - 1; i >= 0; i--)
+                rd[i] = (DCELL)a[i];
+        break;
+    }
+    default: {
+        const DCELL *a = arg[0];
+
+        if (op->type == CELL_TYPE) {
+            for (i = 0; i < n; i++)
+                if (IS_NULL_D(&a[i]))
+                    SET_NULL_C(&rc[i]);
+                else
+                    rc[i] = (CELL)a[i];
+        }
+        else if (op->type == FCELL_TYPE)
+            for (i = 0; i < n; i++)
+                rf[i] = (FCELL)a[i];
+        else
+            memmove(rd, a, n * sizeof(DCELL));
+        break;
+    }
+    }
+}
+
+/****************************************************************************/
+
+/* The operations of bytecode only. Their result, of at most the size of
+ * the first operand, may be in the chunk of the first operand, which is
+ * read before the result is written. */
+
+#define CMP(T, IS_NULL, OP)                       \
+    {                                             \
+        const T *a = arg[0], *b = arg[1];         \
+                                                  \
+        for (i = 0; i < n; i++)                   \
+            if (IS_NULL(&a[i]) || IS_NULL(&b[i])) \
+                SET_NULL_C(&r[i]);                \
+            else                                  \
+                r[i] = a[i] OP b[i];              \
+    }
+
+#define CMP_TYPE(T, IS_NULL)   \
+    switch (op->code) {        \
+    case K_GT:                 \
+        CMP(T, IS_NULL, >);    \
+        break;                 \
+    case K_GE:                 \
+        CMP(T, IS_NULL, >=);   \
+        break;                 \
+    case K_LT:                 \
+        CMP(T, IS_NULL, <);    \
+        break;                 \
+    case K_LE:                 \
+        CMP(T, IS_NULL, <=);   \
+        break;                 \
+    case K_EQ:                 \
+        CMP(T, IS_NULL, ==);   \
+        break;                 \
+    default:                   \
+        CMP(T, IS_NULL, !=);   \
+        break;                 \
+    }
+
+static void run_cmp(const struct kernel_op *op, const void **arg, void *res,
+                    int n)
+{
+    CELL *r = res;
+    int i;
+
+    switch (op->arg_type) {
+    case CELL_TYPE:
+        CMP_TYPE(CELL, IS_NULL_C);
+        break;
+    case FCELL_TYPE:
+        CMP_TYPE(FCELL, IS_NULL_F);
+        break;
+    default:
+        CMP_TYPE(DCELL, IS_NULL_D);
+        break;
+    }
+}
+
+#undef CMP_TYPE
+#undef CMP
+
+static void run_logic(const struct kernel_op *op, const void **arg, void *res,
+                      int n)
+{
+    const CELL **a = (const CELL **)arg;
+    CELL *r = res;
+    int i, j;
+
+    switch (op->code) {
+    case K_AND:
+        for (i = 0; i < n; i++) {
+            CELL v = 1;
+
+            for (j = 0; j < op->argc; j++) {
+                if (IS_NULL_C(&a[j][i])) {
+                    SET_NULL_C(&v);
+                    break;
+                }
+                if (!a[j][i])
+                    v = 0;
+            }
+            r[i] = v;
+        }
+        break;
+    case K_OR:
+        for (i = 0; i < n; i++) {
+            CELL v = 0;
+
+            for (j = 0; j < op->argc; j++) {
+                if (IS_NULL_C(&a[j][i])) {
+                    SET_NULL_C(&v);
+                    break;
+                }
+                if (a[j][i])
+                    v = 1;
+            }
+            r[i] = v;
+        }
+        break;
+    case K_AND2:
+        for (i = 0; i < n; i++) {
+            CELL v = 1;
+
+            for (j = 0; j < op->argc; j++) {
+                if (!IS_NULL_C(&a[j][i]) && !a[j][i]) {
+                    v = 0;
+                    break;
+                }
+                if (IS_NULL_C(&a[j][i]))
+                    SET_NULL_C(&v);
+            }
+            r[i] = v;
+        }
+        break;
+    case K_OR2:
+        for (i = 0; i < n; i++) {
+            CELL v = 0;
+
+            for (j = 0; j < op->argc; j++) {
+                if (!IS_NULL_C(&a[j][i]) && a[j][i]) {
+                    v = 1;
+                    break;
+                }
+                if (IS_NULL_C(&a[j][i]))
+                    SET_NULL_C(&v);
+            }
+            r[i] = v;
+        }
+        break;
+    default: /* K_NOT */
+        for (i = 0; i < n; i++)
+            if (IS_NULL_C(&a[0][i]))
+                SET_NULL_C(&r[i]);
+            else
+                r[i] = !a[0][i];
+        break;
+    }
+}
+
+static void run_isnull(const struct kernel_op *op, const void **arg,
+                       void *res, int n)
+{
+    CELL *r = res;
+    int i;
+
+    switch (op->arg_type) {
+    case CELL_TYPE: {
+        const CELL *a = arg[0];
+
+        for (i = 0; i < n; i++)
+            r[i] = IS_NULL_C(&a[i]) ? 1 : 0;
+        break;
+    }
+    case FCELL_TYPE: {
+        const FCELL *a = arg[0];
+
+        for (i = 0; i < n; i++)
+            r[i] = IS_NULL_F(&a[i]) ? 1 : 0;
+        break;
+    }
+    default: {
+        const DCELL *a = arg[0];
+
+        for (i = 0; i < n; i++)
+            r[i] = IS_NULL_D(&a[i]) ? 1 : 0;
+        break;
+    }
+    }
+}
+
+static void run_abs(const struct kernel_op *op, const void **arg, void *res,
+                    int n)
+{
+    int i;
+
+    switch (op->type) {
+    case CELL_TYPE: {
+        const CELL *a = arg[0];
+        CELL *r = res;
+
+        for (i = 0; i < n; i++)
+            if (IS_NULL_C(&a[i]))
+                SET_NULL_C(&r[i]);
+            else
+                r[i] = a[i] < 0 ? -a[i] : a[i];
+        break;
+    }
+    case FCELL_TYPE: {
+        const FCELL *a = arg[0];
+        FCELL *r = res;
+
+        for (i = 0; i < n; i++)
+            if (IS_NULL_F(&a[i]))
+                SET_NULL_F(&r[i]);
+            else
+                r[i] = (FCELL)fabs(a[i]);
+        break;
+    }
+    default: {
+        const DCELL *a = arg[0];
+        DCELL *r = res;
+
+        for (i = 0; i < n; i++)
+            if (IS_NULL_D(&a[i]))
+                SET_NULL_D(&r[i]);
+            else
+                r[i] = fabs(a[i]);
+        break;
+    }
+    }
+}
+
+#define MIN_MAX(T, IS_NULL, SET_NULL)                                   \
+    {                                                                   \
+        const T **a = (const T **)arg;                                  \
+        T *r = res;                                                     \
+                                                                        \
+        for (i = 0; i < n; i++) {                                       \
+            int nul = 0;                                                \
+            T v = 0;                                                    \
+                                                                        \
+            for (j = 0; j < op->argc; j++)                              \
+                if (IS_NULL(&a[j][i]))                                  \
+                    nul = 1;                                            \
+                else if (j == 0 || (max ? v < a[j][i] : v > a[j][i]))   \
+                    v = a[j][i];                                        \
+            if (nul)                                                    \
+                SET_NULL(&r[i]);                                        \
+            else                                                        \
+                r[i] = v;                                               \
+        }                                                               \
+    }
+
+static void run_min_max(const struct kernel_op *op, const void **arg,
+                        void *res, int n)
+{
+    int max = op->code == K_MAX;
+    int i, j;
+
+    switch (op->type) {
+    case CELL_TYPE:
+        MIN_MAX(CELL, IS_NULL_C, SET_NULL_C);
+        break;
+    case FCELL_TYPE:
+        MIN_MAX(FCELL, IS_NULL_F, SET_NULL_F);
+        break;
+    default:
+        MIN_MAX(DCELL, IS_NULL_D, SET_NULL_D);
+        break;
+    }
+}
+
+#undef MIN_MAX
+
+/* operand of if() selected by c: 1 to 3, 0 for the result 0, -1 for
+   null, see lib/calc/xif.c */
+static int select_arg(const DCELL *c, int argc)
+{
+    if (IS_NULL_D(c))
+        return -1;
+    if (argc == 4)
+        return *c > 0.0 ? 1 : *c == 0.0 ? 2 : 3;
+    if (*c != 0.0)
+        return 1;
+
+    return argc == 3 ? 2 : 0;
+}
+
+/* whether a cell of the condition selects operand arg of if() */
+static int selects(const DCELL *c, int n, int argc, int arg)
+{
+    int i;
+
+    for (i = 0; i < n; i++)
+        if (select_arg(&c[i], argc) == arg - 1)
+            return 1;
+
+    return 0;
+}
+
+static void run_if(const struct kernel_op *op, const void **arg, void *res,
+                   int n)
+{
+    const DCELL *c = arg[0];
+    int i;
+
+    /* the common if(c, x, y) without a branch per cell */
+    if (op->argc == 3 && op->type == DCELL_TYPE) {
+        const DCELL *x = arg[1], *y = arg[2];
+        DCELL *r = res;
+
+        for (i = 0; i < n; i++) {
+            DCELL z = c[i];
+
+            r[i] = z != z ? z : z != 0.0 ? x[i] : y[i];
+        }
+        return;
+    }
+    if (op->argc == 3 && op->type == CELL_TYPE) {
+        const CELL *x = arg[1], *y = arg[2];
+        CELL *r = res;
+
+        for (i = 0; i < n; i++) {
+            DCELL z = c[i];
+            CELL v = z != 0.0 ? x[i] : y[i];
+
+            if (z != z)
+                SET_NULL_C(&v);
+            r[i] = v;
+        }
+        return;
+    }
+
+    switch (op->type) {
+    case CELL_TYPE: {
+        const CELL **a = (const CELL **)arg;
+        CELL *r = res;
+
+        for (i = 0; i < n; i++) {
+            int j = select_arg(&c[i], op->argc);
+
+            if (j < 0)
+                SET_NULL_C(&r[i]);
+            else if (j == 0)
+                r[i] = 0;
+            else if (op->argc == 1)
+                r[i] = 1;
+            else
+                r[i] = a[j][i];
+        }
+        break;
+    }
+    case FCELL_TYPE: {
+        const FCELL **a = (const FCELL **)arg;
+        FCELL *r = res;
+
+        for (i = 0; i < n; i++) {
+            int j = select_arg(&c[i], op->argc);
+
+            if (j < 0)
+                SET_NULL_F(&r[i]);
+            else if (j == 0)
+                r[i] = 0.0f;
+            else
+                r[i] = a[j][i];
+        }
+        break;
+    }
+    default: {
+        const DCELL **a = (const DCELL **)arg;
+        DCELL *r = res;
+
+        for (i = 0; i < n; i++) {
+            int j = select_arg(&c[i], op->argc);
+
+            if (j < 0)
+                SET_NULL_D(&r[i]);
+            else if (j == 0)
+                r[i] = 0.0;
+            else
+                r[i] = a[j][i];
+        }
+        break;
+    }
+    }
+}
+
+static int all_null(int type, const void *buf, int n)
+{
+    const CELL *c = buf;
+    const FCELL *f = buf;
+    const DCELL *d = buf;
+    int i;
+
+    for (i = 0; i < n; i++)
+        switch (type) {
+        case CELL_TYPE:
+            if (!IS_NULL_C(&c[i]))
+                return 0;
+            break;
+        case FCELL_TYPE:
+            if (!IS_NULL_F(&f[i]))
+                return 0;
+            break;
+        default:
+            if (!IS_NULL_D(&d[i]))
+                return 0;
+            break;
+        }
+
+    return 1;
+}
+
+static void run_op(const struct kernel_op *op, const void **arg, void *res,
+                   int n)
+{
+    switch (op->code) {
+    case K_ADD:
+    case K_MUL:
+        run_add_mul(op, arg, res, n);
+        break;
+    case K_SUB:
+        run_sub(op, arg, res, n);
+        break;
+    case K_DIV:
+        run_div(op, arg, res, n);
+        break;
+    case K_NEG:
+        run_neg(op, arg, res, n);
+        break;
+    case K_CONV:
+        run_conv(op, arg, res, n);
+        break;
+    case K_GT:
+    case K_GE:
+    case K_LT:
+    case K_LE:
+    case K_EQ:
+    case K_NE:
+        run_cmp(op, arg, res, n);
+        break;
+    case K_AND:
+    case K_OR:
+    case K_AND2:
+    case K_OR2:
+    case K_NOT:
+        run_logic(op, arg, res, n);
+        break;
+    case K_ISNULL:
+        run_isnull(op, arg, res, n);
+        break;
+    case K_ABS:
+        run_abs(op, arg, res, n);
+        break;
+    case K_MIN:
+    case K_MAX:
+        run_min_max(op, arg, res, n);
+        break;
+    case K_IF:
+        run_if(op, arg, res, n);
+        break;
+    }
+}
+
+/****************************************************************************/
+
+/* store a chunk of the result, with canonical nulls */
+static void store(int type, const void *src, void *dst, int n)
+{
+    int i;
+
+    switch (type) {
+    case CELL_TYPE:
+        memcpy(dst, src, n * sizeof(CELL));
+        break;
+    case FCELL_TYPE: {
+        const FCELL *s = src;
+        FCELL *d = dst;
+
+        for (i = 0; i < n; i++)
+            if (IS_NULL_F(&s[i]))
+                SET_NULL_F(&d[i]);
+            else
+                d[i] = s[i];
+        break;
+    }
+    default: {
+        const DCELL *s = src;
+        DCELL *d = dst;
+
+        for (i = 0; i < n; i++)
+            if (IS_NULL_D(&s[i]))
+                SET_NULL_D(&d[i]);
+            else
+                d[i] = s[i];
+        break;
+    }
+    }
+}
+
+/*!
+   \brief Run a fused kernel over the current row
+
+   Without evaluate, the leaves of the kernel must have been evaluated.
+
+   \param k kernel
+   \param res result row buffer
+   \param tid thread number, selects the row buffers of the leaves
+   \param evaluate function evaluating a leaf, or NULL
+ */
+void run_kernel(const kernel *k, void *res, int tid,
+                void (*evaluate)(expression *))
+{
+    size_t chunk_bytes = (size_t)k->chunk * sizeof(DCELL);
+    char *chunks = k->scratch[tid];
+    const void **stack = (const void **)(chunks + k->depth * chunk_bytes);
+    char *done = (char *)(stack + k->depth);
+    int type = k->ops[k->num_ops - 1].type;
+    int c0, i;
+
+    /* the leaves which must be evaluated are, in order */
+    for (i = 0; i < k->num_leaves; i++) {
+        expression *leaf = k->leaves[i];
+
+        done[i] = !evaluate || !leaf->pure;
+        if (evaluate && !leaf->pure)
+            evaluate(leaf);
+    }
+
+    for (c0 = 0; c0 < columns; c0 += k->chunk) {
+        int n = columns - c0 < k->chunk ? columns - c0 : k->chunk;
+        int sp = 0;
+
+        for (i = 0; i < k->num_ops; i++) {
+            const struct kernel_op *op = &k->ops[i];
+            void *s;
+
+            switch (op->code) {
+            case K_LOAD:
+                if (!done[op->arg]) {
+                    evaluate(op->leaf);
+                    done[op->arg] = 1;
+                }
+                stack[sp++] =
+                    (const char *)op->leaf->buf[tid] +
+                    (size_t)c0 * Rast_cell_size(op->type);
+                continue;
+            case K_CONST:
+                stack[sp++] = op->con;
+                continue;
+            case K_SKIP:
+                /* the operand is not read, any chunk will do */
+                if (!selects(stack[sp - op->arg + 1], n, op->argc, op->arg)) {
+                    stack[sp] = chunks + sp * chunk_bytes;
+                    sp++;
+                    i += op->skip;
+                }
+                continue;
+            case K_NULL:
+                if (all_null(op->arg_type, stack[sp - 1], n)) {
+                    s = chunks + (sp - 1) * chunk_bytes;
+                    Rast_set_null_value(s, n, op->type);
+                    stack[sp - 1] = s;
+                    i += op->skip;
+                }
+                continue;
+            }
+
+            sp -= op->argc;
+            s = chunks + sp * chunk_bytes;
+            run_op(op, &stack[sp], s, n);
+            stack[sp++] = s;
+        }
+
+        store(type, stack[0], (char *)res + (size_t)c0 * Rast_cell_size(type),
+              n);
+    }
+}
+
+/****************************************************************************/
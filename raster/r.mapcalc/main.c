@@ -28,10 +28,12 @@
 /****************************************************************************/
 
 int overwrite_flag;
+int bytecode_flag;
 
 long seed_value;
 long seeded;
 int region_approach;
+int tile_rows, tile_cols;
 
 /****************************************************************************/
 
@@ -97,8 +99,8 @@ static bool expr_list_has_rand(const expr_list *list)
 int main(int argc, char **argv)
 {
     struct GModule *module;
-    struct Option *expr, *file, *seed, *region, *nprocs;
-    struct Flag *random, *describe;
+    struct Option *expr, *file, *seed, *region, *nprocs, *tile;
+    struct Flag *random, *describe, *bytecode;
     int all_ok;
     char *desc;
     int threads = 1;
@@ -157,8 +159,25 @@ int main(int argc, char **argv)
     describe->key = 'l';
     describe->description = _("List input and output maps");
 
+    bytecode = G_define_flag();
+    bytecode->key = 'b';
+    bytecode->label = _("Compile the expressions to bytecode");
+    bytecode->description =
+        _("Evaluates the cells in small chunks, skipping the branches of if() "
+          "which they do not use. Faster for large expressions");
+
     nprocs = G_define_standard_option(G_OPT_M_NPROCS);
 
+    tile = G_define_option();
+    tile->key = "tile";
+    tile->type = TYPE_INTEGER;
+    tile->key_desc = "rows,cols";
+    tile->required = NO;
+    tile->label = _("Number of rows and columns of the tiles");
+    tile->description =
+        _("Evaluates the region in tiles, in parallel. Bounds the memory used "
+          "by each thread, e.g. with large neighborhood offsets");
+
     char **p = G_malloc(3 * sizeof(char *));
     if (argc == 1) {
         p[0] = argv[0];
@@ -172,6 +191,7 @@ int main(int argc, char **argv)
         exit(EXIT_FAILURE);
 
     overwrite_flag = module->overwrite;
+    bytecode_flag = bytecode->answer;
 
     if (expr->answer && file->answer)
         G_fatal_error(_("%s= and %s= are mutually exclusive"), expr->key,
@@ -211,6 +231,14 @@ int main(int argc, char **argv)
         }
     }
 
+    if (tile->answer) {
+        tile_rows = atoi(tile->answers[0]);
+        tile_cols = atoi(tile->answers[1]);
+        if (tile_rows < 1 || tile_cols < 1)
+            G_fatal_error(_("Invalid tile size <%s,%s>"), tile->answers[0],
+                          tile->answers[1]);
+    }
+
     /* Set the global variable of the region setup approach */
     region_approach = 1;
 
@@ -233,19 +261,7 @@ int main(int argc, char **argv)
     /* Determine the number of threads */
     threads = atoi(nprocs->answer);
 
-    /* Check if the program name is r3.mapcalc */
-    /* Handle both Unix and Windows path separators */
-    const char *progname = strrchr(argv[0], '/');
-    if (!progname)
-        progname = strrchr(argv[0], '\\');
-    progname = progname ? progname + 1 : argv[0];
-
-    if ((strncmp(progname, "r3.mapcalc", 10) == 0) && (threads != 1)) {
-        threads = 1;
-        nprocs->answer = "1";
-        G_verbose_message(_("r3.mapcalc does not support parallel execution."));
-    }
-    else if ((threads != 1) && (has_rand)) {
+    if ((threads != 1) && (has_rand)) {
         threads = 1;
         nprocs->answer = "1";
         G_verbose_message(
@@ -259,7 +275,13 @@ int main(int argc, char **argv)
     if (threads < 1)
         G_fatal_error(_("<%d> is not valid number of nprocs."), threads);
 
+    /* rows are written one thread at a time, compress them in the
+       background so that the ordered write does not hold up the others */
+    if (threads > 1)
+        Rast_set_write_threads(threads);
+
     /* Execute calculations */
+    result = optimize(result);
     execute(result);
     post_exec();
 
@@ -30,6 +30,7 @@ void setup_region(void)
 
     rows = Rast_window_rows();
     columns = Rast_window_cols();
+    region_columns = columns;
     calc_init(columns);
     depths = 1;
 }
@@ -55,6 +56,7 @@ struct map {
     int have_colors;
     int use_rowio;
     int min_row, max_row;
+    int refs; /* number of map expressions reading it */
     int fd;
     struct Categories cats;
     struct Colors colors;
@@ -387,7 +389,9 @@ static void setup_map(struct map *m)
     pthread_mutex_init(&m->mutex, NULL);
 #endif
 
-    if (nrows > 1 && nrows <= max_rows_in_memory) {
+    /* a map read by several expressions, e.g. with column offsets or in
+       several outputs, has its rows read once */
+    if ((nrows > 1 || m->refs > 1) && nrows <= max_rows_in_memory) {
         cache_setup(&m->cache, m->fd, nrows);
         m->use_rowio = 1;
     }
@@ -546,6 +550,7 @@ int open_map(const char *name, int mod, int row, int col, int thread_num)
             m->min_row = row;
         if (row > m->max_row)
             m->max_row = row;
+        m->refs++;
 
         if (use_cats && !m->have_cats)
             init_cats(m);
@@ -570,6 +575,7 @@ int open_map(const char *name, int mod, int row, int col, int thread_num)
     m->use_rowio = 0;
     m->min_row = row;
     m->max_row = row;
+    m->refs = 1;
     m->fd = -1;
     m->thread_num = thread_num;
 
@@ -677,7 +683,8 @@ int open_output_map(const char *name, int res_type)
     return Rast_open_new((char *)name, res_type);
 }
 
-void put_map_row(int fd, void *buf, int res_type)
+void put_map_row(int fd, void *buf, int depth UNUSED, int row UNUSED,
+                 int res_type)
 {
     Rast_put_row(fd, buf, res_type);
 }
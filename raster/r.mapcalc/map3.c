@@ -31,6 +31,7 @@ void setup_region(void)
 
     rows = current_region3.rows;
     columns = current_region3.cols;
+    region_columns = columns;
     depths = current_region3.depths;
     calc_init(columns);
 }
@@ -68,6 +69,13 @@ static int max_row = -INT_MAX;
 static int min_col = INT_MAX;
 static int max_col = -INT_MAX;
 
+#if defined(_OPENMP)
+/* The raster3d library is not thread safe, its tile buffers are shared by
+ * all maps. The threads evaluate rows in parallel, but read and write the
+ * maps one at a time. */
+static omp_lock_t io_lock;
+#endif
+
 /****************************************************************************/
 
 static void read_row(void *handle, char *buf, int type, int depth, int row)
@@ -528,9 +536,15 @@ void setup_maps(void)
     /* We need to reduce the number of worker threads to one, to
      * avoid that several threads access a single map for reading
      * at the same time. The raster3d library is not thread safe.
+     * The rows are evaluated in parallel by OpenMP threads instead,
+     * see io_lock.
      * */
     putenv("WORKERS=0");
 
+#if defined(_OPENMP)
+    omp_init_lock(&io_lock);
+#endif
+
     for (i = 0; i < num_maps; i++)
         setup_map(&maps[i]);
 }
@@ -542,6 +556,10 @@ void get_map_row(int idx, int mod, int depth, int row, int col, void *buf,
     static DCELL *fbuf;
     map *m = &maps[idx];
 
+#if defined(_OPENMP)
+    omp_set_lock(&io_lock);
+#endif
+
     switch (mod) {
     case 'M':
         read_map(m, buf, res_type, depth, row, col);
@@ -567,6 +585,10 @@ void get_map_row(int idx, int mod, int depth, int row, int col, void *buf,
         G_fatal_error(_("Invalid map modifier: '%c'"), mod);
         break;
     }
+
+#if defined(_OPENMP)
+    omp_unset_lock(&io_lock);
+#endif
 }
 
 void close_maps(void)
@@ -577,6 +599,10 @@ void close_maps(void)
         close_map(&maps[i]);
 
     num_maps = 0;
+
+#if defined(_OPENMP)
+    omp_destroy_lock(&io_lock);
+#endif
 }
 
 void list_maps(FILE *fp, const char *sep)
@@ -620,15 +646,19 @@ int open_output_map(const char *name, int res_type)
     return num_omaps++;
 }
 
-void put_map_row(int fd, void *buf, int res_type)
+void put_map_row(int fd, void *buf, int depth, int row, int res_type)
 {
     void *handle = omaps[fd];
-    int tid = 0;
+
 #if defined(_OPENMP)
-    tid = omp_get_thread_num();
+    omp_set_lock(&io_lock);
 #endif
 
-    write_row(handle, buf, res_type, current_depth, current_row[tid]);
+    write_row(handle, buf, res_type, depth, row);
+
+#if defined(_OPENMP)
+    omp_unset_lock(&io_lock);
+#endif
 }
 
 void close_output_map(int fd)
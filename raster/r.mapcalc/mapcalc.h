@@ -37,6 +37,49 @@ extern void column_shift(void *buf, int res_type, int col);
 extern int is_var(const char *);
 extern char *format_expression(const expression *);
 
+/* kernel.c */
+
+typedef struct kernel {
+    int num_ops, max_ops;
+    struct kernel_op *ops; /* operations in postfix order */
+    int num_leaves, max_leaves;
+    expression **leaves; /* expressions evaluated before the kernel */
+    int sp, depth;       /* stack depth while compiling, maximum */
+    int bytecode;        /* of the whole expression */
+    int chunk;           /* cells evaluated at a time */
+    int threads;
+    void **scratch; /* stack of each thread */
+} kernel;
+
+extern kernel *build_kernel(expression *, int);
+extern void free_kernel(kernel *);
+extern void run_kernel(const kernel *, void *, int, void (*)(expression *));
+
+/* optimize.c */
+
+extern expr_list *optimize(expr_list *);
+
+/* reduce.c */
+
+struct stats {
+    double n; /* number of non-null cells */
+    double sum;
+    double m2; /* sum of squared differences from the mean */
+    double min, max;
+};
+
+extern int is_reduction(const expression *);
+extern void stats_row(struct stats *, const DCELL *, int);
+extern void stats_merge(struct stats *, const struct stats *);
+extern DCELL stats_value(const expression *, const struct stats *);
+
+/* tile.c */
+
+extern void setup_bands(expression **, int, int);
+extern void load_bands(int);
+extern void get_band_row(const expression *, int, int, void *);
+extern void release_bands(void);
+
 /* evaluate.c */
 
 extern void execute(expr_list *);
@@ -60,7 +103,7 @@ extern void list_maps(FILE *, const char *);
 
 extern int check_output_map(const char *name);
 extern int open_output_map(const char *name, int res_type);
-extern void put_map_row(int fd, void *buf, int res_type);
+extern void put_map_row(int fd, void *buf, int depth, int row, int res_type);
 extern void close_output_map(int fd);
 extern void unopen_output_map(int fd);
 
@@ -0,0 +1,327 @@
+#include <string.h>
+
+#include <grass/gis.h>
+#include <grass/raster.h>
+#include <grass/calc.h>
+
+#include "mapcalc.h"
+
+/****************************************************************************/
+
+/* Optimization of the parsed expressions before they are executed:
+ *
+ * Subtrees of constants (e.g. exp(2.5)*3) are marked constant, they are
+ * evaluated once when initialized instead of for every row.
+ *
+ * Identical subtrees of maps and functions, within one expression or
+ * across expressions, are evaluated once per row: each is moved into a
+ * binding without output map, and every occurrence is replaced by a
+ * reference to its value, as for variables. The binding is evaluated
+ * where the first of its references is in the row, so that a subtree
+ * used only in branches of if() which are not taken is still skipped,
+ * see evaluate.c. Subtrees with variables, bindings or rand() are left
+ * alone.
+ */
+
+#define HASH_SIZE 256 /* power of 2 */
+
+struct node {
+    expression *e;     /* first occurrence */
+    unsigned int hash;
+    int refs;          /* number of occurrences */
+    expression *value; /* reference to the value of the binding, if moved */
+    struct node *next;  /* next node of the same hash */
+    struct node *pnext; /* next node of the same pointer hash */
+};
+
+static struct node *table[HASH_SIZE], *by_ptr[HASH_SIZE];
+static expr_list *hidden, **hidden_tail;
+static int num_hidden;
+
+/****************************************************************************/
+
+static unsigned int hash_string(const char *s)
+{
+    unsigned int h = 5381;
+
+    while (*s)
+        h = h * 33 + (unsigned char)*s++;
+
+    return h;
+}
+
+static unsigned int hash_expr(const expression *e);
+
+static unsigned int hash_ptr(const expression *e)
+{
+    return (unsigned int)((size_t)e >> 4);
+}
+
+static unsigned int hash_arg(const expression *e)
+{
+    /* shared arguments are unique, constants are compared by value */
+    if (e->constant)
+        return hash_expr(e);
+
+    return hash_ptr(e);
+}
+
+static unsigned int hash_expr(const expression *e)
+{
+    unsigned int h = e->type * 31u + e->res_type;
+    int i;
+
+    switch (e->type) {
+    case expr_type_constant:
+        if (e->res_type == CELL_TYPE)
+            h = h * 31u + (unsigned int)e->data.con.ival;
+        else {
+            unsigned int w[sizeof(double) / sizeof(unsigned int)];
+
+            memcpy(w, &e->data.con.fval, sizeof(double));
+            for (i = 0; i < (int)(sizeof(w) / sizeof(w[0])); i++)
+                h = h * 31u + w[i];
+        }
+        break;
+    case expr_type_map:
+        h = h * 31u + hash_string(e->data.map.name);
+        h = h * 31u + e->data.map.mod;
+        h = h * 31u + (unsigned int)e->data.map.row;
+        h = h * 31u + (unsigned int)e->data.map.col;
+        h = h * 31u + (unsigned int)e->data.map.depth;
+        break;
+    case expr_type_function:
+        h = h * 31u + hash_string(e->data.func.name);
+        for (i = 1; i <= e->data.func.argc; i++)
+            h = h * 31u + hash_arg(e->data.func.args[i]);
+        break;
+    }
+
+    return h;
+}
+
+static int equal(const expression *a, const expression *b)
+{
+    int i;
+
+    if (a == b)
+        return 1;
+
+    if (a->type != b->type || a->res_type != b->res_type)
+        return 0;
+
+    switch (a->type) {
+    case expr_type_constant:
+        return a->res_type == CELL_TYPE
+                   ? a->data.con.ival == b->data.con.ival
+                   : a->data.con.fval == b->data.con.fval;
+    case expr_type_map:
+        return strcmp(a->data.map.name, b->data.map.name) == 0 &&
+               a->data.map.mod == b->data.map.mod &&
+               a->data.map.row == b->data.map.row &&
+               a->data.map.col == b->data.map.col &&
+               a->data.map.depth == b->data.map.depth;
+    case expr_type_function:
+        if (a->data.func.func != b->data.func.func ||
+            a->data.func.argc != b->data.func.argc)
+            return 0;
+        for (i = 0; i <= a->data.func.argc; i++)
+            if (a->data.func.argt[i] != b->data.func.argt[i])
+                return 0;
+        for (i = 1; i <= a->data.func.argc; i++) {
+            const expression *x = a->data.func.args[i];
+            const expression *y = b->data.func.args[i];
+
+            /* shared arguments are unique, constants are compared */
+            if (x != y && !(x->constant && y->constant && equal(x, y)))
+                return 0;
+        }
+        return 1;
+    default:
+        return 0;
+    }
+}
+
+static struct node *find_node(const expression *e)
+{
+    struct node *n;
+
+    for (n = by_ptr[hash_ptr(e) & (HASH_SIZE - 1)]; n; n = n->pnext)
+        if (n->e == e)
+            return n;
+
+    return NULL;
+}
+
+/****************************************************************************/
+
+/* mark constant subtrees and share identical ones, returns 1 if the
+   subtree may be shared */
+static int share(expression **slot)
+{
+    expression *e = *slot;
+    struct node *n;
+    unsigned int h;
+    int i;
+
+    switch (e->type) {
+    case expr_type_constant:
+        return 1;
+    case expr_type_map:
+        break;
+    case expr_type_function: {
+        int pure = e->data.func.func != f_rand;
+        /* reductions are computed by execute(), see evaluate.c */
+        int constant = e->data.func.argc > 0 && !is_reduction(e);
+
+        for (i = 1; i <= e->data.func.argc; i++) {
+            pure &= share(&e->data.func.args[i]);
+            constant &= e->data.func.args[i]->constant;
+        }
+
+        if (!pure)
+            return 0;
+
+        /* constants are evaluated once anyway */
+        if (constant) {
+            e->constant = 1;
+            return 1;
+        }
+        break;
+    }
+    case expr_type_binding:
+        share(&e->data.bind.val);
+        return 0;
+    default:
+        return 0;
+    }
+
+    h = hash_expr(e);
+
+    for (n = table[h & (HASH_SIZE - 1)]; n; n = n->next)
+        if (n->hash == h && equal(n->e, e))
+            break;
+
+    if (!n) {
+        n = G_malloc(sizeof(struct node));
+        n->e = e;
+        n->hash = h;
+        n->refs = 1;
+        n->value = NULL;
+        n->next = table[h & (HASH_SIZE - 1)];
+        table[h & (HASH_SIZE - 1)] = n;
+        n->pnext = by_ptr[hash_ptr(e) & (HASH_SIZE - 1)];
+        by_ptr[hash_ptr(e) & (HASH_SIZE - 1)] = n;
+        return 1;
+    }
+
+    /* the arguments of the duplicate are no longer used */
+    if (e->type == expr_type_function)
+        for (i = 1; i <= e->data.func.argc; i++) {
+            struct node *arg = find_node(e->data.func.args[i]);
+
+            if (arg)
+                arg->refs--;
+        }
+
+    n->refs++;
+    *slot = n->e;
+
+    return 1;
+}
+
+/* move subtrees occurring more than once into bindings, innermost first */
+static void hoist(expression **slot)
+{
+    expression *e = *slot;
+    struct node *n;
+    int i;
+
+    switch (e->type) {
+    case expr_type_function:
+        for (i = 1; i <= e->data.func.argc; i++)
+            hoist(&e->data.func.args[i]);
+        break;
+    case expr_type_binding:
+        hoist(&e->data.bind.val);
+        return;
+    case expr_type_map:
+        break;
+    default:
+        return;
+    }
+
+    n = find_node(e);
+    if (!n || n->refs < 2)
+        return;
+
+    if (!n->value) {
+        expression *b = binding(NULL, e);
+
+        *hidden_tail = singleton(b);
+        hidden_tail = &(*hidden_tail)->next;
+        n->value = bound_value(b);
+        num_hidden++;
+    }
+
+    *slot = n->value;
+}
+
+/*!
+   \brief Optimize expressions for execution
+
+   Marks constant subtrees and evaluates identical subtrees once, see
+   above. The expressions are modified in place.
+
+   \param ee expressions
+
+   \return expressions to execute, the bindings of shared subtrees first
+ */
+expr_list *optimize(expr_list *ee)
+{
+    expr_list *l;
+    int i;
+
+    for (l = ee; l; l = l->next) {
+        expression *e = l->exp;
+
+        /* top level expressions stay in the list */
+        if (e->type == expr_type_function)
+            for (i = 1; i <= e->data.func.argc; i++)
+                share(&e->data.func.args[i]);
+        else
+            share(&e->data.bind.val);
+    }
+
+    hidden = NULL;
+    hidden_tail = &hidden;
+    num_hidden = 0;
+
+    for (l = ee; l; l = l->next) {
+        expression *e = l->exp;
+
+        if (e->type == expr_type_function)
+            for (i = 1; i <= e->data.func.argc; i++)
+                hoist(&e->data.func.args[i]);
+        else
+            hoist(&e->data.bind.val);
+    }
+
+    for (i = 0; i < HASH_SIZE; i++) {
+        while (table[i]) {
+            struct node *n = table[i];
+
+            table[i] = n->next;
+            G_free(n);
+        }
+        by_ptr[i] = NULL;
+    }
+
+    G_debug(3, "%d shared subexpressions", num_hidden);
+
+    *hidden_tail = ee;
+
+    return hidden;
+}
+
+/****************************************************************************/
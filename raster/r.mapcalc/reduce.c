@@ -0,0 +1,177 @@
+#include <math.h>
+
+#include <grass/gis.h>
+#include <grass/raster.h>
+#include "globals.h"
+#include "mapcalc.h"
+#include "func_proto.h"
+
+/**********************************************************************
+gsum(x)    sum of the non-null cells of x in the region
+gcount(x)  number of non-null cells
+gmin(x)    minimum
+gmax(x)    maximum
+gmean(x)   mean
+gvar(x)    population variance
+gstddev(x) population standard deviation
+
+The values are computed by execute() in passes over the region, see
+evaluate.c, the functions are never called for rows.
+**********************************************************************/
+
+int f_gsum(int argc UNUSED, const int *argt UNUSED, void **args UNUSED)
+{
+    return E_WTF;
+}
+
+int f_gcount(int argc UNUSED, const int *argt UNUSED, void **args UNUSED)
+{
+    return E_WTF;
+}
+
+int f_gmin(int argc UNUSED, const int *argt UNUSED, void **args UNUSED)
+{
+    return E_WTF;
+}
+
+int f_gmax(int argc UNUSED, const int *argt UNUSED, void **args UNUSED)
+{
+    return E_WTF;
+}
+
+int f_gmean(int argc UNUSED, const int *argt UNUSED, void **args UNUSED)
+{
+    return E_WTF;
+}
+
+int f_gvar(int argc UNUSED, const int *argt UNUSED, void **args UNUSED)
+{
+    return E_WTF;
+}
+
+int f_gstddev(int argc UNUSED, const int *argt UNUSED, void **args UNUSED)
+{
+    return E_WTF;
+}
+
+/****************************************************************************/
+
+int is_reduction(const expression *e)
+{
+    func_t *func;
+
+    if (e->type != expr_type_function)
+        return 0;
+
+    func = e->data.func.func;
+
+    return func == f_gsum || func == f_gcount || func == f_gmin ||
+           func == f_gmax || func == f_gmean || func == f_gvar ||
+           func == f_gstddev;
+}
+
+/*!
+   \brief Compute the statistics of a row
+
+   \param s statistics
+   \param buf row of DCELL values
+   \param ncols number of values
+ */
+void stats_row(struct stats *s, const DCELL *buf, int ncols)
+{
+    double mean;
+    int i;
+
+    s->n = 0;
+    s->sum = 0;
+    s->m2 = 0;
+    s->min = 0;
+    s->max = 0;
+
+    for (i = 0; i < ncols; i++) {
+        if (IS_NULL_D(&buf[i]))
+            continue;
+        if (s->n == 0 || buf[i] < s->min)
+            s->min = buf[i];
+        if (s->n == 0 || buf[i] > s->max)
+            s->max = buf[i];
+        s->sum += buf[i];
+        s->n++;
+    }
+
+    if (s->n == 0)
+        return;
+
+    /* second pass, the row is in the cache */
+    mean = s->sum / s->n;
+    for (i = 0; i < ncols; i++)
+        if (!IS_NULL_D(&buf[i]))
+            s->m2 += (buf[i] - mean) * (buf[i] - mean);
+}
+
+/*!
+   \brief Merge the statistics of cells into those of other cells
+
+   Uses the pairwise update of the sum of squared differences of Chan et
+   al., which does not lose precision as the sum of squares does.
+
+   \param s statistics to update
+   \param t statistics merged
+ */
+void stats_merge(struct stats *s, const struct stats *t)
+{
+    double delta, n;
+
+    if (t->n == 0)
+        return;
+
+    if (s->n == 0) {
+        *s = *t;
+        return;
+    }
+
+    n = s->n + t->n;
+    delta = t->sum / t->n - s->sum / s->n;
+    s->m2 += t->m2 + delta * delta * s->n * t->n / n;
+    s->sum += t->sum;
+    s->n = n;
+    if (t->min < s->min)
+        s->min = t->min;
+    if (t->max > s->max)
+        s->max = t->max;
+}
+
+/*!
+   \brief Value of a reduction
+
+   \param e reduction, see is_reduction()
+   \param s statistics of its argument in the region
+
+   \return value, null if there are no cells except for gcount()
+ */
+DCELL stats_value(const expression *e, const struct stats *s)
+{
+    func_t *func = e->data.func.func;
+    DCELL x;
+
+    if (func == f_gcount)
+        return s->n;
+
+    if (s->n == 0) {
+        Rast_set_d_null_value(&x, 1);
+        return x;
+    }
+
+    if (func == f_gsum)
+        return s->sum;
+    if (func == f_gmin)
+        return s->min;
+    if (func == f_gmax)
+        return s->max;
+    if (func == f_gmean)
+        return s->sum / s->n;
+    if (func == f_gvar)
+        return s->m2 / s->n;
+
+    return sqrt(s->m2 / s->n);
+}
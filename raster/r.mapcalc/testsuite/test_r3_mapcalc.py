@@ -62,6 +62,21 @@ class TestBasicOperations(TestCase):
         self.to_remove.append("nrows_ncols_ndepths_sum")
         self.assertRaster3dMinMax("nrows_ncols_ndepths_sum", refmin=2160, refmax=2160)
 
+    def test_parallel(self):
+        """Test several threads against one thread"""
+        self.runModule("r3.mapcalc", expression="p3 = rand(-100.0, 100)", seed=1)
+        self.to_remove.append("p3")
+        expression = "{0} = p3[-1, 0, 1] * depth() + if(p3 > 0, sqrt(p3), p3[0, 1, 0])"
+        self.runModule("r3.mapcalc", expression=expression.format("p3_s"), nprocs=1)
+        self.to_remove.append("p3_s")
+        self.assertModule(
+            "r3.mapcalc", expression=expression.format("p3_p"), nprocs=4
+        )
+        self.to_remove.append("p3_p")
+        self.runModule("r3.mapcalc", expression="p3_d = p3_p - p3_s")
+        self.to_remove.append("p3_d")
+        self.assertRaster3dMinMax("p3_d", refmin=0, refmax=0)
+
 
 if __name__ == "__main__":
     test()
@@ -1,3 +1,6 @@
+import os
+
+import grass.script as gs
 from grass.gunittest.case import TestCase
 from grass.gunittest.main import test
 from grass.gunittest.gmodules import SimpleModule
@@ -214,6 +217,238 @@ class TestBasicOperations(TestCase):
         self.to_remove.append("diff_e_e")
         self.assertRasterMinMax("diff_e_e", refmin=0, refmax=0)
 
+    def test_fused_arithmetic(self):
+        """Test fused arithmetic against the same operations one by one"""
+        self.runModule("r.mapcalc", expression="fa = rand(-50.0, 50)", seed=1)
+        self.runModule("r.mapcalc", expression="fi = rand(0, 5)", seed=2)
+        self.to_remove.extend(["fa", "fi"])
+        for name, expr in [
+            ("f1", "fa * 2"),
+            ("f2", "f1 + fi"),
+            ("f3", "fi - 2"),
+            ("f4", "f2 / f3"),
+            ("f5", "-f4"),
+        ]:
+            self.runModule("r.mapcalc", expression=f"{name} = {expr}")
+            self.to_remove.append(name)
+        self.assertModule(
+            "r.mapcalc", expression="fused = -((fa * 2 + fi) / (fi - 2))"
+        )
+        self.to_remove.append("fused")
+        self.assertRastersEqual("fused", reference="f5", precision=0)
+
+    def test_shared_subexpressions(self):
+        """Test identical subexpressions in several expressions"""
+        self.runModule("r.mapcalc", expression="sa = rand(-50.0, 50)", seed=1)
+        self.to_remove.append("sa")
+        self.runModule(
+            "r.mapcalc", expression="s1 = if(sa > 0, sa * 0.3 + 1, sa * 0.3 - 1)"
+        )
+        self.runModule("r.mapcalc", expression="s2 = sa * 0.3 + exp(2.5) * 3")
+        self.to_remove.extend(["s1", "s2"])
+        self.assertModule(
+            "r.mapcalc",
+            expression="s3 = if(sa > 0, sa * 0.3 + 1, sa * 0.3 - 1)\n"
+            "s4 = sa * 0.3 + exp(2.5) * 3",
+        )
+        self.to_remove.extend(["s3", "s4"])
+        self.assertRastersEqual("s3", reference="s1", precision=0)
+        self.assertRastersEqual("s4", reference="s2", precision=0)
+
+    def test_vector_kernels(self):
+        """Test element-wise functions against their scalar code"""
+        self.runModule(
+            "r.mapcalc",
+            expression="va = if(rand(0, 5) == 0, null(), rand(-5, 5))\n"
+            "vb = if(rand(0, 5) == 0, null(), rand(-5.0, 5))",
+            seed=1,
+        )
+        self.to_remove.extend(["va", "vb"])
+        expression = (
+            "{p}1 = if(va > 0, va - 1, -va) * 3\n"
+            "{p}2 = if(vb >= va, vb / va, float(vb) + float(va))\n"
+            "{p}3 = (va != vb) + (va == 0) + (vb <= 0.5) + (vb < va)"
+        )
+        self.runModule(
+            "r.mapcalc",
+            expression=expression.format(p="vs"),
+            env_=dict(os.environ, GRASS_CALC_VECTOR="0"),
+        )
+        self.to_remove.extend(["vs1", "vs2", "vs3"])
+        self.assertModule("r.mapcalc", expression=expression.format(p="vv"))
+        self.to_remove.extend(["vv1", "vv2", "vv3"])
+        for i in range(1, 4):
+            self.assertRastersEqual(f"vv{i}", reference=f"vs{i}", precision=0)
+
+    def test_lazy_if(self):
+        """Test if() and null rows with unevaluated arguments"""
+        self.runModule(
+            "r.mapcalc", expression="lz = if(row() % 2, rand(0, 10), null())", seed=1
+        )
+        self.to_remove.append("lz")
+        self.assertModule(
+            "r.mapcalc",
+            expression="lz1 = if(lz > 5, sqrt(lz), lz * 2)\n"
+            "lz2 = if(row() > 100, exp(lz), 1.5 * lz)",
+        )
+        self.to_remove.extend(["lz1", "lz2"])
+        self.runModule(
+            "r.mapcalc",
+            expression="lz1r = (lz > 5) * sqrt(lz) + (lz <= 5) * lz * 2\n"
+            "lz2r = 1.5 * lz",
+        )
+        self.to_remove.extend(["lz1r", "lz2r"])
+        self.assertRastersEqual("lz1", reference="lz1r", precision=0)
+        self.assertRastersEqual("lz2", reference="lz2r", precision=0)
+
+    def test_lazy_shared(self):
+        """Test that a shared subexpression used only in if() branches not
+        taken is not evaluated"""
+        self.runModule("r.mapcalc", expression="lzs = row() * 1.5")
+        self.to_remove.append("lzs")
+        # rows after the second can no longer be read
+        env = gs.gisenv()
+        path = os.path.join(
+            env["GISDBASE"], env["LOCATION_NAME"], env["MAPSET"], "fcell", "lzs"
+        )
+        with open(path, "rb") as f:
+            header = f.read(32)
+        size = header[0]
+        os.truncate(path, int.from_bytes(header[1 + 2 * size : 1 + 3 * size], "big"))
+        self.assertModule(
+            "r.mapcalc",
+            expression="lzs1 = if(row() <= 2, sqrt(lzs) + 1, 0)"
+            " + if(row() <= 2, sqrt(lzs) * 2, 1)",
+        )
+        self.to_remove.append("lzs1")
+        self.runModule(
+            "r.mapcalc",
+            expression="lzs1r = if(row() <= 2, sqrt(row() * 1.5) * 3 + 1, 1)",
+        )
+        self.to_remove.append("lzs1r")
+        self.assertRastersEqual("lzs1", reference="lzs1r", precision=1e-10)
+
+    def test_reductions(self):
+        """Test statistics of the region against r.univar"""
+        self.runModule(
+            "r.mapcalc",
+            expression="rd = if(row() == 3, null(), rand(-100.0, 100.0))",
+            seed=1,
+        )
+        self.to_remove.append("rd")
+        self.assertModule(
+            "r.mapcalc", expression="rdz = (rd - gmean(rd)) / gstddev(rd)"
+        )
+        self.to_remove.append("rdz")
+        self.assertRasterFitsUnivar(
+            "rdz", reference={"n": 90, "mean": 0, "stddev": 1}, precision=1e-10
+        )
+
+        mapcalc = SimpleModule(
+            "r.mapcalc", expression="gsum(rd)\ngcount(rd)\ngmin(rd)\ngmax(rd)"
+        )
+        self.assertModule(mapcalc)
+        values = dict(
+            line.split("=", 1) for line in mapcalc.outputs.stdout.splitlines()
+        )
+        univar = SimpleModule("r.univar", map="rd", flags="g")
+        self.assertModule(univar)
+        reference = dict(
+            line.split("=", 1) for line in univar.outputs.stdout.splitlines()
+        )
+        self.assertEqual(float(values["gcount(rd)"]), float(reference["n"]))
+        for name, key in (("gsum", "sum"), ("gmin", "min"), ("gmax", "max")):
+            self.assertAlmostEqual(
+                float(values["%s(rd)" % name]), float(reference[key]), places=8
+            )
+
+    def test_reductions_rand(self):
+        """Test that variables using rand() are not evaluated again for
+        statistics of the region"""
+        self.assertModuleFail(
+            "r.mapcalc", expression="rr = rand(0.0, 1)\nrrz = rr - gmean(rr)", seed=1
+        )
+        self.assertModule("r.mapcalc", expression="rr = rand(0.0, 1)", seed=1)
+        self.to_remove.append("rr")
+        self.assertModule("r.mapcalc", expression="rrz = rr - gmean(rr)")
+        self.to_remove.append("rrz")
+        self.assertRasterFitsUnivar(
+            "rrz", reference={"n": 100, "mean": 0}, precision=1e-10
+        )
+
+    def test_tiles(self):
+        """Test tiled evaluation against evaluation of full rows"""
+        self.runModule(
+            "r.mapcalc",
+            expression="ta = if(rand(0, 5) == 0, null(), rand(-50.0, 50))",
+            seed=1,
+        )
+        self.to_remove.append("ta")
+        expression = (
+            "{p}1 = ta[-1,0] + ta[1,1] * ta[0,-2] + col() * 10 + row()\n"
+            "{p}2 = if(ta > 0, x() - y(), ncols())"
+        )
+        self.runModule("r.mapcalc", expression=expression.format(p="tr"))
+        self.to_remove.extend(["tr1", "tr2"])
+        self.assertModule(
+            "r.mapcalc", expression=expression.format(p="tt"), tile=(4, 3)
+        )
+        self.to_remove.extend(["tt1", "tt2"])
+        for i in range(1, 3):
+            self.assertRastersEqual(f"tt{i}", reference=f"tr{i}", precision=0)
+
+    def test_bytecode(self):
+        """Test bytecode evaluation against evaluation of the tree"""
+        self.runModule(
+            "r.mapcalc",
+            expression="ba = if(rand(0, 5) == 0, null(), rand(-50.0, 50))",
+            seed=1,
+        )
+        self.to_remove.append("ba")
+        expression = (
+            "{p}1 = if(ba < -30, 1, if(ba < -10, 2, if(ba < 10, 3, 4)))\n"
+            "{p}2 = ba > 0 && ba < 20 || isnull(ba[1,0]) ||| !(ba == 5)\n"
+            "{p}3 = min(ba, 10) + max(abs(ba[0,1]), 5.5) * int(ba)\n"
+            "{p}4 = if(ba, float(ba) / 3, double(row()), col())\n"
+            "{p}5 = if(isnull(ba), 7, ba - ba[-1,-1] + float(0.5))"
+        )
+        self.runModule("r.mapcalc", expression=expression.format(p="br"))
+        self.to_remove.extend([f"br{i}" for i in range(1, 6)])
+        self.assertModule(
+            "r.mapcalc", expression=expression.format(p="bb"), flags="b"
+        )
+        self.to_remove.extend([f"bb{i}" for i in range(1, 6)])
+        for i in range(1, 6):
+            self.assertRastersEqual(f"bb{i}", reference=f"br{i}", precision=0)
+
+    def test_multiple_outputs(self):
+        """Test a batch of outputs against computing them one by one"""
+        self.runModule(
+            "r.mapcalc",
+            expression="ma = rand(1, 100)\nmb = if(rand(0, 5) == 0, null(), rand(1.0, 9))",
+            seed=1,
+        )
+        self.to_remove.extend(["ma", "mb"])
+        expressions = [
+            "{p}1 = float(ma - mb) / (ma + mb)",
+            "{p}2 = ma[0,-1] - ma[0,1] + mb",
+            "{p}3 = if(mb > 5, ma, ma[0,1] * 2)",
+            "{p}4 = mb[0,-1] * mb[0,1] / ma",
+        ]
+        for expression in expressions:
+            self.runModule("r.mapcalc", expression=expression.format(p="mr"))
+        self.to_remove.extend([f"mr{i}" for i in range(1, 5)])
+        module = SimpleModule(
+            "r.mapcalc",
+            file="-",
+            nprocs=4,
+            stdin_="\n".join(expressions).format(p="mm"),
+        )
+        self.assertModule(module)
+        self.to_remove.extend([f"mm{i}" for i in range(1, 5)])
+        for i in range(1, 5):
+            self.assertRastersEqual(f"mm{i}", reference=f"mr{i}", precision=0)
+
     def test_nrows_ncols_sum(self):
         """Test if sum of nrows and ncols matches one
         expected from current region settings"""
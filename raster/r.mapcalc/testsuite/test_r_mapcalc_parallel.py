@@ -275,6 +275,23 @@ class TestBasicOperations(TestCase):
         self.to_remove.append("nrows_ncols_sum")
         self.assertRasterMinMax("nrows_ncols_sum", refmin=20, refmax=20)
 
+    def test_rows_in_order(self):
+        """Test rows with neighborhood modifiers against one thread"""
+        self.runModule("r.mapcalc", expression="rows_n = rand(1.0, 200)", seed=1)
+        self.to_remove.append("rows_n")
+        expression = (
+            "{p}1 = rows_n[-1, 0] + rows_n[1, 1] - rows_n[0, -1]\n"
+            "{p}2 = if(row() % 3, rows_n * row(), rows_n[2, 0])"
+        )
+        self.runModule("r.mapcalc", expression=expression.format(p="rows_s"), nprocs=1)
+        self.to_remove.extend(["rows_s1", "rows_s2"])
+        self.assertModule(
+            "r.mapcalc", expression=expression.format(p="rows_p"), nprocs=THREADS
+        )
+        self.to_remove.extend(["rows_p1", "rows_p2"])
+        self.assertRastersEqual("rows_p1", reference="rows_s1", precision=0)
+        self.assertRastersEqual("rows_p2", reference="rows_s2", precision=0)
+
 
 class TestRegionOperations(TestCase):
     # TODO: replace by unified handing of maps
@@ -0,0 +1,218 @@
+#if defined(_OPENMP)
+#include <omp.h>
+#endif
+
+#include <string.h>
+
+#include <grass/gis.h>
+#include <grass/raster.h>
+
+#include "mapcalc.h"
+#include "globals.h"
+
+/****************************************************************************/
+
+/* Rows of the maps for tiled evaluation, see execute() in evaluate.c.
+ *
+ * The region is evaluated in bands of rows. Before a band is evaluated,
+ * the rows of each map which it needs, those of the band and the halo
+ * given by the row offsets of the neighborhood modifiers, are read once,
+ * in parallel. The tiles of the band then take the cells they need from
+ * these rows, for any row and column offset. The rows shared with the
+ * previous band are kept.
+ *
+ * The maps with the same name, modifier, type and depth offset share their
+ * rows.
+ */
+
+struct band {
+    const char *name;
+    int mod, res_type, depth;
+    int *idx;             /* maps of the threads, see open_map() */
+    int min_row, max_row; /* row offsets */
+    int size;             /* number of rows kept */
+    int first;            /* row in row[0] */
+    int loaded;           /* depth of the rows, -1 if none */
+    void **row;
+    struct band *next;
+};
+
+struct job {
+    struct band *band;
+    int i;
+};
+
+static struct band *bands;
+static int band_rows;
+
+/****************************************************************************/
+
+static struct band *find_band(const expression *e)
+{
+    struct band *b;
+
+    for (b = bands; b; b = b->next)
+        if (strcmp(b->name, e->data.map.name) == 0 &&
+            b->mod == e->data.map.mod && b->res_type == e->res_type &&
+            b->depth == e->data.map.depth)
+            return b;
+
+    b = G_malloc(sizeof(struct band));
+    b->name = e->data.map.name;
+    b->mod = e->data.map.mod;
+    b->res_type = e->res_type;
+    b->depth = e->data.map.depth;
+    b->idx = e->data.map.idx;
+    b->min_row = e->data.map.row;
+    b->max_row = e->data.map.row;
+    b->next = bands;
+    bands = b;
+
+    return b;
+}
+
+/*!
+   \brief Set up the rows read for tiled evaluation
+
+   \param maps the maps of the expressions
+   \param num_maps number of maps
+   \param nrows number of rows of a band
+ */
+void setup_bands(expression **maps, int num_maps, int nrows)
+{
+    struct band *b;
+    int i;
+
+    bands = NULL;
+    band_rows = nrows;
+
+    for (i = 0; i < num_maps; i++) {
+        expression *e = maps[i];
+
+        b = find_band(e);
+        if (e->data.map.row < b->min_row)
+            b->min_row = e->data.map.row;
+        if (e->data.map.row > b->max_row)
+            b->max_row = e->data.map.row;
+        e->data.map.band = b;
+    }
+
+    for (b = bands; b; b = b->next) {
+        b->size = band_rows + b->max_row - b->min_row;
+        b->first = 0;
+        b->loaded = -1;
+        b->row = G_malloc(b->size * sizeof(void *));
+        for (i = 0; i < b->size; i++)
+            b->row[i] = G_malloc(region_columns * Rast_cell_size(b->res_type));
+        G_debug(3, "band <%s>: %d rows", b->name, b->size);
+    }
+}
+
+/*!
+   \brief Read the rows needed by a band of rows
+
+   Called with columns set to the number of columns of the region.
+
+   \param row0 first row of the band
+ */
+void load_bands(int row0)
+{
+    struct band *b;
+    struct job *jobs;
+    int num_jobs = 0;
+    int i, k;
+
+    for (b = bands; b; b = b->next)
+        num_jobs += b->size;
+    jobs = G_malloc(num_jobs * sizeof(struct job));
+    num_jobs = 0;
+
+    for (b = bands; b; b = b->next) {
+        int first = row0 + b->min_row;
+        int shift = first - b->first;
+        int keep = 0;
+
+        /* rotate the rows kept to the front */
+        if (b->loaded == current_depth && shift >= 0 && shift < b->size) {
+            void **tmp = G_alloca(b->size * sizeof(void *));
+
+            memcpy(tmp, b->row, b->size * sizeof(void *));
+            for (i = 0; i < b->size; i++)
+                b->row[i] = tmp[(i + shift) % b->size];
+            G_freea(tmp);
+            keep = b->size - shift;
+        }
+
+        b->first = first;
+        b->loaded = current_depth;
+        for (i = keep; i < b->size; i++) {
+            jobs[num_jobs].band = b;
+            jobs[num_jobs].i = i;
+            num_jobs++;
+        }
+    }
+
+#pragma omp parallel for default(shared) schedule(dynamic, 1) private(b, i)
+    for (k = 0; k < num_jobs; k++) {
+        int tid = 0;
+#if defined(_OPENMP)
+        tid = omp_get_thread_num();
+#endif
+        b = jobs[k].band;
+        i = jobs[k].i;
+        get_map_row(b->idx[tid], b->mod, current_depth + b->depth,
+                    b->first + i, 0, b->row[i], b->res_type);
+    }
+
+    G_free(jobs);
+}
+
+/*!
+   \brief Get the cells of a map for a tile
+
+   Gets the columns col to col + columns - 1 of the map row, null outside
+   of the region.
+
+   \param e map
+   \param row row, including the row offset of e
+   \param col first column, including the column offset of e
+   \param buf buffer for the cells
+ */
+void get_band_row(const expression *e, int row, int col, void *buf)
+{
+    const struct band *b = e->data.map.band;
+    const char *src = b->row[row - b->first];
+    char *dst = buf;
+    size_t size = Rast_cell_size(b->res_type);
+    int lo = col < 0 ? 0 : col;
+    int hi = col + columns > region_columns ? region_columns : col + columns;
+
+    if (hi <= lo) {
+        Rast_set_null_value(buf, columns, b->res_type);
+        return;
+    }
+
+    if (lo > col)
+        Rast_set_null_value(dst, lo - col, b->res_type);
+    memcpy(dst + (lo - col) * size, src + lo * size, (hi - lo) * size);
+    if (hi < col + columns)
+        Rast_set_null_value(dst + (hi - col) * size, col + columns - hi,
+                            b->res_type);
+}
+
+/*!
+   \brief Free the rows read for tiled evaluation
+ */
+void release_bands(void)
+{
+    while (bands) {
+        struct band *b = bands;
+        int i;
+
+        bands = b->next;
+        for (i = 0; i < b->size; i++)
+            G_free(b->row[i]);
+        G_free(b->row);
+        G_free(b);
+    }
+}
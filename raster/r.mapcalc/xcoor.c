@@ -15,8 +15,34 @@ y() northing at center of row
 z() height at center of depth
 **********************************************************************/
 
+/* eastings of the columns for tiles, summed as for whole rows so that the
+   values are the same, including those of the columns past the region */
+static const DCELL *eastings(void)
+{
+    static DCELL *xs;
+
+#pragma omp critical(eastings)
+    if (!xs) {
+        DCELL x = Rast_col_to_easting(0.5, &current_region2);
+        int i;
+
+        xs = G_malloc((region_columns + columns) * sizeof(DCELL));
+        for (i = 0; i < region_columns + columns; i++) {
+            xs[i] = x;
+            x += current_region2.ew_res;
+        }
+    }
+
+    return xs;
+}
+
 int f_x(int argc, const int *argt, void **args)
 {
+    int tid = 0;
+#if defined(_OPENMP)
+    tid = omp_get_thread_num();
+#endif
+
     DCELL *res = args[0];
     DCELL x;
     int i;
@@ -27,6 +53,15 @@ int f_x(int argc, const int *argt, void **args)
     if (argt[0] != DCELL_TYPE)
         return E_RES_TYPE;
 
+    if (current_col[tid] > 0) {
+        const DCELL *xs = eastings() + current_col[tid];
+
+        for (i = 0; i < columns; i++)
+            res[i] = xs[i];
+
+        return 0;
+    }
+
     x = Rast_col_to_easting(0.5, &current_region2);
 
     for (i = 0; i < columns; i++) {
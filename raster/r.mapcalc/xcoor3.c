@@ -15,8 +15,35 @@ y() northing at center of row
 z() height at center of depth
 **********************************************************************/
 
+/* eastings of the columns for tiles, summed as for whole rows so that the
+   values are the same, including those of the columns past the region */
+static const DCELL *eastings(void)
+{
+    static DCELL *xs;
+
+#pragma omp critical(eastings)
+    if (!xs) {
+        RASTER3D_Region *window = &current_region3;
+        DCELL x = window->west + 0.5 * window->ew_res;
+        int i;
+
+        xs = G_malloc((region_columns + columns) * sizeof(DCELL));
+        for (i = 0; i < region_columns + columns; i++) {
+            xs[i] = x;
+            x += window->ew_res;
+        }
+    }
+
+    return xs;
+}
+
 int f_x(int argc, const int *argt, void **args)
 {
+    int tid = 0;
+#if defined(_OPENMP)
+    tid = omp_get_thread_num();
+#endif
+
     RASTER3D_Region *window = &current_region3;
     DCELL *res = args[0];
     DCELL x;
@@ -28,6 +55,15 @@ int f_x(int argc, const int *argt, void **args)
     if (argt[0] != DCELL_TYPE)
         return E_RES_TYPE;
 
+    if (current_col[tid] > 0) {
+        const DCELL *xs = eastings() + current_col[tid];
+
+        for (i = 0; i < columns; i++)
+            res[i] = xs[i];
+
+        return 0;
+    }
+
     x = window->west + 0.5 * window->ew_res;
 
     for (i = 0; i < columns; i++) {
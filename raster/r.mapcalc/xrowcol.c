@@ -19,6 +19,11 @@ ndepths() number of depths
 
 int f_col(int argc, const int *argt, void **args)
 {
+    int tid = 0;
+#if defined(_OPENMP)
+    tid = omp_get_thread_num();
+#endif
+
     CELL *res = args[0];
     int i;
 
@@ -29,7 +34,7 @@ int f_col(int argc, const int *argt, void **args)
         return E_RES_TYPE;
 
     for (i = 0; i < columns; i++)
-        res[i] = i + 1;
+        res[i] = current_col[tid] + i + 1;
 
     return 0;
 }
@@ -104,7 +109,7 @@ int f_ncols(int argc, const int *argt, void **args)
         return E_RES_TYPE;
 
     for (i = 0; i < columns; i++)
-        res[i] = columns;
+        res[i] = region_columns;
 
     return 0;
 }
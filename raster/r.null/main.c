@@ -254,6 +254,8 @@ int main(int argc, char *argv[])
         unlink(path);
         G_file_name_misc(path, "cell_misc", "nullcmpr", name, mapset);
         unlink(path);
+        Rast_remove_overviews(name);
+        Rast_remove_block_stats(name);
 
         G_done_msg(_("Raster map <%s> modified."), name);
 
@@ -1,3 +1,5 @@
+import os
+
 import grass.script as gs
 from grass.gunittest.case import TestCase
 from grass.gunittest.main import test
@@ -82,6 +84,25 @@ class TestRNull(TestCase):
 
         self.assertEqual(category_output, expected_output)
 
+    def test_remove_null_file(self):
+        """Verify -r removes files derived from the null values"""
+        self.runModule(
+            "r.mapcalc",
+            expression="map_remove = if(row() == 1, null(), col())",
+            overwrite=True,
+        )
+        self.runModule("r.support", map="map_remove", overviews=2)
+        env = gs.gisenv()
+        misc = os.path.join(
+            env["GISDBASE"], env["LOCATION_NAME"], env["MAPSET"], "cell_misc"
+        )
+        self.assertTrue(os.path.exists(os.path.join(misc, "map_remove", "ovr2")))
+        try:
+            self.assertModule("r.null", map="map_remove", flags="r")
+            self.assertFalse(os.path.exists(os.path.join(misc, "map_remove", "ovr2")))
+        finally:
+            self.runModule("g.remove", flags="f", type="raster", name="map_remove")
+
 
 if __name__ == "__main__":
     test()
@@ -67,6 +67,7 @@ struct menu {
 struct input {
     const char *name;
     int fd;
+    struct Rast_reader *rd; /* per-thread cursor over the shared fd */
     DCELL *buf;
     DCELL weight;
 };
@@ -220,7 +221,10 @@ int main(int argc, char *argv[])
         exit(EXIT_FAILURE);
 
     nprocs = G_set_omp_num_threads(parm.nprocs);
-    nprocs = Rast_disable_omp_on_mask(nprocs);
+    /* readers apply the mask per thread, only lazily opened maps
+       go through the shared file descriptor state */
+    if (flag.lazy->answer)
+        nprocs = Rast_disable_omp_on_mask(nprocs);
     if (nprocs < 1)
         G_fatal_error(_("<%d> is not valid number of nprocs."), nprocs);
 #if defined(_OPENMP)
@@ -302,6 +306,13 @@ int main(int argc, char *argv[])
                 G_verbose_message(
                     _("Reading raster map <%s> using weight %f..."), p->name,
                     p->weight);
+                if (t > 0 && !flag.lazy->answer) {
+                    /* all threads share one open map */
+                    p->fd = inputs[0][num_inputs].fd;
+                    p->rd = Rast_open_reader(p->fd);
+                    p->buf = Rast_allocate_d_buf();
+                    continue;
+                }
                 p->fd = Rast_open_old(p->name, "");
                 if (p->fd < 0)
                     G_fatal_error(_("Unable to open input raster <%s>"),
@@ -315,6 +326,8 @@ int main(int argc, char *argv[])
                 }
                 if (flag.lazy->answer)
                     Rast_close(p->fd);
+                else
+                    p->rd = Rast_open_reader(p->fd);
                 p->buf = Rast_allocate_d_buf();
             }
 
@@ -370,6 +383,13 @@ int main(int argc, char *argv[])
                 G_verbose_message(
                     _("Reading raster map <%s> using weight %f..."), p->name,
                     p->weight);
+                if (t > 0 && !flag.lazy->answer) {
+                    /* all threads share one open map */
+                    p->fd = inputs[0][i].fd;
+                    p->rd = Rast_open_reader(p->fd);
+                    p->buf = Rast_allocate_d_buf();
+                    continue;
+                }
                 p->fd = Rast_open_old(p->name, "");
                 if (p->fd < 0)
                     G_fatal_error(_("Unable to open input raster <%s>"),
@@ -383,6 +403,8 @@ int main(int argc, char *argv[])
                 }
                 if (flag.lazy->answer)
                     Rast_close(p->fd);
+                else
+                    p->rd = Rast_open_reader(p->fd);
                 p->buf = Rast_allocate_d_buf();
             }
         }
@@ -558,7 +580,8 @@ int main(int argc, char *argv[])
                 }
                 else {
                     for (i = 0; i < num_inputs; i++)
-                        Rast_get_d_row(in[i].fd, in[i].buf, row);
+                        Rast_reader_get_row(in[i].rd, in[i].buf, row,
+                                            DCELL_TYPE);
                 }
 
                 for (col = 0; col < ncols; col++) {
@@ -643,7 +666,9 @@ int main(int argc, char *argv[])
     if (!flag.lazy->answer) {
         for (t = 0; t < nprocs; t++)
             for (i = 0; i < num_inputs; i++)
-                Rast_close(inputs[t][i].fd);
+                Rast_close_reader(inputs[t][i].rd);
+        for (i = 0; i < num_inputs; i++)
+            Rast_close(inputs[0][i].fd);
     }
 
     exit(EXIT_SUCCESS);
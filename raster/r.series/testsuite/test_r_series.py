@@ -152,6 +152,38 @@ class TestRSeries(TestCase):
             precision=0.00001,
         )
 
+    def test_nprocs_identical(self):
+        """Test that threads give the same result on FP maps with nulls"""
+        inputs = [f"series_fp_{i}" for i in range(3)]
+        for i, name in enumerate(inputs):
+            # new maps are compressed, the first one is FCELL
+            call_module(
+                "r.mapcalc",
+                expression=f"{name} = if(rand(0, 10) == 0, null(),"
+                f" {'float' if i == 0 else 'double'}"
+                f"({self.elevation} * rand(0.5, 1.5) + {i}))",
+                seed=i + 1,
+            )
+        methods = ["average", "count", "median", "sum", "stddev", "max_raster"]
+        single = [f"series_single_{method}" for method in methods]
+        threaded = [f"series_threaded_{method}" for method in methods]
+        try:
+            self.assertModule(
+                "r.series", input=inputs, method=methods, output=single, nprocs=1
+            )
+            self.assertModule(
+                "r.series", input=inputs, method=methods, output=threaded, nprocs=4
+            )
+            for actual, reference in zip(threaded, single):
+                self.assertRastersEqual(actual, reference=reference, precision=0)
+        finally:
+            call_module(
+                "g.remove",
+                flags="f",
+                type_="raster",
+                name=inputs + single + threaded,
+            )
+
 
 if __name__ == "__main__":
     test()
@@ -42,6 +42,7 @@ int main(int argc, char *argv[])
     struct Option *semantic_label_opt;
     struct Option *map_opt, *units_opt, *vdatum_opt;
     struct Option *load_opt, *save_opt;
+    struct Option *overviews_opt, *resampling_opt;
     struct Flag *stats_flag, *null_flag, *del_flag, *semantic_label_rm_flag;
     int is_reclass; /* Is raster reclass? */
     const char *infile;
@@ -162,6 +163,26 @@ int main(int argc, char *argv[])
     del_flag->guisection = _("Maintenance");
     del_flag->description = _("Delete the null file");
 
+    overviews_opt = G_define_option();
+    overviews_opt->key = "overviews";
+    overviews_opt->type = TYPE_INTEGER;
+    overviews_opt->required = NO;
+    overviews_opt->multiple = YES;
+    overviews_opt->options = "0-4096";
+    overviews_opt->guisection = _("Maintenance");
+    overviews_opt->label = _("Build overviews reduced by these factors");
+    overviews_opt->description =
+        _("E.g. 2,4,8,16; 0 deletes the overviews of the map");
+
+    resampling_opt = G_define_option();
+    resampling_opt->key = "resampling";
+    resampling_opt->type = TYPE_STRING;
+    resampling_opt->required = NO;
+    resampling_opt->options = "nearest,average,mode";
+    resampling_opt->answer = "average";
+    resampling_opt->guisection = _("Maintenance");
+    resampling_opt->description = _("Resampling method for overviews");
+
     /* Parse command-line options */
     if (G_parser(argc, argv))
         exit(EXIT_FAILURE);
@@ -352,9 +373,44 @@ int main(int argc, char *argv[])
         G_file_name_misc(path, "cell_misc", "nullcmpr", raster->answer,
                          G_mapset());
         unlink(path);
+        Rast_remove_overviews(raster->answer);
+        Rast_remove_block_stats(raster->answer);
 
         G_done_msg(_("Done."));
     }
 
+    /* overviews */
+    if (overviews_opt->answer) {
+        int *levels;
+        int nlevels, method, i;
+
+        if (is_reclass)
+            G_fatal_error(_("[%s] is a reclass of another map. Exiting."),
+                          raster->answer);
+
+        for (nlevels = 0; overviews_opt->answers[nlevels]; nlevels++)
+            ;
+        levels = G_malloc(nlevels * sizeof(int));
+        for (i = 0; i < nlevels; i++)
+            levels[i] = atoi(overviews_opt->answers[i]);
+
+        if (nlevels == 1 && levels[0] == 0) {
+            G_message(_("Removing overviews of [%s]..."), raster->answer);
+            Rast_remove_overviews(raster->answer);
+        }
+        else {
+            if (strcmp(resampling_opt->answer, "nearest") == 0)
+                method = OVERVIEW_NEAREST;
+            else if (strcmp(resampling_opt->answer, "mode") == 0)
+                method = OVERVIEW_MODE;
+            else
+                method = OVERVIEW_AVERAGE;
+
+            Rast_build_overviews(raster->answer, levels, nlevels, method);
+        }
+
+        G_free(levels);
+    }
+
     return EXIT_SUCCESS;
 }
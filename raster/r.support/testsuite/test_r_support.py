@@ -9,9 +9,11 @@ Read the file COPYING that comes with GRASS
 for details
 """
 
+import os
 import random
 import string
 
+import grass.script as gs
 from grass.gunittest.case import TestCase
 from grass.gunittest.main import test
 
@@ -65,5 +67,95 @@ class RSupportSemanticLabelHandlingTestCase(TestCase):
         self.assertFalse(bool(ret))
 
 
+class RSupportOverviewsTestCase(TestCase):
+    checker = "support_checker"
+    blocks = "support_blocks"
+    coarse = "support_coarse"
+    diff = "support_diff"
+
+    @classmethod
+    def setUpClass(cls):
+        cls.use_temp_region()
+        cls.runModule("g.region", n=64, s=0, e=64, w=0, res=1)
+        # cells alternating between 0 and 2, the average over 2x2 cells is 1
+        cls.runModule(
+            "r.mapcalc", expression=f"{cls.checker} = (row() + col()) % 2 * 2"
+        )
+        # constant over 4x4 cells, with null blocks
+        cls.runModule(
+            "r.mapcalc",
+            expression=f"{cls.blocks} = if((row() - 1) / 4 == 3, null(),"
+            " (row() - 1) / 4 * 100 + (col() - 1) / 4)",
+        )
+        env = gs.gisenv()
+        cls.cell_misc = os.path.join(
+            env["GISDBASE"], env["LOCATION_NAME"], env["MAPSET"], "cell_misc"
+        )
+
+    @classmethod
+    def tearDownClass(cls):
+        cls.del_temp_region()
+        cls.runModule(
+            "g.remove",
+            flags="f",
+            type="raster",
+            name=[cls.checker, cls.blocks, cls.coarse, cls.coarse + "_ovr", cls.diff],
+        )
+
+    def tearDown(self):
+        self.runModule("g.region", n=64, s=0, e=64, w=0, res=1)
+
+    def has_overview(self, name, level):
+        return os.path.exists(os.path.join(self.cell_misc, name, f"ovr{level}"))
+
+    def read_coarse(self, name, res, overviews):
+        """Copy a map at a coarser resolution, with overviews on or off"""
+        output = self.coarse + ("_ovr" if overviews else "")
+        self.runModule("g.region", n=64, s=0, e=64, w=0, res=res)
+        self.assertModule(
+            "r.mapcalc",
+            expression=f"{output} = {name}",
+            overwrite=True,
+            env_=dict(os.environ, GRASS_RASTER_OVERVIEWS=str(int(overviews))),
+        )
+        return output
+
+    def test_overviews_used(self):
+        self.assertModule("r.support", map=self.checker, overviews=[2, 4])
+        self.assertTrue(self.has_overview(self.checker, 2))
+        self.assertTrue(self.has_overview(self.checker, 4))
+        on = self.read_coarse(self.checker, 2, overviews=True)
+        self.assertRasterMinMax(on, refmin=1, refmax=1)
+        # without them cells of the map are used, 0 or 2
+        off = self.read_coarse(self.checker, 2, overviews=False)
+        self.runModule(
+            "r.mapcalc", expression=f"{self.diff} = abs({off} - 1)", overwrite=True
+        )
+        self.assertRasterMinMax(self.diff, refmin=1, refmax=1)
+
+    def test_overviews_same_values(self):
+        for resampling in ("nearest", "average", "mode"):
+            self.assertModule(
+                "r.support", map=self.blocks, overviews=[2, 4], resampling=resampling
+            )
+            for res in (2, 4, 8):
+                on = self.read_coarse(self.blocks, res, overviews=True)
+                off = self.read_coarse(self.blocks, res, overviews=False)
+                self.assertRastersEqual(on, reference=off)
+
+    def test_remove_overviews(self):
+        self.assertModule("r.support", map=self.checker, overviews=2)
+        self.assertTrue(self.has_overview(self.checker, 2))
+        self.assertModule("r.support", map=self.checker, overviews=0)
+        self.assertFalse(self.has_overview(self.checker, 2))
+
+        self.assertModule("r.support", map=self.checker, overviews=2)
+        self.assertModule("r.support", map=self.checker, flags="d")
+        self.assertFalse(self.has_overview(self.checker, 2))
+        on = self.read_coarse(self.checker, 2, overviews=True)
+        off = self.read_coarse(self.checker, 2, overviews=False)
+        self.assertRastersEqual(on, reference=off)
+
+
 if __name__ == "__main__":
     test()
@@ -52,6 +52,12 @@ typedef struct zone_workspace {
     zone_bucket bucket;
 } zone_workspace;
 
+/* cells of the region taken from block statistics of the map instead */
+typedef struct block_cover {
+    int r0, r1; /* rows of the region covered by whole blocks    */
+    int c0, c1; /* columns of the region covered by whole blocks */
+} block_cover;
+
 typedef struct thread_workspace {
     int fd;
     int fdz;
@@ -136,8 +142,11 @@ void set_params(void)
 }
 
 static int open_raster(const char *infile);
+static int process_blocks(univar_stat *stats, const char *infile,
+                          const struct Cell_head *region, block_cover *cover);
 static void process_raster(univar_stat *stats, thread_workspace *tw,
-                           const struct Cell_head *region, int nprocs,
+                           const struct Cell_head *region,
+                           const block_cover *cover, int nprocs,
                            enum OutputFormat format);
 static void kahan_sum(double *sum, double *c, double x);
 
@@ -289,6 +298,8 @@ int main(int argc, char *argv[])
     stats = ((map_type == -1) ? create_univar_stat_struct(-1, 0) : 0);
 
     for (infile = param.inputfile->answers; *infile; infile++) {
+        block_cover cover;
+        int use_blocks;
 
         /* Check if the native extent and resolution
            of the input map should be used */
@@ -321,7 +332,14 @@ int main(int argc, char *argv[])
             }
         }
 
-        process_raster(stats, tw, &region, nprocs, format);
+        /* whole blocks of the map are summed up from its block statistics,
+           unless cells have to be collected or masked */
+        use_blocks = !zonemap && !param.extended->answer &&
+                     !Rast_mask_is_present() &&
+                     process_blocks(stats, *infile, &region, &cover);
+
+        process_raster(stats, tw, &region, use_blocks ? &cover : NULL, nprocs,
+                       format);
 
         /* close input raster */
         for (t = 0; t < nprocs; t++)
@@ -362,8 +380,105 @@ static int open_raster(const char *infile)
     return fd;
 }
 
+/* Adds the statistics of the blocks of the map lying wholly within the
+ * region, which must match the cells of the map. Returns 0 if the map
+ * has no usable block statistics.
+ */
+static int process_blocks(univar_stat *stats, const char *infile,
+                          const struct Cell_head *region, block_cover *cover)
+{
+    struct Block_stats bs;
+    struct Cell_head cellhd;
+    const char *mapset;
+    double drow, dcol;
+    int row0, col0, br0, br1, bc0, bc1, br, bc;
+
+    mapset = G_find_raster2(infile, "");
+    Rast_get_cellhd(infile, mapset, &cellhd);
+
+    /* region cells must be cells of the map, no wrapping around */
+    if (cellhd.proj == PROJECTION_LL ||
+        fabs(region->ns_res - cellhd.ns_res) > 1e-6 * cellhd.ns_res ||
+        fabs(region->ew_res - cellhd.ew_res) > 1e-6 * cellhd.ew_res)
+        return 0;
+    drow = (cellhd.north - region->north) / cellhd.ns_res;
+    dcol = (region->west - cellhd.west) / cellhd.ew_res;
+    row0 = (int)floor(drow + 0.5);
+    col0 = (int)floor(dcol + 0.5);
+    if (fabs(drow - row0) > 1e-6 || fabs(dcol - col0) > 1e-6)
+        return 0;
+
+    if (Rast_read_block_stats(infile, mapset, &bs) < 0)
+        return 0;
+
+    /* blocks within the region */
+    br0 = bs.nrows;
+    br1 = 0;
+    for (br = 0; br < bs.nrows; br++) {
+        int end = (br + 1) * bs.rows < cellhd.rows ? (br + 1) * bs.rows
+                                                   : cellhd.rows;
+
+        if (br * bs.rows >= row0 && end <= row0 + region->rows) {
+            if (br < br0)
+                br0 = br;
+            br1 = br + 1;
+        }
+    }
+    bc0 = bs.ncols;
+    bc1 = 0;
+    for (bc = 0; bc < bs.ncols; bc++) {
+        int end = (bc + 1) * bs.cols < cellhd.cols ? (bc + 1) * bs.cols
+                                                   : cellhd.cols;
+
+        if (bc * bs.cols >= col0 && end <= col0 + region->cols) {
+            if (bc < bc0)
+                bc0 = bc;
+            bc1 = bc + 1;
+        }
+    }
+
+    if (br0 >= br1 || bc0 >= bc1) {
+        Rast_free_block_stats(&bs);
+        return 0;
+    }
+
+    cover->r0 = br0 * bs.rows - row0;
+    cover->r1 = (br1 * bs.rows < cellhd.rows ? br1 * bs.rows : cellhd.rows) -
+                row0;
+    cover->c0 = bc0 * bs.cols - col0;
+    cover->c1 = (bc1 * bs.cols < cellhd.cols ? bc1 * bs.cols : cellhd.cols) -
+                col0;
+
+    G_debug(1, "Block statistics of <%s> cover rows %d-%d, columns %d-%d",
+            infile, cover->r0, cover->r1, cover->c0, cover->c1);
+
+    stats->size += (size_t)(cover->r1 - cover->r0) * (cover->c1 - cover->c0);
+
+    for (br = br0; br < br1; br++) {
+        for (bc = bc0; bc < bc1; bc++) {
+            const struct Block_stat *b = &bs.blocks[(size_t)br * bs.ncols + bc];
+
+            if (b->count == 0)
+                continue;
+            stats->n += b->count;
+            stats->sum += b->sum;
+            stats->sumsq += b->sumsq;
+            stats->sum_abs += b->sum_abs;
+            if (stats->max != stats->max || b->max > stats->max)
+                stats->max = b->max;
+            if (stats->min != stats->min || b->min < stats->min)
+                stats->min = b->min;
+        }
+    }
+
+    Rast_free_block_stats(&bs);
+
+    return 1;
+}
+
 static void process_raster(univar_stat *stats, thread_workspace *tw,
-                           const struct Cell_head *region, int nprocs,
+                           const struct Cell_head *region,
+                           const block_cover *cover, int nprocs,
                            enum OutputFormat format)
 {
     /* use G_window_rows(), G_window_cols() here? */
@@ -429,6 +544,20 @@ static void process_raster(univar_stat *stats, thread_workspace *tw,
 #pragma omp for
         for (row = 0; row < rows; row++) {
             thread_workspace *w = &tw[t_id];
+            int skip0 = cols, skip1 = cols;
+
+            if (cover && row >= cover->r0 && row < cover->r1) {
+                skip0 = cover->c0;
+                skip1 = cover->c1;
+            }
+            if (skip0 == 0 && skip1 == cols) {
+                if (format != SHELL) {
+#pragma omp atomic update
+                    computed++;
+                    G_percent(computed, rows, 2);
+                }
+                continue;
+            }
 
             Rast_get_row(w->fd, w->raster_row, row, map_type);
             void *ptr = w->raster_row;
@@ -442,6 +571,13 @@ static void process_raster(univar_stat *stats, thread_workspace *tw,
             for (int col = 0; col < cols; col++) {
                 int zone = 0;
 
+                /* cells of whole blocks are already counted */
+                if (col == skip0) {
+                    ptr = G_incr_void_ptr(ptr, (skip1 - skip0) * value_sz);
+                    col = skip1 - 1;
+                    continue;
+                }
+
                 if (n_zones) {
                     /* skip NULL cells in zone map */
                     if (Rast_is_c_null_value(zptr)) {
@@ -516,7 +652,7 @@ static void process_raster(univar_stat *stats, thread_workspace *tw,
                     /* integer does not have floating point error */
                     int val = *((CELL *)ptr);
                     zd->sum += val;
-                    zd->sumsq += val * val;
+                    zd->sumsq += (double)val * val;
                     zd->sum_abs += abs(val);
                     if (val > zd->max)
                         zd->max = val;
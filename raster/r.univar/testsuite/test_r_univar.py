@@ -4,6 +4,7 @@
 """
 
 import json
+import os
 from itertools import zip_longest
 
 from grass.gunittest.case import TestCase
@@ -732,6 +733,96 @@ class TestRasterUnivar(TestCase):
                     self.assertEqual(expected[key], received[key])
 
 
+class TestRasterUnivarBlockStats(TestCase):
+    """Compare statistics from block statistics with those from cells"""
+
+    # the same maps with block statistics in 16x16 blocks and without
+    expressions = {
+        "univar_blocks_cell": "row() * 7 - col() * 3",
+        "univar_blocks_nulls": "if(rand(0, 6) == 0 || row() == 20, null(),"
+        " rand(-100.0, 100.0))",
+        "univar_blocks_fcell": "float(rand(0.0, 1.0)) * row()",
+        # sums of squares beyond the integers exact in a double
+        "univar_blocks_large": "rand(2000000000, 2147483000) * if(col() % 2, -1, 1)",
+    }
+    regions = {
+        "full": {"n": 90, "s": 0, "w": 0, "e": 90, "res": 1},
+        "grid": {"n": 74, "s": 26, "w": 16, "e": 80, "res": 1},
+        "off_grid": {"n": 83, "s": 11, "w": 5, "e": 77, "res": 1},
+        "beyond_map": {"n": 100, "s": 30, "w": -7, "e": 70, "res": 1},
+        "shifted": {"n": 80.5, "s": 10.5, "w": 3.5, "e": 75.5, "res": 1},
+    }
+
+    @classmethod
+    def setUpClass(cls):
+        cls.use_temp_region()
+        cls.runModule("g.region", **cls.regions["full"])
+        for name, expression in cls.expressions.items():
+            for suffix, size in (("", "16"), ("_ref", "0")):
+                cls.runModule(
+                    "r.mapcalc",
+                    expression=f"{name}{suffix} = {expression}",
+                    seed=1,
+                    env_=dict(os.environ, GRASS_RASTER_BLOCK_STATS=size),
+                )
+
+    @classmethod
+    def tearDownClass(cls):
+        cls.del_temp_region()
+        cls.runModule(
+            "g.remove",
+            flags="f",
+            type="raster",
+            name=[name + suffix for name in cls.expressions for suffix in ("", "_ref")],
+        )
+
+    def tearDown(self):
+        self.runModule("g.region", **self.regions["full"])
+
+    def univar(self, name):
+        module = SimpleModule("r.univar", map=name, flags="g")
+        self.assertModule(module)
+        return dict(line.split("=", 1) for line in module.outputs.stdout.splitlines())
+
+    def assertSameStats(self, name):
+        actual = self.univar(name)
+        reference = self.univar(name + "_ref")
+        self.assertCountEqual(actual.keys(), reference.keys())
+        for key, value in reference.items():
+            # the order of summation differs
+            self.assertAlmostEqual(
+                float(actual[key]),
+                float(value),
+                delta=abs(float(value)) * 1e-9,
+                msg=f"{key} of <{name}>",
+            )
+
+    def test_regions(self):
+        for region in self.regions.values():
+            self.runModule("g.region", **region)
+            for name in self.expressions:
+                self.assertSameStats(name)
+
+    def test_nulls_removed(self):
+        """Block statistics of a map whose null file is gone are not used"""
+        name = "univar_blocks_removed"
+        for suffix, size in (("", "16"), ("_ref", "0")):
+            self.runModule(
+                "r.mapcalc",
+                expression=f"{name}{suffix} = if(rand(0, 6) == 0, null(),"
+                " rand(1, 100))",
+                seed=1,
+                env_=dict(os.environ, GRASS_RASTER_BLOCK_STATS=size),
+            )
+        try:
+            self.runModule("r.null", map=name, flags="r")
+            self.runModule("r.null", map=name + "_ref", flags="r")
+            self.assertSameStats(name)
+        finally:
+            self.runModule(
+                "g.remove", flags="f", type="raster", name=[name, name + "_ref"]
+            )
+
 if __name__ == "__main__":
     from grass.gunittest.main import test
 
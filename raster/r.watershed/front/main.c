@@ -24,7 +24,7 @@
 
 static void write_hist(char *, char *, char *, int, int);
 
-static const char *new_argv[22];
+static const char *new_argv[26];
 static int new_argc;
 
 static void do_opt(const struct Option *opt)
@@ -61,6 +61,7 @@ int main(int argc, char *argv[])
     struct Option *opt17;
     struct Option *opt18;
     struct Option *opt19;
+    struct Option *opt20;
     struct Flag *flag_sfd;
     struct Flag *flag_flow;
     struct Flag *flag_seg;
@@ -209,6 +210,8 @@ int main(int argc, char *argv[])
 
     opt16 = G_define_standard_option(G_OPT_MEMORYMB);
 
+    opt20 = G_define_standard_option(G_OPT_M_NPROCS);
+
     flag_sfd = G_define_flag();
     flag_sfd->key = 's';
     flag_sfd->label = _("SFD (D8) flow (default is MFD)");
@@ -299,8 +302,14 @@ int main(int argc, char *argv[])
     do_opt(opt13);
     do_opt(opt14);
     do_opt(opt15);
-    if (flag_seg->answer)
+    if (flag_seg->answer) {
         do_opt(opt16);
+        if (atoi(opt20->answer) != 1)
+            G_verbose_message(_("Disk swap mode runs on one thread, nprocs "
+                                "is ignored"));
+    }
+    else
+        do_opt(opt20);
     new_argv[new_argc++] = NULL;
 
     G_debug(1, "Mode: %s", flag_seg->answer ? "Segmented" : "All in RAM");
@@ -1,3 +1,7 @@
+#if defined(_OPENMP)
+#include <omp.h>
+#endif
+
 #include "Gwater.h"
 #include <grass/gis.h>
 #include <grass/raster.h>
@@ -99,122 +103,283 @@ double get_slope_tci(CELL ele, CELL down_ele, double dist)
         return (double)(ele - down_ele) / dist;
 }
 
-int do_cum(void)
+/* SFD state shared by the cells, set by do_cum() */
+static int asp_r[9] = {0, -1, -1, -1, 0, 1, 1, 1, 0};
+static int asp_c[9] = {0, 1, 0, -1, -1, -1, 0, 1, 1};
+static double *dist_to_nbr, *contour, cell_size;
+static int threshold;
+
+/* the swale flags of different cells may share a byte */
+static void swale_set(int r, int c)
 {
-    int r, c, dr, dc;
+    unsigned char *b = &swale->array[r][c >> 3];
+
+#pragma omp atomic
+    *b |= (1 << (c & 7));
+}
+
+/* downstream cell of a cell, returns 0 if none in the region */
+static int get_down(size_t this_index, int r, int c, int *dr, int *dc)
+{
+    CELL aspect = asp[this_index];
+
+    /* skip user-defined depressions */
+    if (!aspect)
+        return 0;
+
+    *dr = r + asp_r[ABS(aspect)];
+    *dc = c + asp_c[ABS(aspect)];
+
+    return *dr >= 0 && *dr < nrows && *dc >= 0 && *dc < ncols;
+}
+
+/* pass the flow of a cell to its downstream cell */
+static void cum_cell(size_t this_index, int r, int c)
+{
+    int dr, dc;
     int r_nbr, c_nbr, ct_dir, np_side, edge;
     CELL is_swale, aspect, ele_nbr;
     DCELL value, valued;
-    size_t killer;
-    int threshold;
-    int asp_r[9] = {0, -1, -1, -1, 0, 1, 1, 1, 0};
-    int asp_c[9] = {0, 1, 0, -1, -1, -1, 0, 1, 1};
-    size_t this_index, down_index, nbr_index;
-    double *dist_to_nbr, *contour;
-    double cell_size;
+    size_t down_index, nbr_index;
 
-    G_message(_("SECTION 3: Accumulating Surface Flow with SFD."));
+    if (!get_down(this_index, r, c, &dr, &dc))
+        return;
 
-    /* distances to neighbours, contour lengths */
-    dist_to_nbr = (double *)G_malloc(sides * sizeof(double));
-    contour = (double *)G_malloc(sides * sizeof(double));
+    aspect = asp[this_index];
+    down_index = SEG_INDEX(wat_seg, dr, dc);
+    value = wat[this_index];
+    /* apply retention to adjust flow accumulation */
+    if (rtn_flag)
+        value *= rtn[this_index] / 100.0;
 
-    cell_size = get_dist(dist_to_nbr, contour);
+    if (fabs(value) >= threshold)
+        swale_set(r, c);
+    valued = wat[down_index];
 
-    if (bas_thres <= 0)
-        threshold = 60;
-    else
-        threshold = bas_thres;
+    edge = 0;
+    np_side = -1;
+    for (ct_dir = 0; ct_dir < sides; ct_dir++) {
+        /* get r, c (r_nbr, c_nbr) for neighbours */
+        r_nbr = r + nextdr[ct_dir];
+        c_nbr = c + nextdc[ct_dir];
+
+        if (dr == r_nbr && dc == c_nbr)
+            np_side = ct_dir;
+
+        /* check that neighbour is within region */
+        if (r_nbr >= 0 && r_nbr < nrows && c_nbr >= 0 && c_nbr < ncols) {
+
+            nbr_index = SEG_INDEX(wat_seg, r_nbr, c_nbr);
+            ele_nbr = alt[nbr_index];
+            if (Rast_is_c_null_value(&ele_nbr))
+                edge = 1;
+        }
+        else
+            edge = 1;
+        if (edge)
+            break;
+    }
+    /* do not distribute flow along edges, this causes artifacts */
+    if (edge) {
+        is_swale = FLAG_GET(swale, r, c);
+        if (is_swale && aspect > 0) {
+            aspect = -1 * drain[r - r_nbr + 1][c - c_nbr + 1];
+            asp[this_index] = aspect;
+        }
+        if (valued > 0)
+            wat[down_index] = -valued;
+        return;
+    }
+
+    if (value > 0) {
+        if (valued > 0)
+            valued += value;
+        else
+            valued -= value;
+    }
+    else {
+        if (valued < 0)
+            valued += value;
+        else
+            valued = value - valued;
+    }
+    wat[down_index] = valued;
+
+    /* topographic wetness index ln(a / tan(beta)) and
+     * stream power index a * tan(beta) */
+    if (atanb_flag) {
+        sca[this_index] = fabs(value) * (cell_size / contour[np_side]);
+        tanb[this_index] = get_slope_tci(alt[this_index], alt[down_index],
+                                         dist_to_nbr[np_side]);
+    }
+
+    is_swale = FLAG_GET(swale, r, c);
+    if (is_swale || fabs(valued) >= threshold) {
+        swale_set(dr, dc);
+    }
+    else {
+        if (er_flag && !is_swale)
+            slope_length(r, c, dr, dc);
+    }
+}
+
+/* Parallel accumulation along the flow tree.
+ *
+ * A cell only changes its own state and that of its downstream cell, and
+ * the A* order has each cell after all cells draining into it. The
+ * cells draining into a cell can thus pass on their flow as soon as
+ * they have all received theirs, in the order they have in the A* order,
+ * which gives the same results as the sequential pass. Each thread
+ * starts at cells nothing drains into and follows the flow path down,
+ * the thread completing the last inflow of a cell carries on with it.
+ *
+ * Returns 0 without accumulating if the A* order is not one in which
+ * cells come before the cell they drain into. */
+static int do_cum_par(void)
+{
+    size_t killer, this_index, down_index, n_cells, count;
+    size_t *order;
+    unsigned char *n_in, *up_dirs;
+    int r, c, dr, dc, ct_dir;
+
+    /* number in A* order of each cell, 0 if not in it */
+    n_cells = size_array(&wat_seg, nrows, ncols);
+    order = (size_t *)G_calloc(n_cells, sizeof(size_t));
+    n_in = (unsigned char *)G_calloc(n_cells, sizeof(unsigned char));
+    up_dirs = (unsigned char *)G_calloc(n_cells, sizeof(unsigned char));
+
+    for (killer = 1; killer <= do_points; killer++)
+        order[astar_pts[killer]] = killer;
+
+    /* number and directions of the cells draining into each cell,
+     * sources are marked; the directions are kept because cum_cell()
+     * may change the aspect of a cell on the edge */
     for (killer = 1; killer <= do_points; killer++) {
-        G_percent(killer, do_points, 1);
         this_index = astar_pts[killer];
-        aspect = asp[this_index];
         seg_index_rc(alt_seg, this_index, &r, &c);
-        if (aspect) {
-            dr = r + asp_r[ABS(aspect)];
-            dc = c + asp_c[ABS(aspect)];
+        if (!get_down(this_index, r, c, &dr, &dc))
+            continue;
+        down_index = SEG_INDEX(wat_seg, dr, dc);
+        if (order[down_index] && order[down_index] < killer) {
+            G_verbose_message(_("A* order is not a flow order, flow is "
+                                "accumulated on one thread"));
+            G_free(order);
+            G_free(n_in);
+            G_free(up_dirs);
+            return 0;
         }
-        /* skip user-defined depressions */
-        else
-            dr = dc = -1;
-        if (dr >= 0 && dr < nrows && dc >= 0 &&
-            dc < ncols) { /* if ((dr = astar_pts[killer].downr) > -1) { */
-            down_index = SEG_INDEX(wat_seg, dr, dc);
-            value = wat[this_index];
-            /* apply retention to adjust flow accumulation */
-            if (rtn_flag)
-                value *= rtn[this_index] / 100.0;
-
-            if (fabs(value) >= threshold)
-                FLAG_SET(swale, r, c);
-            valued = wat[down_index];
+        n_in[down_index]++;
+        for (ct_dir = 0; ct_dir < 8; ct_dir++)
+            if (asp_r[ct_dir + 1] == r - dr && asp_c[ct_dir + 1] == c - dc)
+                up_dirs[down_index] |= 1 << ct_dir;
+    }
+    for (killer = 1; killer <= do_points; killer++) {
+        this_index = astar_pts[killer];
+        if (n_in[this_index] == 0)
+            n_in[this_index] = 0x80;
+    }
 
-            edge = 0;
-            np_side = -1;
-            for (ct_dir = 0; ct_dir < sides; ct_dir++) {
-                /* get r, c (r_nbr, c_nbr) for neighbours */
-                r_nbr = r + nextdr[ct_dir];
-                c_nbr = c + nextdc[ct_dir];
+    count = 0;
+#pragma omp parallel for schedule(dynamic, 1024) private(this_index, \
+                                                             down_index, r, \
+                                                             c, dr, dc)
+    for (killer = 1; killer <= do_points; killer++) {
+        unsigned char left;
 
-                if (dr == r_nbr && dc == c_nbr)
-                    np_side = ct_dir;
+        this_index = astar_pts[killer];
+#pragma omp atomic read seq_cst
+        left = n_in[this_index];
+        if (left != 0x80)
+            continue;
 
-                /* check that neighbour is within region */
-                if (r_nbr >= 0 && r_nbr < nrows && c_nbr >= 0 &&
-                    c_nbr < ncols) {
+        seg_index_rc(alt_seg, this_index, &r, &c);
+        while (get_down(this_index, r, c, &dr, &dc)) {
+            size_t up[8], up_index;
+            int n_up, i, j, dir, ur, uc;
 
-                    nbr_index = SEG_INDEX(wat_seg, r_nbr, c_nbr);
-                    ele_nbr = alt[nbr_index];
-                    if (Rast_is_c_null_value(&ele_nbr))
-                        edge = 1;
-                }
-                else
-                    edge = 1;
-                if (edge)
-                    break;
+            down_index = SEG_INDEX(wat_seg, dr, dc);
+            /* seq_cst makes the flow passed on by the other threads
+             * draining into down_index visible to the last one */
+#pragma omp atomic capture seq_cst
+            left = --n_in[down_index];
+            if (left != 0)
+                break;
+
+            /* all cells draining into down_index are done,
+             * pass on their flow in A* order */
+            n_up = 0;
+            for (dir = 0; dir < 8; dir++) {
+                if (!(up_dirs[down_index] & (1 << dir)))
+                    continue;
+                up_index = SEG_INDEX(wat_seg, dr + asp_r[dir + 1],
+                                     dc + asp_c[dir + 1]);
+                for (i = n_up; i > 0 && order[up[i - 1]] > order[up_index];
+                     i--)
+                    up[i] = up[i - 1];
+                up[i] = up_index;
+                n_up++;
             }
-            /* do not distribute flow along edges, this causes artifacts */
-            if (edge) {
-                is_swale = FLAG_GET(swale, r, c);
-                if (is_swale && aspect > 0) {
-                    aspect = -1 * drain[r - r_nbr + 1][c - c_nbr + 1];
-                    asp[this_index] = aspect;
-                }
-                if (valued > 0)
-                    wat[down_index] = -valued;
-                continue;
+            for (j = 0; j < n_up; j++) {
+                seg_index_rc(alt_seg, up[j], &ur, &uc);
+                cum_cell(up[j], ur, uc);
             }
 
-            if (value > 0) {
-                if (valued > 0)
-                    valued += value;
-                else
-                    valued -= value;
-            }
-            else {
-                if (valued < 0)
-                    valued += value;
-                else
-                    valued = value - valued;
-            }
-            wat[down_index] = valued;
+#pragma omp atomic
+            count += n_up;
 
-            /* topographic wetness index ln(a / tan(beta)) and
-             * stream power index a * tan(beta) */
-            if (atanb_flag) {
-                sca[this_index] = fabs(value) * (cell_size / contour[np_side]);
-                tanb[this_index] = get_slope_tci(
-                    alt[this_index], alt[down_index], dist_to_nbr[np_side]);
-            }
+            /* carry on downstream if the cell passes its flow on */
+            if (!order[down_index])
+                break;
+            this_index = down_index;
+            r = dr;
+            c = dc;
+        }
 
-            is_swale = FLAG_GET(swale, r, c);
-            if (is_swale || fabs(valued) >= threshold) {
-                FLAG_SET(swale, dr, dc);
-            }
-            else {
-                if (er_flag && !is_swale)
-                    slope_length(r, c, dr, dc);
-            }
+#if defined(_OPENMP)
+        if (omp_get_thread_num() == 0)
+#endif
+        {
+            size_t done;
+
+#pragma omp atomic read
+            done = count;
+            G_percent(done, do_points, 1);
+        }
+    }
+    G_percent(1, 1, 1);
+
+    G_free(order);
+    G_free(n_in);
+    G_free(up_dirs);
+
+    return 1;
+}
+
+int do_cum(void)
+{
+    int r, c;
+    size_t killer;
+    size_t this_index;
+
+    G_message(_("SECTION 3: Accumulating Surface Flow with SFD."));
+
+    /* distances to neighbours, contour lengths */
+    dist_to_nbr = (double *)G_malloc(sides * sizeof(double));
+    contour = (double *)G_malloc(sides * sizeof(double));
+
+    cell_size = get_dist(dist_to_nbr, contour);
+
+    if (bas_thres <= 0)
+        threshold = 60;
+    else
+        threshold = bas_thres;
+
+    if (nprocs < 2 || !do_cum_par()) {
+        for (killer = 1; killer <= do_points; killer++) {
+            G_percent(killer, do_points, 1);
+            this_index = astar_pts[killer];
+            seg_index_rc(alt_seg, this_index, &r, &c);
+            cum_cell(this_index, r, c);
         }
     }
     G_free(astar_pts);
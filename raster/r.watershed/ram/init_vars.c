@@ -1,5 +1,8 @@
 #include <stdlib.h>
 #include <string.h>
+#if defined(_OPENMP)
+#include <omp.h>
+#endif
 #include "Gwater.h"
 #include <grass/gis.h>
 #include <grass/raster.h>
@@ -43,6 +46,7 @@ int init_vars(int argc, char *argv[])
     abs_acc = 0;
     flat_flag = 0;
     ele_scale = 1;
+    nprocs = 1;
 
     for (r = 1; r < argc; r++) {
         if (sscanf(argv[r], "elevation=%s", ele_name) == 1)
@@ -96,6 +100,8 @@ int init_vars(int argc, char *argv[])
         }
         else if (sscanf(argv[r], "convergence=%d", &c_fac) == 1)
             ;
+        else if (sscanf(argv[r], "nprocs=%d", &nprocs) == 1)
+            ;
         else if (strcmp(argv[r], "-s") == 0)
             mfd = 0;
         else if (strcmp(argv[r], "-a") == 0)
@@ -105,6 +111,24 @@ int init_vars(int argc, char *argv[])
         else
             usage(argv[0]);
     }
+#if defined(_OPENMP)
+    /* as G_set_omp_num_threads() */
+    if (nprocs == 0)
+        nprocs = omp_get_max_threads();
+    else if (nprocs < 0)
+        nprocs += omp_get_num_procs();
+    if (nprocs < 1)
+        nprocs = 1;
+    omp_set_num_threads(nprocs);
+    if (nprocs > 1 && mfd)
+        G_verbose_message(_("MFD flow is accumulated on one thread, nprocs "
+                            "only applies to SFD (-s)"));
+#else
+    if (nprocs != 0 && nprocs != 1)
+        G_warning(_("GRASS is not compiled with OpenMP support, parallel "
+                    "computation is disabled. Only one thread will be used."));
+    nprocs = 1;
+#endif
     if (mfd == 1 && (c_fac < 1 || c_fac > 10)) {
         G_fatal_error("Convergence factor must be between 1 and 10.");
     }
@@ -215,6 +215,32 @@ class TestWatershed(TestCase):
             msg="Basin values must be in the range [2, 256]",
         )
 
+    def test_nprocs(self):
+        """Test that SFD results do not depend on the number of threads"""
+        self.assertModule(
+            "r.watershed",
+            flags="s",
+            elevation=self.elevation,
+            threshold="10000",
+            accumulation=self.accumulation,
+            length_slope=self.slopelength,
+            stream=self.stream,
+            nprocs=1,
+        )
+        self.assertModule(
+            "r.watershed",
+            flags="s",
+            elevation=self.elevation,
+            threshold="10000",
+            accumulation=self.basin,
+            length_slope=self.lengthslope_2,
+            stream=self.stream_2,
+            nprocs=4,
+        )
+        self.assertRastersNoDifference(self.basin, self.accumulation, 0)
+        self.assertRastersNoDifference(self.lengthslope_2, self.slopelength, 0)
+        self.assertRastersNoDifference(self.stream_2, self.stream, 0)
+
 
 if __name__ == "__main__":
     test()